@@ -178,14 +178,12 @@ void Model::refresh()
 	beginResetModel();
 
 	d->items.clear();
-	for( int id = 0; id < 10; id++ )
+	std::vector<int> ids = jsmapper::Device::enumerate();
+	for( size_t i = 0; i < ids.size(); i++ )
 	{
-		if( jsmapper::Device::test( id ) )
-		{
-			Item item( id );
-			updateItem( &item );
-			d->items.push_back( item );
-		}
+		Item item( ids[i] );
+		updateItem( &item );
+		d->items.push_back( item );
 	}
 
 	endResetModel();
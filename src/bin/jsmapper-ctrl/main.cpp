@@ -34,10 +34,12 @@
 #define SHOW_AXES       1000
 #define SHOW_BUTTONS    1001
 #define SHOW_KEYS       1002
+#define SHOW_BANKS      1003
+#define BANK_BUTTON     1004
 
 
 /// Short options list:
-static const char	 shortOptions[] = "hd:cl:m:";
+static const char	 shortOptions[] = "hd:cl:m:b:s:";
 
 /// Long options list:
 static struct option longOptions[]	=
@@ -47,6 +49,10 @@ static struct option longOptions[]	=
 	{"clear",   no_argument,        NULL, 'c'},
 	{"load",	required_argument,  NULL, 'l'},
     {"map",		required_argument,  NULL, 'm'},
+	{"bank",	required_argument,  NULL, 'b'},
+	{"select",	required_argument,  NULL, 's'},
+	{"bank-button", required_argument, NULL, BANK_BUTTON },
+	{"banks",   no_argument,        NULL, SHOW_BANKS },
     {"keys",    no_argument,        NULL, SHOW_KEYS },
     {"axes",    no_argument,        NULL, SHOW_AXES },
     {"buttons", no_argument,        NULL, SHOW_BUTTONS },
@@ -62,6 +68,10 @@ static const char * helpText =
 	"    -c,--clear             clear device\n"
 	"    -l,--load <file>       load specified profile file\n"
 	"    -m,--map <file>        uses specific device map file\n"
+	"    -b,--bank <n>          preload profile into bank n (1..8) instead of the active one\n"
+	"    -s,--select <n>        switch to the profile preloaded in bank n\n"
+	"    --bank-button <btn>    button (name or ID) cycling through the loaded banks, 'none' to disable\n"
+	"    --banks                shows active & loaded banks\n"
 	"    -h,--help              shows this help\n"
 	"\n"
 	"Dump options:\n"
@@ -75,6 +85,8 @@ void printKeys();
 void printAxes();
 void printButtons();
 bool initMap( jsmapper::Device &dev, std::string &mapFile );
+bool setBankButton( jsmapper::Device &dev, const std::string &button, std::string &mapFile );
+void printBanks( jsmapper::Device &dev );
 
 
 /**
@@ -92,6 +104,10 @@ int main(int argc, char **argv)
 	std::string profileFile;
 	std::string mapFile;
 	int clearFilter	= 0;
+	uint bank = JSMAPPER_BANK_ACTIVE;
+	uint selectBank = JSMAPPER_BANK_ACTIVE;
+	std::string bankButton;
+	int showBanks = 0;
 	        
 	int error = 0;
 	int option = -1;
@@ -136,6 +152,32 @@ int main(int argc, char **argv)
 			}
 			break;
 		
+		case 'b':
+			if( optarg )
+				bank = atoi( optarg );
+			break;
+		
+		case 's':
+			if( optarg )
+			{
+				selectBank = atoi( optarg );
+				showHelp = 0;
+			}
+			break;
+		
+		case BANK_BUTTON:
+			if( optarg )
+			{
+				bankButton = optarg;
+				showHelp = 0;
+			}
+			break;
+		
+		case SHOW_BANKS:
+			showBanks = 1;
+			showHelp = 0;
+			break;
+		
         case SHOW_AXES:
             showAxes = 1;
             showHelp = 0;
@@ -176,7 +218,10 @@ int main(int argc, char **argv)
 	
 	// do what asked for:
 	if( profileFile.empty() == false 
-			|| clearFilter )
+			|| clearFilter 
+			|| selectBank != JSMAPPER_BANK_ACTIVE
+			|| bankButton.empty() == false
+			|| showBanks )
 	{
 		jsmapper::Device dev( deviceId );
 		if( dev.open() )
@@ -196,14 +241,17 @@ int main(int argc, char **argv)
 			// load a profile, if asked to:
 			if( profileFile.empty() == false && error == 0 )
 			{
-				printf( "Loading profile from %s...\n", profileFile.c_str() );
+				if( bank != JSMAPPER_BANK_ACTIVE )
+					printf( "Loading profile from %s into bank %u...\n", profileFile.c_str(), bank );
+				else
+					printf( "Loading profile from %s...\n", profileFile.c_str() );
 				jsmapper::Profile profile;
 				if( profile.load( profileFile ) )
 				{
 					// ok, load profile into device:
 					if( initMap( dev, mapFile ) )
 					{
-						if( profile.toDevice( &dev ) == false ) 
+						if( profile.toDevice( &dev, bank ) == false ) 
 						{
 							fprintf( stderr, "Failed to load profile into device!\n" );
 							error = 1;
@@ -217,6 +265,29 @@ int main(int argc, char **argv)
 				}
 			}
 			
+			
+			// set bank cycling button, if asked to:
+			if( bankButton.empty() == false && error == 0 )
+			{
+				if( setBankButton( dev, bankButton, mapFile ) == false )
+					error = 1;
+			}
+			
+			
+			// switch banks, if asked to:
+			if( selectBank != JSMAPPER_BANK_ACTIVE && error == 0 )
+			{
+				printf( "Selecting bank %u...\n", selectBank );
+				if( dev.selectBank( selectBank ) == false )
+				{
+					fprintf( stderr, "Failed to select bank %u!\n", selectBank );
+					error = 1;
+				}
+			}
+			
+			if( showBanks && error == 0 )
+				printBanks( dev );
+			
 			dev.close();
 		}
 		else
@@ -270,6 +341,61 @@ bool initMap( jsmapper::Device &dev, std::string &mapFile )
 }
 
 
+bool setBankButton( jsmapper::Device &dev, const std::string &button, std::string &mapFile )
+{
+	int id = -1;
+	
+	if( button != "none" )
+	{
+		char * end = NULL;
+		id = strtol( button.c_str(), &end, 0 );
+		if( *end != 0 )
+		{
+			// not a number, look it up in the device map:
+			if( dev.getDeviceMap() == NULL )
+				initMap( dev, mapFile );
+			
+			jsmapper::ButtonID btnId = dev.getDeviceMap()->getButtonID( button );
+			if( btnId == jsmapper::INVALID_BUTTON_ID )
+			{
+				fprintf( stderr, "Unknown button '%s'!\n", button.c_str() );
+				return false;
+			}
+			id = btnId;
+		}
+	}
+	
+	printf( "Setting bank button to %i...\n", id );
+	if( dev.setBankButton( id ) == false )
+	{
+		fprintf( stderr, "Failed to set bank button!\n" );
+		return false;
+	}
+	
+	return true;
+}
+
+
+void printBanks( jsmapper::Device &dev )
+{
+	printf( "Active bank: %u\n", dev.getActiveBank() );
+	
+	printf( "Loaded banks:" );
+	std::vector<uint> banks = dev.getLoadedBanks();
+	for( size_t i = 0; i < banks.size(); i++ )
+		printf( " %u", banks[i] );
+	printf( "\n" );
+	
+	int button = dev.getBankButton();
+	if( button >= 0 )
+		printf( "Bank button: %i\n", button );
+	else
+		printf( "Bank button: none\n" );
+	
+	printf( "\n" );
+}
+
+
 void printAxes()
 {
     jsmapper::KeyMap * map = jsmapper::KeyMap::instance();
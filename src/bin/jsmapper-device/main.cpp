@@ -26,6 +26,8 @@
 
 #include <ncurses.h>
 
+#include <vector>
+
 #include <jsmapper/device.h>
 #include <jsmapper/devicemap.h>
 #include <jsmapper/log.h>
@@ -212,14 +214,43 @@ static const char * nameText		= "Device name     : %s\n";
 static const char * mapFileText		= "Device map file : %s\n";
 static const char * buttonsText		= "\nButtons:\n";
 static const char * axesText		= "\nAxes:\n";
+static const char * modeText		= "\nMode            : %i\n";
+static const char * lostText		= "Lost events     : %u\n";
+static const char * goneText		= "\n<Device disconnected!>\n";
 static const char * stopMsg			= "\nPress Ctrl+C to stop...\n\n";
 
+/**
+    \brief Prints current device values
+ */
+static void printValues( jsmapper::DeviceMap &map, const std::vector<int> &buttons, const std::vector<int> &axes, 
+						 int mode, unsigned int lost )
+{
+	printw( buttonsText );
+	for( jsmapper::ButtonID id = 0; id < buttons.size(); id++ )
+	{
+		std::string name = map.getButtonName( id );
+		printw( "%2i [%-12s]: %i\n", (int) id, name.c_str(), buttons[ id ] );
+	}
+	
+	printw( axesText );
+	for( jsmapper::AxisID id = 0; id < axes.size(); id++ )
+	{
+		std::string name = map.getAxisName( id );
+		printw( "%2i [%-12s]: %i\n", (int) id, name.c_str(), axes[ id ] );
+	}
+	
+	printw( modeText, mode );
+	if( lost )
+		printw( lostText, lost );
+}
+
+
 int viewMap( int deviceId, const std::string &file )
 {
     jsmapper::Log::getLog()->setLogLevel( jsmapper::Log::NONE );		// disable logging - interferes witg ncurses...
     initscr();
     
-    // loop until Ctrl+C is pressed:
+    // loop until Ctrl+C is pressed, reopening the device if it goes away:
     while( true )
     {
 		jsmapper::Device dev( deviceId );
@@ -236,41 +267,83 @@ int viewMap( int deviceId, const std::string &file )
             if( real_file.empty() )
                 real_file = jsmapper::DeviceMap::find( &dev );
             
-            if( real_file.empty() == false )
-            {
-				jsmapper::DeviceMap map( &dev );
-                if( map.load( real_file ) ) 
-                {
-                    printw( mapFileText, real_file.c_str() );
-                    
-                    printw( buttonsText );
-                    int numButtons = dev.getNumButtons();
-                    for( jsmapper::ButtonID id = 0; id < numButtons; id++ )
-                    {
-                        std::string name = map.getButtonName( id );
-                        int value = dev.getButtonValue( id );
-                        printw( "%2i [%-12s]: %i\n", (int) id, name.c_str(), value );
-                    }
-                    
-                    printw( axesText );
-                    int numAxes = dev.getNumAxes();
-                    for( jsmapper::AxisID id = 0; id < numAxes; id++ )
-                    {
-                        std::string name = map.getAxisName( id );
-                        int value = dev.getAxisValue( id );
-                        printw( "%2i [%-12s]: %i\n", (int) id, name.c_str(), value );
-                    }
-                }
-                else
-                {
-                    printw( mapFileText, "<Failed to load map file!>" );
-                }
-            }
-            else
-            {
+			jsmapper::DeviceMap map( &dev );
+            if( real_file.empty() )
                 printw( mapFileText, "<Failed to find a map file for device!>" );
-            }
-            
+            else if( !map.load( real_file ) ) 
+				printw( mapFileText, "<Failed to load map file!>" );
+			else
+            {
+				printw( mapFileText, real_file.c_str() );
+				
+				// initial values; the device event stream keeps them updated from here on:
+				jsmapper::DeviceState state;
+				dev.getState( state );
+				
+				std::vector<int> buttons( dev.getNumButtons() );
+				for( jsmapper::ButtonID id = 0; id < buttons.size(); id++ )
+					buttons[ id ] = state.getButtonValue( id );
+				
+				std::vector<int> axes( dev.getNumAxes() );
+				for( jsmapper::AxisID id = 0; id < axes.size(); id++ )
+					axes[ id ] = state.getAxisValue( id );
+				
+				int mode = 0;
+				std::vector<unsigned int> modes = state.getActiveModes();
+				if( !modes.empty() )
+					mode = modes.back();
+				
+				int y, x;
+				getyx( stdscr, y, x );
+				
+				unsigned int lost = 0;
+				std::vector<jsmapper::Event> events;
+				do
+				{
+					for( size_t n = 0; n < events.size(); n++ )
+					{
+						const jsmapper::Event &event = events[ n ];
+						switch( event.type )
+						{
+						case JSMAPPER_EVENT_INPUT:
+							if( event.target == JSMAPPER_PROFILE_TARGET_BUTTON && event.id < buttons.size() )
+								buttons[ event.id ] = event.value;
+							else if( event.target == JSMAPPER_PROFILE_TARGET_AXIS && event.id < axes.size() )
+								axes[ event.id ] = event.value;
+							break;
+							
+						case JSMAPPER_EVENT_MODE:
+							if( event.value )
+								mode = event.id;
+							else if( mode == event.id )
+								mode = 0;
+							break;
+							
+						case JSMAPPER_EVENT_PROFILE:
+							mode = 0;
+							break;
+							
+						case JSMAPPER_EVENT_OVERFLOW:
+							lost += event.value;
+							break;
+						}
+					}
+					events.clear();
+					
+					move( y, x );
+					clrtobot();
+					printValues( map, buttons, axes, mode, lost );
+					printw( stopMsg );
+					refresh();
+				}
+				while( dev.readEvents( events ) >= 0 );
+				
+				// device gone:
+				move( y, x );
+				clrtobot();
+				printw( goneText );
+			}
+			
             dev.close();
         }
         else
@@ -285,4 +358,3 @@ int viewMap( int deviceId, const std::string &file )
     endwin();
     return 0;
 }
-
@@ -5,6 +5,7 @@
 #include <jsmapper/buttonaction.h>
 #include <jsmapper/keyaction.h>
 #include <jsmapper/macroaction.h>
+#include <jsmapper/motionaction.h>
 #include <jsmapper/nullaction.h>
 #include <jsmapper/keymap.h>
 
@@ -221,6 +222,13 @@ QString /*static*/ ActionsModel::getActionText( const jsmapper::Action * action
 		break;
 	}
 	
+	case jsmapper::MotionActionType:
+	{
+		const jsmapper::MotionAction * motionAction = static_cast<const jsmapper::MotionAction *>( action );
+		result = tr( "Motion: %1" ).arg( QString::fromStdString( keyMap->getRelAxisSymbol( motionAction->getAxis() ) ) );
+		break;
+	}
+	
 	case jsmapper::NullActionType:
 		result = tr( "(none)" );
 		break;
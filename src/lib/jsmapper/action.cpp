@@ -26,6 +26,7 @@
 #include "buttonaction.h"
 #include "keyaction.h"
 #include "macroaction.h"
+#include "motionaction.h"
 #include "nullaction.h"
 
 #include "xmlhelpers.h"
@@ -194,6 +195,10 @@ namespace jsmapper
 		{
 			action = new NullAction();
 		}
+		else if( type == JSMAPPER_XML_TYPE_MOTION )
+		{
+			action = new MotionAction();
+		}
 		else
 			JSMAPPER_LOG_ERROR( "Invalid action type '%s'", type.c_str() );
 	
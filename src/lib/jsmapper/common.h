@@ -37,6 +37,8 @@ namespace jsmapper
 	// Basic types:
 	typedef unsigned int ButtonID;
 	typedef unsigned int AxisID;
+	/// Device event stream record (see Device::readEvents())
+	typedef struct t_JSMAPPER_EVENT Event;
 
 	extern const ButtonID	INVALID_BUTTON_ID;
 	extern const AxisID		INVALID_AXIS_ID;
@@ -61,6 +63,7 @@ namespace jsmapper
 		class ButtonCondition;
 	
 	class Profile;
+	class ProfileBlob;
 	
 	// Function types:
 	typedef bool (ENUMDEVICEMAPSPROC)( DeviceMap * map, void * data );
@@ -85,7 +88,9 @@ namespace jsmapper
 		/** Macro action */
 		MacroActionType = 4,
 		/** Null action */
-		NullActionType = 5
+		NullActionType = 5,
+		/** Proportional axis motion action */
+		MotionActionType = 6
 	} ActionType;
 	
 	
@@ -129,12 +134,24 @@ namespace jsmapper
 	#define JSMAPPER_XML_TAG_MODIFIERS			"modifiers"
     #define JSMAPPER_XML_TAG_STEP               "step"
 	#define JSMAPPER_XML_TAG_SPACING			"spacing"
+	#define JSMAPPER_XML_TAG_CENTER				"center"
+	#define JSMAPPER_XML_TAG_DEADZONE			"deadzone"
+	#define JSMAPPER_XML_TAG_RANGE				"range"
+	#define JSMAPPER_XML_TAG_MAXSTEP			"maxstep"
+	#define JSMAPPER_XML_TAG_CURVE				"curve"
+	#define JSMAPPER_XML_TAG_POLICY				"policy"
 
 	#define JSMAPPER_XML_TYPE_KEY				"key"
 	#define JSMAPPER_XML_TYPE_MACRO             "macro"
     #define JSMAPPER_XML_TYPE_AXIS				"axis"
 	#define JSMAPPER_XML_TYPE_BUTTON			"button"
 	#define JSMAPPER_XML_TYPE_NONE				"none"
+	#define JSMAPPER_XML_TYPE_MOTION			"motion"
+	
+	#define JSMAPPER_XML_POLICY_QUEUE			"queue"
+	#define JSMAPPER_XML_POLICY_RESTART			"restart"
+	#define JSMAPPER_XML_POLICY_IGNORE			"ignore"
+	#define JSMAPPER_XML_POLICY_CANCEL			"cancel"
 }
 
 #endif
@@ -29,21 +29,30 @@
 #include "condition.h"
 #include "xmlhelpers.h"
 #include "band.h"
+#include "profileblob.h"
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <dirent.h>
+#include <poll.h>
 #include <errno.h>
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 
 using namespace std;
 
 namespace jsmapper
 {
+	/// First driver API version supporting JMIOCCOMMIT
+	static const long COMMIT_API_VERSION = 0x010200;
+	
+	
 	class Device::Private
 	{
 	public:
@@ -122,7 +131,8 @@ namespace jsmapper
 			name = name.substr( pos + 1 );
 		}
 		if( name.length() > PREFIX_LENGTH
-				&& name.substr( 0, PREFIX_LENGTH ).compare( PREFIX ) == 0 )
+				&& name.substr( 0, PREFIX_LENGTH ).compare( PREFIX ) == 0
+				&& name.find_first_not_of( "0123456789", PREFIX_LENGTH ) == std::string::npos )
 		{
 			id = atoi( name.substr( PREFIX_LENGTH ).c_str() );
 		}
@@ -142,6 +152,35 @@ namespace jsmapper
 	}
 
 
+	std::vector<int> /*static*/ Device::enumerate( const std::string &dir /*= "/dev/input"*/ )
+	{
+		std::vector<int> ids;
+		struct stat st;
+
+		DIR * d = opendir( dir.c_str() );
+		if( d == NULL )
+		{
+			JSMAPPER_LOG_ERROR( "Failed to open directory '%s' (error %i: %s)", dir.c_str(), errno, strerror( errno ) );
+			return ids;
+		}
+
+		struct dirent * entry = NULL;
+		while( ( entry = readdir( d ) ) != NULL )
+		{
+			int id = getId( entry->d_name );
+			std::string path = dir + "/" + entry->d_name;
+			if( id >= 0 && stat( path.c_str(), &st ) == 0 && S_ISCHR(st.st_mode) )
+			{
+				ids.push_back( id );
+			}
+		}
+		closedir( d );
+
+		std::sort( ids.begin(), ids.end() );
+		return ids;
+	}
+
+
 	bool Device::open()
 	{
 		bool ret = false;
@@ -318,6 +357,86 @@ namespace jsmapper
 		return result;
     }
 
+	bool Device::getState( DeviceState &state )
+	{
+		bool result = false;
+		
+		if( open() ) 
+		{
+			int ret = ioctl( d->fd, JMIOCGSTATE, state.getData() );
+			if( ret == 0 )
+				result = true;
+			else
+				JSMAPPER_LOG_ERROR( "Failed to query device state (error %i: %s)", errno, strerror( errno ) );
+		
+			close();
+		}
+		
+		return result;
+	}
+
+	
+	//
+	// Event stream:
+	//
+	
+	int Device::getFd() const
+	{
+		return d->fd;
+	}
+	
+	
+	int Device::readEvents( std::vector<Event> &events, int timeout /*= -1*/ )
+	{
+		if( d->fd < 0 )
+		{
+			JSMAPPER_LOG_ERROR( "Device not open!" );
+			return -EBADF;
+		}
+		
+		struct pollfd pfd;
+		pfd.fd = d->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		
+		int ret = poll( &pfd, 1, timeout );
+		if( ret < 0 )
+		{
+			JSMAPPER_LOG_ERROR( "Failed to wait for device events (error %i: %s)", errno, strerror( errno ) );
+			return -errno;
+		}
+		if( ret == 0 )
+			return 0;
+		if( ( pfd.revents & POLLIN ) == 0 )
+		{
+			JSMAPPER_LOG_ERROR( "Device gone!" );
+			return -ENODEV;
+		}
+		
+		// read everything pending, in chunks:
+		Event buffer[ 64 ];
+		int count = 0;
+		do
+		{
+			ret = read( d->fd, buffer, sizeof( buffer ) );
+			if( ret > 0 )
+			{
+				int n = ret / sizeof( Event );
+				events.insert( events.end(), buffer, buffer + n );
+				count += n;
+			}
+		} 
+		while( ret == (int) sizeof( buffer ) && poll( &pfd, 1, 0 ) > 0 );
+		
+		if( ret < 0 && count == 0 )
+		{
+			JSMAPPER_LOG_ERROR( "Failed to read device events (error %i: %s)", errno, strerror( errno ) );
+			return -errno;
+		}
+		
+		return count;
+	}
+	
 	
 	//
 	// programming functions:
@@ -331,6 +450,11 @@ namespace jsmapper
 		{
 			JSMAPPER_LOG_DEBUG( "Clearing device..." );
 			int ret = ioctl( d->fd, JMIOCCLEAR );
+			
+			// newer drivers just clear pending programming, so make it the one in use:
+			if( ret == 0 && getVersion() >= COMMIT_API_VERSION )
+				ret = ioctl( d->fd, JMIOCCOMMIT );
+			
 			if( ret == 0 )
 			{
 				result = true;
@@ -456,6 +580,141 @@ namespace jsmapper
 	}
 
 
+	bool Device::loadProfile( ProfileBlob &blob, uint bank /*= JSMAPPER_BANK_ACTIVE*/ )
+	{
+		bool result = false;
+
+		if( open () )
+		{
+			struct t_JSMAPPER_PROFILE_LOAD load_p = { 0 };
+			load_p.data = (__u64) (uintptr_t) blob.getData();
+			load_p.size = blob.getSize();
+			load_p.bank = bank;
+
+			JSMAPPER_LOG_DEBUG( "Loading profile blob (%u modes, %u actions, %u bytes) into bank %u...", 
+								blob.getModeCount(), blob.getActionCount(), (uint) load_p.size, bank );
+			int err = ioctl( d->fd, JMIOCLOADPROFILE, &load_p );
+			if( err == 0 )
+			{
+				result = true;
+			}
+			else
+				JSMAPPER_LOG_ERROR( "Failed to load profile into device (error %i: %s)", errno, strerror( errno ) );
+
+			close();
+		}
+
+		return result;
+	}
+
+
+	//
+	// Profile banks:
+	//
+	
+	bool Device::selectBank( uint bank )
+	{
+		bool result = false;
+		
+		if( open() )
+		{
+			__u32 value = bank;
+			int err = ioctl( d->fd, JMIOCSBANK, &value );
+			if( err == 0 )
+				result = true;
+			else
+				JSMAPPER_LOG_ERROR( "Failed to select bank %u (error %i: %s)", bank, errno, strerror( errno ) );
+			
+			close();
+		}
+		
+		return result;
+	}
+	
+	uint Device::getActiveBank()
+	{
+		uint result = 0;
+		
+		if( open() )
+		{
+			struct t_JSMAPPER_BANKS banks_p = { 0 };
+			int err = ioctl( d->fd, JMIOCGBANKS, &banks_p );
+			if( err == 0 )
+				result = banks_p.active;
+			else
+				JSMAPPER_LOG_ERROR( "Failed to query device banks (error %i: %s)", errno, strerror( errno ) );
+			
+			close();
+		}
+		
+		return result;
+	}
+	
+	std::vector<uint> Device::getLoadedBanks()
+	{
+		std::vector<uint> result;
+		
+		if( open() )
+		{
+			struct t_JSMAPPER_BANKS banks_p = { 0 };
+			int err = ioctl( d->fd, JMIOCGBANKS, &banks_p );
+			if( err == 0 )
+			{
+				for( uint bank = 1; bank <= JSMAPPER_BANK_COUNT; bank++ )
+				{
+					if( banks_p.loaded & (1 << (bank - 1)) )
+						result.push_back( bank );
+				}
+			}
+			else
+				JSMAPPER_LOG_ERROR( "Failed to query device banks (error %i: %s)", errno, strerror( errno ) );
+			
+			close();
+		}
+		
+		return result;
+	}
+	
+	bool Device::setBankButton( int id )
+	{
+		bool result = false;
+		
+		if( open() )
+		{
+			__s32 value = id;
+			int err = ioctl( d->fd, JMIOCSBANKBUTTON, &value );
+			if( err == 0 )
+				result = true;
+			else
+				JSMAPPER_LOG_ERROR( "Failed to set bank button (error %i: %s)", errno, strerror( errno ) );
+			
+			close();
+		}
+		
+		return result;
+	}
+	
+	int Device::getBankButton()
+	{
+		int result = -1;
+		
+		if( open() )
+		{
+			struct t_JSMAPPER_BANKS banks_p = { 0 };
+			int err = ioctl( d->fd, JMIOCGBANKS, &banks_p );
+			if( err == 0 )
+				result = banks_p.button;
+			else
+				JSMAPPER_LOG_ERROR( "Failed to query device banks (error %i: %s)", errno, strerror( errno ) );
+			
+			close();
+		}
+		
+		return result;
+	}
+
+
+
 	uint Device::addMode( Condition * condition, uint parentModeId )
     {
         uint result = 0;
@@ -24,7 +24,9 @@
 #define __LIBJSMAPPER_DEVICE_H_
 
 #include "common.h"
+#include "devicestate.h"
 #include <string>
+#include <vector>
 
 namespace jsmapper
 {
@@ -59,6 +61,16 @@ namespace jsmapper
 		 */
 		static bool test( int id );
 
+		/**
+		 * \brief Returns the IDs of every jsmapper device present, in ascending order
+		 *
+		 * IDs are not contiguous: once the legacy range is exhausted, the driver gets dynamic minors, so devices must be 
+		 * found by looking at the device nodes actually present.
+		 *
+		 * \param dir Directory holding device nodes (only meant for testing)
+		 */
+		static std::vector<int> enumerate( const std::string &dir = "/dev/input" );
+
 		/**
 		 * \brief Opens device file
 		 */
@@ -134,13 +146,46 @@ namespace jsmapper
           */
         int getAxisValue( AxisID id );
         
+		/**
+		 * \brief Takes a snapshot of the whole device state: button & axis values, and active modes
+		 * 
+		 * Far cheaper than querying buttons & axes one by one, as it takes a single call to the driver. Requires 
+		 * driver API version 1.6.0 or newer.
+		 * 
+		 * \return true on success
+		 */
+		bool getState( DeviceState &state );
+        
         
+	// event stream:
+	public:
+		/**
+		 * \brief Returns device file descriptor, to wait for events along with other ones (poll(), select(), ...)
+		 * \return File descriptor if device is open, -1 otherwise
+		 */
+		int getFd() const;
+		
+		/**
+		 * \brief Reads pending records from device event stream
+		 * 
+		 * Every time the device is opened it gets its own event stream, holding raw button & axis changes, mode 
+		 * transitions, actions fired and profile changes since then. Device must be open, and kept open for as long 
+		 * as the stream is wanted. Requires driver API version 1.5.0 or newer.
+		 * 
+		 * \param events Vector the records are appended to
+		 * \param timeout Time to wait for records if none is pending, in ms (0: don't wait, <0: wait forever)
+		 * \return Number of records read (0 if timed out), <0 on error (i.e. the device went away)
+		 */
+		int readEvents( std::vector<Event> &events, int timeout = -1 );
+		
+		
 	// programming functions:
 	public:
 		/**
 		 * \brief Clears profile
 		 * 
-		 * Clears all button assignments, modes, axes, etc...
+		 * Clears all button assignments, modes, axes, etc... The device is left empty right away, so this isn't 
+		 * meant to start item by item programming on drivers supporting JMIOCLOADPROFILE.
 		 */
 		bool clear();
 
@@ -179,6 +224,62 @@ namespace jsmapper
 		  */
 		bool setAxisAction( uint modeId, AxisID axisId, const Band &band, Action * action );
 
+		/**
+		  \brief Loads a whole profile in a single step
+		  
+		  Replaces all device programming (modes, actions & profile name) with the contents of the given blob. 
+		  Requires driver API version 1.1.0 or newer.
+		  
+		  If a bank number is given, the profile is preloaded into that bank instead, leaving the profile in use 
+		  untouched unless the bank is the active one. Requires driver API version 1.8.0 or newer.
+		  
+		  \param blob Profile blob
+		  \param bank Bank number (1..JSMAPPER_BANK_COUNT), or JSMAPPER_BANK_ACTIVE for the active bank
+		  \return true if succesful, false otherwise
+		  */
+		bool loadProfile( ProfileBlob &blob, uint bank = JSMAPPER_BANK_ACTIVE );
+
+
+	// profile banks:
+	public:
+		/**
+		 * \brief Selects the active bank
+		 * 
+		 * Makes the profile preloaded in the given bank the one in use. Requires driver API version 1.8.0 or newer.
+		 * 
+		 * \param bank Bank number (1..JSMAPPER_BANK_COUNT)
+		 * \return true if succesful, false otherwise (i.e. if bank is empty)
+		 */
+		bool selectBank( uint bank );
+		
+		/**
+		 * \brief Returns the active bank number
+		 * \return Active bank number (1..JSMAPPER_BANK_COUNT), 0 if failed
+		 */
+		uint getActiveBank();
+		
+		/**
+		 * \brief Returns the numbers of the banks holding a profile
+		 */
+		std::vector<uint> getLoadedBanks();
+		
+		/**
+		 * \brief Sets the button cycling through the loaded banks
+		 * 
+		 * Every press of the button selects the next bank holding a profile right inside the driver, without 
+		 * any round-trip to user space. The button itself isn't seen by the profiles anymore.
+		 * 
+		 * \param id Button ID, -1 to disable bank cycling
+		 * \return true if succesful, false otherwise
+		 */
+		bool setBankButton( int id );
+		
+		/**
+		 * \brief Returns the button cycling through the loaded banks
+		 * \return Button ID, -1 if none (or failed)
+		 */
+		int getBankButton();
+
 	
 	public:
 		/**
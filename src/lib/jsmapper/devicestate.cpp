@@ -0,0 +1,102 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This file is part of JSMapper Library.
+ * 
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file devicestate.cpp
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ * \brief Implementation file for 'DeviceState' class
+ */
+
+#include "devicestate.h"
+
+#include <string.h>
+
+namespace jsmapper
+{
+	/// Tests a bit of a driver bitmap (32-bit words)
+	static inline bool testBit( const __u32 * bitmap, unsigned int bit )
+	{
+		return ( bitmap[ bit / 32 ] >> ( bit % 32 ) ) & 1;
+	}
+	
+	
+	DeviceState::DeviceState()
+	{
+		memset( &m_state, 0, sizeof( m_state ) );
+	}
+	
+	
+	unsigned int DeviceState::getSequence() const
+	{
+		return m_state.sequence;
+	}
+	
+	int DeviceState::getNumButtons() const
+	{
+		return m_state.button_count;
+	}
+	
+	int DeviceState::getButtonValue( ButtonID id ) const
+	{
+		if( id >= m_state.button_count )
+			return 0;
+		
+		return testBit( m_state.buttons, id ) ? 1 : 0;
+	}
+	
+	int DeviceState::getNumAxes() const
+	{
+		return m_state.axis_count;
+	}
+	
+	int DeviceState::getAxisValue( AxisID id ) const
+	{
+		if( id >= m_state.axis_count )
+			return 0;
+		
+		return m_state.axes[ id ];
+	}
+	
+	int DeviceState::getNumModes() const
+	{
+		return m_state.mode_count;
+	}
+	
+	bool DeviceState::isModeActive( unsigned int modeId ) const
+	{
+		if( modeId >= m_state.mode_count || modeId >= JSMAPPER_STATE_MODES )
+			return false;
+		
+		return testBit( m_state.modes, modeId );
+	}
+	
+	std::vector<unsigned int> DeviceState::getActiveModes() const
+	{
+		std::vector<unsigned int> modes;
+		for( unsigned int id = 0; id < m_state.mode_count && id < JSMAPPER_STATE_MODES; id++ )
+		{
+			if( testBit( m_state.modes, id ) )
+				modes.push_back( id );
+		}
+		
+		return modes;
+	}
+	
+	struct t_JSMAPPER_STATE * DeviceState::getData()
+	{
+		return &m_state;
+	}
+}
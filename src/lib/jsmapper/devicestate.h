@@ -0,0 +1,98 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This file is part of JSMapper Library.
+ * 
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file devicestate.h
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ * \brief Declaration file for 'DeviceState' class
+ */
+
+#ifndef __LIBJSMAPPER_DEVICESTATE_H_
+#define __LIBJSMAPPER_DEVICESTATE_H_
+
+#include "common.h"
+#include <vector>
+
+namespace jsmapper
+{
+	/**
+	 * \brief Snapshot of a device's state
+	 * 
+	 * Holds the values of all buttons & axes of a device, plus the modes active in its current profile, all taken at 
+	 * once. It's filled by Device::getState(), which costs a single call to the driver no matter how many buttons & 
+	 * axes the device has.
+	 * 
+	 * The sequence number changes every time the device state may have changed (on every input frame or profile 
+	 * change), so comparing two snapshots' sequence numbers is enough to know whether anything changed in between.
+	 */
+
+	class DeviceState
+	{
+	public:
+		DeviceState();
+
+	public:
+		/**
+		 * \brief Returns snapshot sequence number
+		 */
+		unsigned int getSequence() const;
+		
+		/**
+		 * \brief Returns number of buttons in the snapshot
+		 */
+		int getNumButtons() const;
+		
+		/**
+		 * \brief Returns button value (0: released, 1: pressed)
+		 */
+		int getButtonValue( ButtonID id ) const;
+		
+		/**
+		 * \brief Returns number of axes in the snapshot
+		 */
+		int getNumAxes() const;
+		
+		/**
+		 * \brief Returns axis value
+		 */
+		int getAxisValue( AxisID id ) const;
+		
+		/**
+		 * \brief Returns number of mode IDs in device's current profile
+		 */
+		int getNumModes() const;
+		
+		/**
+		 * \brief Checks whether a mode is active
+		 */
+		bool isModeActive( unsigned int modeId ) const;
+		
+		/**
+		 * \brief Returns the IDs of the active modes, in ascending order (root mode, ID 0, always included)
+		 */
+		std::vector<unsigned int> getActiveModes() const;
+		
+		/**
+		 * \brief Gives access to the underlying driver structure, to be filled in
+		 */
+		struct t_JSMAPPER_STATE * getData();
+		
+	private:
+		struct t_JSMAPPER_STATE m_state;
+	};
+}
+
+#endif // __LIBJSMAPPER_DEVICESTATE_H_
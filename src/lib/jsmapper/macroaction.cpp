@@ -39,15 +39,48 @@ namespace jsmapper
 		KeyList keys;
 		/// Keystroke spacing, in ms
 		uint spacing;
+		/// Re-trigger policy
+		Policy policy;
 
 	public:
 		Private()
-			: spacing( DefaultSpacing )
+			: spacing( DefaultSpacing ), 
+			  policy( DefaultPolicy )
 		{
 		}
 	};
 
     const int MacroAction::DefaultSpacing = 250;
+    const MacroAction::Policy MacroAction::DefaultPolicy = MacroAction::Queue;
+
+
+	/// Returns XML symbol for a policy
+	static const char * policyToXml( MacroAction::Policy policy )
+	{
+		switch( policy )
+		{
+		case MacroAction::Restart:	return JSMAPPER_XML_POLICY_RESTART;
+		case MacroAction::Ignore:	return JSMAPPER_XML_POLICY_IGNORE;
+		case MacroAction::Cancel:	return JSMAPPER_XML_POLICY_CANCEL;
+		default:					return JSMAPPER_XML_POLICY_QUEUE;
+		}
+	}
+
+	/// Returns policy for an XML symbol, or the default one if unknown
+	static MacroAction::Policy policyFromXml( const std::string &symbol )
+	{
+		if( symbol == JSMAPPER_XML_POLICY_RESTART )
+			return MacroAction::Restart;
+		else if( symbol == JSMAPPER_XML_POLICY_IGNORE )
+			return MacroAction::Ignore;
+		else if( symbol == JSMAPPER_XML_POLICY_CANCEL )
+			return MacroAction::Cancel;
+		else if( symbol == JSMAPPER_XML_POLICY_QUEUE || symbol.empty() )
+			return MacroAction::Queue;
+		
+		JSMAPPER_LOG_WARNING( "Unknown macro policy '%s', using default one", symbol.c_str() );
+		return MacroAction::DefaultPolicy;
+	}
 
 
 	//
@@ -107,6 +140,16 @@ namespace jsmapper
 		return d->spacing;
 	}
 
+	void MacroAction::setPolicy( Policy policy )
+	{
+		d->policy = policy;
+	}
+
+	MacroAction::Policy MacroAction::getPolicy() const
+	{
+		return d->policy;
+	}
+
 
 	//
 	// serialization
@@ -119,6 +162,7 @@ namespace jsmapper
 		{
 			xmlNewProp( node, BAD_CAST JSMAPPER_XML_TAG_TYPE, BAD_CAST JSMAPPER_XML_TYPE_MACRO );
 			xmlNewIntProp( node, BAD_CAST JSMAPPER_XML_TAG_SPACING, d->spacing );
+			xmlNewProp( node, BAD_CAST JSMAPPER_XML_TAG_POLICY, BAD_CAST policyToXml( d->policy ) );
 
 			xmlNodePtr nodeKeys = keysToXml();
 			if( nodeKeys )
@@ -136,6 +180,7 @@ namespace jsmapper
 		if( ret )
 		{
 			d->spacing = xmlGetIntProp( node, BAD_CAST JSMAPPER_XML_TAG_SPACING, d->spacing );
+			d->policy = policyFromXml( xmlGetStringProp( node, BAD_CAST JSMAPPER_XML_TAG_POLICY ) );
 			
 			xmlNodePtr subNode = node->children;
 			while( subNode && ret )
@@ -218,7 +263,8 @@ namespace jsmapper
 
 	struct t_JSMAPPER_ACTION * MacroAction::toDeviceAction( size_t &cbBuffer ) const
 	{
-        // allocate parameter struct, leaving enough room for key array:
+        // allocate parameter struct, leaving enough room for key array (the options following it, only read from 
+        // version 2 profile blobs, fit in the tail of the action struct):
         cbBuffer = sizeof( struct t_JSMAPPER_ACTION ) + sizeof ( struct t_JSMAPPER_KEY ) * d->keys.size();
 		struct t_JSMAPPER_ACTION * buffer = (struct t_JSMAPPER_ACTION *) malloc( cbBuffer );
 		if( buffer )
@@ -239,6 +285,9 @@ namespace jsmapper
                 buffer->data.macro.keys[i++] = k;
             }
             buffer->data.macro.count = d->keys.size();
+            
+            struct t_JSMAPPER_MACRO_OPTIONS * options = (struct t_JSMAPPER_MACRO_OPTIONS *) &buffer->data.macro.keys[i];
+            options->policy = d->policy;
 		}
 		else
 			JSMAPPER_LOG_ERROR( "Failed to allocate buffer!" );
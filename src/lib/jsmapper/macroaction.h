@@ -46,6 +46,26 @@ namespace jsmapper
 		/// Default key spacing, in ms
 		static const int DefaultSpacing;
 
+		/**
+		  \brief Re-trigger policy
+
+		  Defines what happens when the macro gets activated again while it's still being played.
+		  */
+		enum Policy
+		{
+			/// A new run is queued after the current one
+			Queue = JSMAPPER_MACRO_QUEUE,
+			/// The macro starts over from its first key
+			Restart = JSMAPPER_MACRO_RESTART,
+			/// Nothing happens
+			Ignore = JSMAPPER_MACRO_IGNORE,
+			/// Like Restart, but the macro is also stopped when the button is released
+			Cancel = JSMAPPER_MACRO_CANCEL
+		};
+
+		/// Default re-trigger policy (Queue)
+		static const Policy DefaultPolicy;
+
 	public:
 		MacroAction( const std::string &name = std::string(),
 						   bool filter = true,
@@ -94,6 +114,19 @@ namespace jsmapper
 		  */
 		uint getSpacing() const;
 
+		/**
+		  \brief Sets re-trigger policy
+
+		  Default value is Queue.
+		  */
+		void setPolicy( Policy policy );
+
+		/**
+		  \brief Returns re-trigger policy
+		  \see setPolicy()
+		  */
+		Policy getPolicy() const;
+
 
 	// serialization:
 	public:
@@ -29,6 +29,7 @@
 #include "devicemap.h"
 #include "xmlhelpers.h"
 #include "band.h"
+#include "profileblob.h"
 
 #include <stdlib.h>
 
@@ -635,6 +636,87 @@ namespace jsmapper
     }
 
 
+	bool Mode::toBlob( Device * dev, ProfileBlob &blob, uint parentIndex /*= 0*/ )
+	{
+		bool result = true;
+		uint index = 0;
+		
+		DeviceMap * map = dev->getDeviceMap();
+		
+		// add mode record, unless this is the root mode:
+		if( d->parent != NULL )
+		{
+			struct t_JSMAPPER_MODE mode_p = { 0 };
+			if( d->condition && d->condition->toDeviceCondition( dev, &mode_p ) )
+			{
+				index = blob.addMode( mode_p, parentIndex );
+			}
+			
+			if( index == 0 )
+			{
+				JSMAPPER_LOG_ERROR( "Failed to add mode \"%s\" to profile blob - aborting!", d->name.c_str() );
+				return false;
+			}
+		}
+		
+		// button assignments:
+		ButtonsActionsMap::const_iterator itBtn = d->buttonActions.begin();
+		while( itBtn != d->buttonActions.end() && result )
+		{
+			const std::string &id = (*itBtn).first;
+			const std::string &action = (*itBtn++).second;
+			
+			ButtonID realId = map->getButtonID( id );
+			if( realId != INVALID_BUTTON_ID )
+			{
+				Action * pAction = d->profile->getAction( action );
+				if( pAction )
+					result = blob.addButtonAction( index, realId, pAction );
+				else
+					JSMAPPER_LOG_ERROR( "Unknown action '%s'!", action.c_str() );
+			}
+			else
+				JSMAPPER_LOG_ERROR( "Unknown button ID=%s!", id.c_str() );
+		}
+		
+		// axes assignments:
+		AxesActionsMap::const_iterator itAxis = d->axesActions.begin();
+		while( itAxis != d->axesActions.end() && result )
+		{
+			const std::string &id = (*itAxis).first;
+			const AxisBandActionsList &actions = (*itAxis++).second;
+			
+			AxisID realId = map->getAxisID( id );
+			if( realId != INVALID_AXIS_ID )
+			{
+				AxisBandActionsList::const_iterator it = actions.begin();
+				while( it != actions.end() && result )
+				{
+					const AxisBandAction &assign = (*it++);
+					
+					Action * pAction = d->profile->getAction( assign.m_action );
+					if( pAction )
+						result = blob.addAxisAction( index, realId, assign.m_band, pAction );
+					else
+						JSMAPPER_LOG_ERROR( "Unknown action '%s'!", assign.m_action.c_str() );
+				}
+			}
+			else
+				JSMAPPER_LOG_ERROR( "Unknown axis ID=%s!", id.c_str() );
+		}
+		
+		// finally, submodes:
+		ModeList::iterator it = d->children.begin();
+		while( it != d->children.end() && result )
+		{
+			Mode * mode = *it++;
+			result = mode->toBlob( dev, blob, index );
+		}
+		
+		return result;
+	}
+
+
 	bool Mode::buttonsToDevice( Device * dev )
 	{
 		bool result = true;
@@ -267,6 +267,15 @@ namespace jsmapper
           assigned when it was loaded into the device, so child modes can refer to it.
           */
         uint getModeId() const;
+        
+        /**
+          \brief Adds mode, its assignments and all its submodes to a profile blob
+          
+          \param dev Device the blob is built for, used to resolve button & axis names
+          \param blob Target profile blob
+          \param parentIndex Blob index of parent mode. Ignored for root mode, which always gets index 0.
+          */
+        bool toBlob( Device * dev, ProfileBlob &blob, uint parentIndex = 0 );
 
 
 	protected:
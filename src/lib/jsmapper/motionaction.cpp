@@ -0,0 +1,252 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This file is part of JSMapper Library.
+ * 
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file motionaction.cpp
+ * \brief Implementation file for proportional axis motion simulation class
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include "motionaction.h"
+#include "keymap.h"
+#include "xmlhelpers.h"
+#include "log.h"
+
+#include <string.h>
+
+namespace jsmapper
+{
+    const uint MotionAction::DefaultAxis = REL_X;
+    const int MotionAction::DefaultCenter = 0;
+    const int MotionAction::DefaultDeadzone = 1024;
+    const int MotionAction::DefaultRange = 32767;
+    const int MotionAction::DefaultMaxStep = 10;
+    const uint MotionAction::DefaultCurve = 0;      // %
+    const uint MotionAction::DefaultSpacing = 10;   // ms
+
+    /**
+      * \brief Private implementation class
+      */
+    class MotionAction::Private
+    {
+    public:
+        uint axis;
+        int center;
+        int deadzone;
+        int range;
+        int maxStep;
+        uint curve;
+        uint spacing;
+        
+    public:
+        Private()
+            : axis( DefaultAxis ), 
+              center( DefaultCenter ), 
+              deadzone( DefaultDeadzone ), 
+              range( DefaultRange ), 
+              maxStep( DefaultMaxStep ), 
+              curve( DefaultCurve ), 
+              spacing( DefaultSpacing )
+        {
+        }
+    };
+    
+    
+    //
+    
+    MotionAction::MotionAction( const std::string& name /*= std::string()*/, 
+                                uint axis /*= REL_X*/, 
+                                int maxStep /*= DefaultMaxStep*/, 
+                                uint spacing /*= DefaultSpacing*/, 
+                                bool filter /*= true*/, 
+                                const std::string description /*= std::string()*/ )
+        : Action( MotionActionType, name, filter, description )
+    {
+        d = new Private();
+        d->axis = axis;
+        d->maxStep = maxStep;
+        d->spacing = spacing;
+    }
+    
+    MotionAction::~MotionAction()
+    {
+        if( d ) 
+        {
+            delete d;
+            d = NULL;
+        }
+    }
+    
+    
+    //
+    
+    uint MotionAction::getAxis() const
+    {
+        return d->axis;
+    }
+    
+    void MotionAction::setAxis( uint axis )
+    {
+        d->axis = axis;
+    }
+    
+    
+    //
+    
+    int MotionAction::getCenter() const
+    {
+        return d->center;
+    }
+    
+    void MotionAction::setCenter( int center )
+    {
+        d->center = center;
+    }
+    
+    int MotionAction::getDeadzone() const
+    {
+        return d->deadzone;
+    }
+    
+    void MotionAction::setDeadzone( int deadzone )
+    {
+        d->deadzone = deadzone;
+    }
+    
+    int MotionAction::getRange() const
+    {
+        return d->range;
+    }
+    
+    void MotionAction::setRange( int range )
+    {
+        d->range = range;
+    }
+    
+
+    //     
+    
+    int MotionAction::getMaxStep() const
+    {
+        return d->maxStep;
+    }
+    
+    void MotionAction::setMaxStep( int step )
+    {
+        d->maxStep = step;
+    }
+    
+    uint MotionAction::getCurve() const
+    {
+        return d->curve;
+    }
+    
+    void MotionAction::setCurve( uint curve )
+    {
+        d->curve = curve > 100 ? 100 : curve;
+    }
+
+
+    //
+    
+    uint MotionAction::getSpacing() const
+    {
+        return d->spacing;
+    }
+    
+    void MotionAction::setSpacing( uint spacing )
+    {
+        d->spacing = spacing;
+    }
+    
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    //
+    // Serialization
+    //
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    
+    xmlNodePtr /*virtual*/ MotionAction::toXml() const
+    {
+        xmlNodePtr node = Action::toXml();
+        if( node )
+        {
+            xmlNewProp( node, BAD_CAST JSMAPPER_XML_TAG_TYPE, BAD_CAST JSMAPPER_XML_TYPE_MOTION );
+            
+            xmlNewProp( node, BAD_CAST JSMAPPER_XML_TAG_AXIS, BAD_CAST KeyMap::instance()->getRelAxisSymbol( d->axis ).c_str() );
+            xmlNewIntProp( node, BAD_CAST JSMAPPER_XML_TAG_CENTER, d->center );
+            xmlNewIntProp( node, BAD_CAST JSMAPPER_XML_TAG_DEADZONE, d->deadzone );
+            xmlNewIntProp( node, BAD_CAST JSMAPPER_XML_TAG_RANGE, d->range );
+            xmlNewIntProp( node, BAD_CAST JSMAPPER_XML_TAG_MAXSTEP, d->maxStep );
+            xmlNewIntProp( node, BAD_CAST JSMAPPER_XML_TAG_CURVE, d->curve );
+            xmlNewIntProp( node, BAD_CAST JSMAPPER_XML_TAG_SPACING, d->spacing );
+        }
+        
+        return node;
+    }
+    
+    bool /*virtual*/ MotionAction::fromXml( xmlNodePtr node )
+    {
+        bool ret = Action::fromXml( node );
+		if( ret )
+		{
+			d->axis = KeyMap::instance()->getRelAxisId( xmlGetStringProp( node, BAD_CAST JSMAPPER_XML_TAG_AXIS ) );
+            d->center = xmlGetIntProp( node, BAD_CAST JSMAPPER_XML_TAG_CENTER, d->center );
+            d->deadzone = xmlGetIntProp( node, BAD_CAST JSMAPPER_XML_TAG_DEADZONE, d->deadzone );
+            d->range = xmlGetIntProp( node, BAD_CAST JSMAPPER_XML_TAG_RANGE, d->range );
+            d->maxStep = xmlGetIntProp( node, BAD_CAST JSMAPPER_XML_TAG_MAXSTEP, d->maxStep );
+            setCurve( xmlGetIntProp( node, BAD_CAST JSMAPPER_XML_TAG_CURVE, d->curve ) );
+            d->spacing = xmlGetIntProp( node, BAD_CAST JSMAPPER_XML_TAG_SPACING, d->spacing );
+		}
+		
+		return ret;
+    }
+
+    
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    //
+    // Loading into device
+    //
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    
+    struct t_JSMAPPER_ACTION * /*virtual*/ MotionAction::toDeviceAction( size_t &cbBuffer ) const
+    {
+        // motion parameters don't fit the action data union, so they follow the action struct:
+        cbBuffer = sizeof( struct t_JSMAPPER_ACTION ) + sizeof( struct t_JSMAPPER_MOTION );
+		struct t_JSMAPPER_ACTION * buffer = (struct t_JSMAPPER_ACTION *) malloc( cbBuffer );
+		if( buffer )
+		{
+			memset( buffer, 0, cbBuffer );
+			
+			buffer->type                    = JSMAPPER_ACTION_MOTION;
+			buffer->filter                  = filter();
+			
+			struct t_JSMAPPER_MOTION * motion = (struct t_JSMAPPER_MOTION *) ( buffer + 1 );
+			motion->id                      = getAxis();
+            motion->spacing                 = getSpacing();
+            motion->center                  = getCenter();
+            motion->deadzone                = getDeadzone();
+            motion->range                   = getRange();
+            motion->max_step                = getMaxStep();
+            motion->curve                   = getCurve() * 32768 / 100;    // % to Q15
+		}
+		else
+			JSMAPPER_LOG_ERROR( "Failed to allocate buffer!" );
+		
+		return buffer;
+    }
+
+}
@@ -0,0 +1,187 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This file is part of JSMapper Library.
+ * 
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file motionaction.h
+ * \brief Declaration file for proportional axis motion simulation class
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#ifndef __JSMAPPERLIB_MOTION_ACTION_H_
+#define __JSMAPPERLIB_MOTION_ACTION_H_
+
+#include "action.h"
+namespace jsmapper
+{
+	/**
+	 * \brief Proportional axis motion simulation action
+     *
+     * This action moves a relative axis (REL_xxx constants) at a speed proportional to the deflection of the 
+     * joystick axis it's assigned to, as a mouse driven by a stick. It can only be assigned to axis bands: it 
+     * keeps moving as long as the axis stays inside the band.
+     *
+     * Deflection is measured from the center value. Deflections up to the deadzone produce no movement, and the 
+     * speed then grows up to the maximum step, reached at the range deflection. The curve blends linear (0%) and 
+     * quadratic (100%) responses.
+	 */
+	class MotionAction: public Action
+	{
+    public:
+        /// Default axis (X)
+        static const uint DefaultAxis;
+        /// Default center value (0)
+        static const int  DefaultCenter;
+        /// Default deadzone (1024)
+        static const int  DefaultDeadzone;
+        /// Default range (32767)
+        static const int  DefaultRange;
+        /// Default maximum step value (10)
+        static const int  DefaultMaxStep;
+        /// Default curve, in % (0)
+        static const uint DefaultCurve;
+        /// Default spacing between steps value, in ms (10)
+        static const uint DefaultSpacing;
+        
+
+	public:
+		/**
+		 * \brief Action constructor
+		 * 
+		 * \sa setAxis, setMaxStep, setSpacing
+		 */
+		MotionAction( const std::string& name = std::string(), 
+                        uint axis = DefaultAxis, 
+                        int maxStep = DefaultMaxStep, 
+                        uint spacing = DefaultSpacing, 
+						bool filter = true, 
+						const std::string description = std::string() );
+		
+		virtual ~MotionAction();
+		
+	public:
+		/**
+		 * \brief Returns action's relative axis
+		 * \sa setAxis
+		 */
+		uint getAxis() const;
+		
+		/**
+		 * \brief Sets the relative axis ID to be simulated (REL_xxx constants)
+		 */
+		void setAxis( uint axis );
+		
+		
+		/**
+		 * \brief Returns source axis value at rest
+		 */
+		int getCenter() const;
+		
+		/**
+		 * \brief Sets source axis value at rest
+		 */
+		void setCenter( int center );
+		
+		
+		/**
+		 * \brief Returns the deflection producing no movement
+		 */
+		int getDeadzone() const;
+		
+		/**
+		 * \brief Sets the deflection from center producing no movement, in source axis units
+		 */
+		void setDeadzone( int deadzone );
+		
+		
+		/**
+		 * \brief Returns the deflection producing full speed
+		 */
+		int getRange() const;
+		
+		/**
+		 * \brief Sets the deflection from center producing full speed, in source axis units
+		 */
+		void setRange( int range );
+		
+        
+        /**
+		 * \brief Returns maximum step value
+		 * \sa setMaxStep
+		 */
+		int getMaxStep() const;
+		
+		/**
+		 * \brief Sets maximum step value
+		 * 
+		 * Sets the number of axis units moved per step at full deflection. Negative values invert direction.
+		 */
+		void setMaxStep( int step );
+		
+		
+		/**
+		 * \brief Returns response curve, in %
+		 * \sa setCurve
+		 */
+		uint getCurve() const;
+		
+		/**
+		 * \brief Sets response curve, from 0% (linear) up to 100% (quadratic)
+		 */
+		void setCurve( uint curve );
+
+        
+        /**
+		 * \brief Returns spacing between steps, in ms 
+		 * \sa setSpacing
+		 */
+		uint getSpacing() const;
+		
+		/**
+		 * \brief Sets spacing between steps, in ms
+		 */
+		void setSpacing( uint spacing );
+        
+		
+	public:
+		/**
+		 * \brief Saves action to an XML node and returns it
+		 */
+		virtual xmlNodePtr toXml() const;
+		
+		/**
+		 * \brief Restores action from an XML node
+		 */
+		virtual bool fromXml( xmlNodePtr node );
+
+		
+	public:
+		/**
+		 * \brief Creates device action struct
+		 * 
+		 * This function is invoked by profile loader in order to create the memory struct needed that will be sent 
+		 * to the driver, in order to load the action associated with the axis band into the device.
+		 */
+		virtual struct t_JSMAPPER_ACTION * toDeviceAction( size_t &cbBuffer ) const;
+
+
+	private:
+		class Private;
+		Private * d;
+	};
+}
+
+#endif
+
@@ -25,6 +25,7 @@
 #include "log.h"
 #include "device.h"
 #include "action.h"
+#include "profileblob.h"
 #include "xmlhelpers.h"
 
 #include <string.h>
@@ -412,32 +413,81 @@ namespace jsmapper
     // Device interaction
     //
     
-    bool Profile::toDevice( Device * dev )
+    /// First driver API version supporting version 2 profile blobs
+    static const long BLOB_V2_API_VERSION = 0x010400;
+    
+    bool Profile::toBlob( Device * dev, ProfileBlob &blob )
+    {
+        bool ret = false;
+        
+        blob.clear();
+        blob.setName( d->name );
+        
+        // older drivers reject blobs newer than version 1:
+        if( dev->getVersion() < BLOB_V2_API_VERSION )
+            blob.setVersion( 1 );
+        else
+            blob.setVersion( JSMAPPER_PROFILE_VERSION );
+        
+        Mode * mode = getRootMode();
+        if( mode )
+        {
+            ret = mode->toBlob( dev, blob );
+        }
+        else
+            JSMAPPER_LOG_WARNING( "No root mode to load!" );
+        
+        return ret;
+    }
+    
+    
+    /// First driver API version supporting JMIOCLOADPROFILE
+    static const long LOADPROFILE_API_VERSION = 0x010100;
+    /// First driver API version supporting profile banks
+    static const long BANKS_API_VERSION = 0x010800;
+    
+    bool Profile::toDevice( Device * dev, uint bank /*= JSMAPPER_BANK_ACTIVE*/ )
     {
         bool ret = false;
         
-        // clear device first:
         if( dev->open() )
         {
-            // clear device first:
-            JSMAPPER_LOG_DEBUG( "Clearing device..." );
-            dev->clear();
-            
-            // enter load mode:
-            Mode * mode = getRootMode();
-            if( mode )
+            if( bank != JSMAPPER_BANK_ACTIVE && dev->getVersion() < BANKS_API_VERSION )
             {
-                JSMAPPER_LOG_DEBUG( "Loading root mode into device..." );
-                ret = mode->toDevice( dev );
+                JSMAPPER_LOG_ERROR( "Driver doesn't support profile banks" );
+            }
+            else if( dev->getVersion() >= LOADPROFILE_API_VERSION )
+            {
+                // load whole profile in a single step:
+                ProfileBlob blob;
+                if( toBlob( dev, blob ) )
+                {
+                    JSMAPPER_LOG_DEBUG( "Loading profile blob into device..." );
+                    ret = dev->loadProfile( blob, bank );
+                }
             }
             else
-                JSMAPPER_LOG_WARNING( "No root mode to load!" );
-            
-			// finally, if succesful set loaded profile name:
-			if( ret )
-			{
-				ret = dev->setProfileName( d->name );
-			}
+            {
+                // older drivers: clear device first, then load item by item:
+                JSMAPPER_LOG_DEBUG( "Clearing device..." );
+                dev->clear();
+                
+                // enter load mode:
+                Mode * mode = getRootMode();
+                if( mode )
+                {
+                    JSMAPPER_LOG_DEBUG( "Loading root mode into device..." );
+                    ret = mode->toDevice( dev );
+                }
+                else
+                    JSMAPPER_LOG_WARNING( "No root mode to load!" );
+                
+                // finally, if succesful set loaded profile name:
+                if( ret )
+                {
+                    ret = dev->setProfileName( d->name );
+                }
+            }
 
             dev->close();
         }
@@ -190,8 +190,22 @@ namespace jsmapper
 		 * 
 		 * This function will load all profile mappings into the device. It will clear the device first, then load 
          * all the modes, mappings, etc... into the device.
+		 * 
+		 * If a bank number is given the profile is preloaded into that bank instead, so it can be switched to 
+		 * later on with Device::selectBank(). This requires driver API version 1.8.0 or newer.
+		 * 
+		 * \param dev Device to load the profile into
+		 * \param bank Bank number (1..JSMAPPER_BANK_COUNT), or JSMAPPER_BANK_ACTIVE for the active bank
+		 */
+        bool toDevice( Device * dev, uint bank = JSMAPPER_BANK_ACTIVE );
+        
+        /**
+		 * \brief Serializes profile into a blob
+		 * 
+		 * Builds the compact profile representation loaded by Device::loadProfile(), resolving button & axis 
+		 * names using the given device's map.
 		 */
-        bool toDevice( Device * dev );
+        bool toBlob( Device * dev, ProfileBlob &blob );
         
         
 	private:
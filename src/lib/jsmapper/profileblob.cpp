@@ -0,0 +1,242 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This file is part of JSMapper Library.
+ *
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file profileblob.cpp
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ * \brief Implementation file for 'ProfileBlob' class
+ */
+
+#include "profileblob.h"
+#include "action.h"
+#include "band.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+
+namespace jsmapper
+{
+	/// Rounds a size up to the blob record alignment (4 bytes)
+	static inline size_t align4( size_t size )
+	{
+		return ( size + 3 ) & ~((size_t) 3);
+	}
+
+
+	class ProfileBlob::Private
+	{
+	public:
+		/// Blob format version
+		uint version;
+		/// Profile name
+		std::string name;
+		/// Mode records, in index order (root excluded)
+		std::vector<struct t_JSMAPPER_MODE> modes;
+		/// Serialized action records
+		std::vector<char> actions;
+		/// Number of action records
+		uint actionCount;
+		/// Whole serialized blob, built on demand
+		std::vector<char> data;
+
+	public:
+		Private()
+			: version( JSMAPPER_PROFILE_VERSION ), actionCount( 0 )
+		{
+		}
+
+		bool addAction( uint modeIndex, __u16 target, struct t_JSMAPPER_ACTION * buffer, size_t cbBuffer )
+		{
+			size_t cbRecord = align4( offsetof( struct t_JSMAPPER_PROFILE_ACTION, action ) + cbBuffer );
+			if( cbRecord > 0xFFFF )
+			{
+				JSMAPPER_LOG_ERROR( "Action too big for a profile blob record (%u bytes)!", (uint) cbRecord );
+				return false;
+			}
+
+			size_t pos = actions.size();
+			actions.resize( pos + cbRecord, 0 );
+
+			struct t_JSMAPPER_PROFILE_ACTION * record = (struct t_JSMAPPER_PROFILE_ACTION *) &actions[ pos ];
+			record->size = cbRecord;
+			record->target = target;
+			memcpy( &record->action, buffer, cbBuffer );
+			record->action.mode_id = modeIndex;
+
+			actionCount++;
+			return true;
+		}
+	};
+
+
+	ProfileBlob::ProfileBlob()
+	{
+		d = new Private();
+	}
+
+	ProfileBlob::~ProfileBlob()
+	{
+		delete d;
+		d = NULL;
+	}
+
+
+	void ProfileBlob::clear()
+	{
+		d->name.clear();
+		d->modes.clear();
+		d->actions.clear();
+		d->actionCount = 0;
+		d->data.clear();
+	}
+
+	void ProfileBlob::setName( const std::string &name )
+	{
+		d->name = name;
+		if( d->name.length() > 0xFFFF )
+		{
+			JSMAPPER_LOG_WARNING( "Profile name too long, truncating it!" );
+			d->name.resize( 0xFFFF );
+		}
+	}
+
+
+	void ProfileBlob::setVersion( uint version )
+	{
+		d->version = version;
+	}
+
+	uint ProfileBlob::getVersion() const
+	{
+		return d->version;
+	}
+
+
+	uint ProfileBlob::addMode( const struct t_JSMAPPER_MODE &mode, uint parentIndex )
+	{
+		if( parentIndex > d->modes.size() )
+		{
+			JSMAPPER_LOG_ERROR( "Invalid parent mode index (%u)!", parentIndex );
+			return 0;
+		}
+		if( d->modes.size() >= 0xFFFF )
+		{
+			JSMAPPER_LOG_ERROR( "Too many modes for a profile blob!" );
+			return 0;
+		}
+
+		struct t_JSMAPPER_MODE record = mode;
+		record.mode_id = d->modes.size() + 1;
+		record.parent_mode_id = parentIndex;
+		d->modes.push_back( record );
+
+		return record.mode_id;
+	}
+
+
+	bool ProfileBlob::addButtonAction( uint modeIndex, ButtonID btnId, const Action * action )
+	{
+		bool result = false;
+
+		size_t cbBuffer = 0;
+		struct t_JSMAPPER_ACTION * buffer = action->toDeviceAction( cbBuffer );
+		if( buffer )
+		{
+			buffer->button.id = btnId;
+			result = d->addAction( modeIndex, JSMAPPER_PROFILE_TARGET_BUTTON, buffer, cbBuffer );
+			free( buffer );
+		}
+		else
+			JSMAPPER_LOG_ERROR( "Failed to allocate buffer for action!" );
+
+		return result;
+	}
+
+	bool ProfileBlob::addAxisAction( uint modeIndex, AxisID axisId, const Band &band, const Action * action )
+	{
+		bool result = false;
+
+		size_t cbBuffer = 0;
+		struct t_JSMAPPER_ACTION * buffer = action->toDeviceAction( cbBuffer );
+		if( buffer )
+		{
+			buffer->axis.id = axisId;
+			buffer->axis.low = band.m_low;
+			buffer->axis.high = band.m_high;
+			result = d->addAction( modeIndex, JSMAPPER_PROFILE_TARGET_AXIS, buffer, cbBuffer );
+			free( buffer );
+		}
+		else
+			JSMAPPER_LOG_ERROR( "Failed to allocate buffer for action!" );
+
+		return result;
+	}
+
+
+	uint ProfileBlob::getModeCount() const
+	{
+		return d->modes.size();
+	}
+
+	uint ProfileBlob::getActionCount() const
+	{
+		return d->actionCount;
+	}
+
+
+	size_t ProfileBlob::getSize() const
+	{
+		return sizeof( struct t_JSMAPPER_PROFILE_HEADER )
+				+ align4( d->name.length() )
+				+ sizeof( struct t_JSMAPPER_MODE ) * d->modes.size()
+				+ d->actions.size();
+	}
+
+	const void * ProfileBlob::getData()
+	{
+		d->data.assign( getSize(), 0 );
+		char * p = &d->data[ 0 ];
+
+		struct t_JSMAPPER_PROFILE_HEADER * header = (struct t_JSMAPPER_PROFILE_HEADER *) p;
+		header->magic = JSMAPPER_PROFILE_MAGIC;
+		header->version = d->version;
+		header->name_length = d->name.length();
+		header->size = d->data.size();
+		header->mode_count = d->modes.size();
+		header->action_count = d->actionCount;
+		p += sizeof( struct t_JSMAPPER_PROFILE_HEADER );
+
+		memcpy( p, d->name.data(), d->name.length() );
+		p += align4( d->name.length() );
+
+		if( !d->modes.empty() )
+		{
+			memcpy( p, &d->modes[ 0 ], sizeof( struct t_JSMAPPER_MODE ) * d->modes.size() );
+			p += sizeof( struct t_JSMAPPER_MODE ) * d->modes.size();
+		}
+
+		if( !d->actions.empty() )
+		{
+			memcpy( p, &d->actions[ 0 ], d->actions.size() );
+		}
+
+		return &d->data[ 0 ];
+	}
+}
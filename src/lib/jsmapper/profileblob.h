@@ -0,0 +1,117 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This file is part of JSMapper Library.
+ *
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file profileblob.h
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ * \brief Declaration file for 'ProfileBlob' class
+ */
+
+#ifndef __LIBJSMAPPER_PROFILEBLOB_H_
+#define __LIBJSMAPPER_PROFILEBLOB_H_
+
+#include "common.h"
+#include <string>
+
+namespace jsmapper
+{
+	/**
+	 * \brief Serialized profile
+	 *
+	 * This class builds the compact profile blob (see t_JSMAPPER_PROFILE_HEADER in jsmapper_api.h) used to load
+	 * a whole profile into the device with a single JMIOCLOADPROFILE call. Modes are identified by their index
+	 * inside the blob: the root mode is always 0, and every mode added gets the next one.
+	 */
+	class ProfileBlob
+	{
+	public:
+		ProfileBlob();
+		virtual ~ProfileBlob();
+
+	public:
+		/**
+		 * \brief Removes all modes & actions, and clears profile name
+		 */
+		void clear();
+
+		/**
+		 * \brief Sets profile name
+		 */
+		void setName( const std::string &name );
+
+		/**
+		 * \brief Sets blob format version (JSMAPPER_PROFILE_VERSION by default)
+		 *
+		 * Drivers older than API version 1.4.0 only accept version 1 blobs, where macro options are ignored.
+		 */
+		void setVersion( uint version );
+
+		/**
+		 * \brief Returns blob format version
+		 */
+		uint getVersion() const;
+
+		/**
+		 * \brief Adds a new mode
+		 *
+		 * \param mode Mode definition. Only condition fields are used, mode & parent IDs are set by the blob.
+		 * \param parentIndex Index of parent mode, which must be already added (0 for root mode)
+		 * \return Index assigned to new mode, or 0 if failed
+		 */
+		uint addMode( const struct t_JSMAPPER_MODE &mode, uint parentIndex );
+
+		/**
+		 * \brief Adds a button action record
+		 */
+		bool addButtonAction( uint modeIndex, ButtonID btnId, const Action * action );
+
+		/**
+		 * \brief Adds an axis band action record
+		 */
+		bool addAxisAction( uint modeIndex, AxisID axisId, const Band &band, const Action * action );
+
+		/**
+		 * \brief Returns the number of modes added, root mode not included
+		 */
+		uint getModeCount() const;
+
+		/**
+		 * \brief Returns the number of action records added
+		 */
+		uint getActionCount() const;
+
+	public:
+		/**
+		 * \brief Returns serialized blob data
+		 *
+		 * The returned pointer is valid until the blob is modified or destroyed.
+		 */
+		const void * getData();
+
+		/**
+		 * \brief Returns serialized blob size, in bytes
+		 */
+		size_t getSize() const;
+
+	private:
+		/// Internal implementation class
+		class Private;
+		/// Pointer to internal implementation class
+		Private * d;
+	};
+}
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This file is part of JSMapper Library.
+ * 
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file sharedstate.cpp
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ * \brief Implementation file for 'SharedState' class
+ */
+
+#include "sharedstate.h"
+#include "device.h"
+#include "log.h"
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <string.h>
+
+namespace jsmapper
+{
+	/// Number of attempts to get a consistent snapshot before giving up
+	static const int MAX_READ_ATTEMPTS = 1000;
+	
+	
+	class SharedState::Private
+	{
+	public:
+		/// Mapped page
+		const volatile struct t_JSMAPPER_SHARED_STATE * page;
+		/// Mapping size
+		size_t size;
+		/// Active mode, as of last snapshot
+		unsigned int activeMode;
+		/// Profile generation, as of last snapshot
+		unsigned int profileGeneration;
+		
+	public:
+		Private()
+			: page( NULL ),
+			size( 0 ),
+			activeMode( 0 ),
+			profileGeneration( 0 )
+		{
+		}
+	};
+	
+	
+	SharedState::SharedState()
+	{
+		d = new Private();
+	}
+	
+	SharedState::~SharedState()
+	{
+		close();
+		delete d;
+	}
+	
+	
+	bool SharedState::open( Device &device )
+	{
+		bool result = false;
+		
+		// the mapping keeps the device file open on its own, so device can be closed right after:
+		if( device.open() )
+		{
+			result = open( device.getFd() );
+			device.close();
+		}
+		
+		return result;
+	}
+	
+	bool SharedState::open( int fd )
+	{
+		close();
+		
+		size_t size = sysconf( _SC_PAGESIZE );
+		void * page = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+		if( page == MAP_FAILED )
+		{
+			JSMAPPER_LOG_ERROR( "Failed to map device state (error %i: %s)", errno, strerror( errno ) );
+			return false;
+		}
+		
+		const struct t_JSMAPPER_SHARED_STATE * shared = (const struct t_JSMAPPER_SHARED_STATE *) page;
+		if( shared->size < sizeof( struct t_JSMAPPER_SHARED_STATE ) )
+		{
+			JSMAPPER_LOG_ERROR( "Unexpected device state layout (size %u)", (unsigned int) shared->size );
+			munmap( page, size );
+			return false;
+		}
+		
+		d->page = shared;
+		d->size = size;
+		return true;
+	}
+	
+	void SharedState::close()
+	{
+		if( d->page != NULL )
+		{
+			munmap( (void *) d->page, d->size );
+			d->page = NULL;
+			d->size = 0;
+		}
+	}
+	
+	bool SharedState::isOpen() const
+	{
+		return d->page != NULL;
+	}
+	
+	
+	unsigned int SharedState::getSequence() const
+	{
+		if( d->page == NULL )
+			return 0;
+		
+		return __atomic_load_n( &d->page->state.sequence, __ATOMIC_RELAXED );
+	}
+	
+	bool SharedState::read( DeviceState &state )
+	{
+		if( d->page == NULL )
+			return false;
+		
+		const volatile struct t_JSMAPPER_SHARED_STATE * page = d->page;
+		for( int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++ )
+		{
+			// odd sequence count: an update is in progress
+			__u32 seq = __atomic_load_n( &page->seq, __ATOMIC_ACQUIRE );
+			if( seq & 1 )
+				continue;
+			
+			memcpy( state.getData(), (const void *) &page->state, sizeof( struct t_JSMAPPER_STATE ) );
+			unsigned int activeMode = page->active_mode;
+			unsigned int profileGeneration = page->profile_generation;
+			
+			// copy must be complete before checking the sequence count again:
+			__atomic_thread_fence( __ATOMIC_ACQUIRE );
+			if( __atomic_load_n( &page->seq, __ATOMIC_RELAXED ) == seq )
+			{
+				d->activeMode = activeMode;
+				d->profileGeneration = profileGeneration;
+				return true;
+			}
+		}
+		
+		JSMAPPER_LOG_WARNING( "Failed to get a consistent device state snapshot!" );
+		return false;
+	}
+	
+	
+	unsigned int SharedState::getActiveMode() const
+	{
+		return d->activeMode;
+	}
+	
+	unsigned int SharedState::getProfileGeneration() const
+	{
+		return d->profileGeneration;
+	}
+}
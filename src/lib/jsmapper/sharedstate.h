@@ -0,0 +1,103 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This file is part of JSMapper Library.
+ * 
+ * JSMapper Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with JSMapper Library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file sharedstate.h
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ * \brief Declaration file for 'SharedState' class
+ */
+
+#ifndef __LIBJSMAPPER_SHAREDSTATE_H_
+#define __LIBJSMAPPER_SHAREDSTATE_H_
+
+#include "common.h"
+#include "devicestate.h"
+
+namespace jsmapper
+{
+	class Device;
+	
+	/**
+	 * \brief Reader of a device's shared state page
+	 * 
+	 * The driver keeps a page with the whole device state up to date for as long as somebody maps it, so sampling 
+	 * it takes no syscall at all: meant for clients polling device state at high rates (overlays, telemetry...). 
+	 * Reads are lock-free: the page is updated under a sequence count, and a read is retried if an update was 
+	 * in progress.
+	 * 
+	 * Once opened, the mapping stays valid even if the device gets closed. If the device gets disconnected the 
+	 * page just stops changing.
+	 */
+
+	class SharedState
+	{
+	public:
+		SharedState();
+		virtual ~SharedState();
+		
+	public:
+		/**
+		 * \brief Maps the shared state page of a device
+		 * 
+		 * Requires driver API version 1.7.0 or newer.
+		 */
+		bool open( Device &device );
+		
+		/**
+		 * \brief Maps a shared state page from an open file descriptor (only meant for testing)
+		 */
+		bool open( int fd );
+		
+		/**
+		 * \brief Unmaps the page
+		 */
+		void close();
+		
+		/**
+		 * \brief Returns true if the page is currently mapped
+		 */
+		bool isOpen() const;
+		
+		/**
+		 * \brief Returns current state sequence number, without taking a snapshot
+		 * 
+		 * Cheap way to know whether anything changed since last snapshot (see DeviceState::getSequence()).
+		 */
+		unsigned int getSequence() const;
+		
+		/**
+		 * \brief Takes a consistent snapshot of device state
+		 * \return true on success, false if not open or the page kept changing while being read
+		 */
+		bool read( DeviceState &state );
+		
+		/**
+		 * \brief Returns the ID of the active mode taking precedence, as of last snapshot
+		 */
+		unsigned int getActiveMode() const;
+		
+		/**
+		 * \brief Returns device's profile generation, as of last snapshot (changes every time a profile is loaded)
+		 */
+		unsigned int getProfileGeneration() const;
+		
+	private:
+		class Private;
+		Private * d;
+	};
+}
+
+#endif // __LIBJSMAPPER_SHAREDSTATE_H_
@@ -34,7 +34,22 @@
  *************************************************************************************************************/
 
 /** Current API version */
-#define JSMAPPER_API_VERSION			0x010000	/* 1.0.0 */
+#define JSMAPPER_API_VERSION			0x010800	/* 1.8.0 */
+
+/** Magic number at the start of every profile blob ("JSMP") */
+#define JSMAPPER_PROFILE_MAGIC			0x504d534a
+
+/** Current profile blob format version (version 1 blobs, without macro options, are still accepted) */
+#define JSMAPPER_PROFILE_VERSION		2
+
+/** Maximum size of a profile blob accepted by JMIOCLOADPROFILE, in bytes */
+#define JSMAPPER_PROFILE_MAX_SIZE		(1 << 20)
+
+/** Number of profile banks per device, numbered from 1 */
+#define JSMAPPER_BANK_COUNT				8
+
+/** Bank number standing for the active bank, whichever it is */
+#define JSMAPPER_BANK_ACTIVE			0
 
 
 
@@ -74,6 +89,42 @@
  */ 
 #define JSMAPPER_ACTION_REL			3
 
+/** 
+ * Axis bands only: the element will move a relative axis at a speed proportional to the deflection of the 
+ * absolute axis it's assigned to, as long as the axis stays inside the band. Its parameters (t_JSMAPPER_MOTION) 
+ * follow the t_JSMAPPER_ACTION structure.
+ */ 
+#define JSMAPPER_ACTION_MOTION		4
+
+
+/*************************************************************************************************************
+ * 
+ * Macro re-trigger policies:
+ * 
+ *************************************************************************************************************/
+
+/**
+  Activating a macro while it's still running queues a new run, started once the current one (and any other 
+  previously queued) finishes
+  */
+#define JSMAPPER_MACRO_QUEUE                  0
+
+/**
+  Activating a macro while it's still running restarts it from its first key
+  */
+#define JSMAPPER_MACRO_RESTART                1
+
+/**
+  Activating a macro while it's still running does nothing
+  */
+#define JSMAPPER_MACRO_IGNORE                 2
+
+/**
+  The macro runs only while the button is held down (or the axis is inside the band): releasing it cancels the 
+  remaining keys
+  */
+#define JSMAPPER_MACRO_CANCEL                 3
+
 
 /*************************************************************************************************************
  * 
@@ -97,6 +148,23 @@
 #define JSMAPPER_MODE_CONDITION_AXIS          2
 
 
+/*************************************************************************************************************
+ * 
+ * Profile blob action targets:
+ * 
+ *************************************************************************************************************/
+
+/**
+  The action record is assigned to a button (action.button field is used)
+  */
+#define JSMAPPER_PROFILE_TARGET_BUTTON        1
+
+/**
+  The action record is assigned to an axis band (action.axis field is used)
+  */
+#define JSMAPPER_PROFILE_TARGET_AXIS          2
+
+
 /*************************************************************************************************************
  * 
  * Keystroke modifiers:
@@ -160,6 +228,38 @@ struct t_JSMAPPER_REL
 };
 
 
+/**
+ * \brief Assignment struct representing a relative axis movement proportional to an absolute axis
+ *
+ * The deflection of the source axis is measured from the center value. Deflections up to the deadzone produce 
+ * no movement, and then the speed grows up to max_step units per step, reached at a deflection of 'range'. 
+ * The curve blends linear (0) and quadratic (32768) responses, in Q15 fixed point, for finer control near 
+ * the center. Movements smaller than one unit per step are accumulated, so slow speeds still move.
+ *
+ * It doesn't fit in the action data union, whose size is part of the API, so it's placed right after the 
+ * t_JSMAPPER_ACTION structure instead: motion actions take sizeof(struct t_JSMAPPER_ACTION) + 
+ * sizeof(struct t_JSMAPPER_MOTION) bytes.
+ */
+
+struct t_JSMAPPER_MOTION
+{
+	/** A relative axis ID (REL_xxx, usually REL_X or REL_Y */
+	__u16 id;
+    /** Time spacing between steps, in ms (0 for the fastest rate supported) */
+    __u16 spacing;
+	/** Source axis value at rest */
+	__s32 center;
+	/** Deflection from center producing no movement, in source axis units */
+	__s32 deadzone;
+	/** Deflection from center producing full speed, in source axis units */
+	__s32 range;
+	/** Number of axis units to move per step at full deflection (negative to invert direction) */
+	__s16 max_step;
+	/** Response curve, Q15: 0 is linear, 32768 quadratic */
+	__u16 curve;
+};
+
+
 /**
  * \brief Assignment struct representing a macro event
  */
@@ -175,6 +275,22 @@ struct t_JSMAPPER_MACRO
 };
 
 
+/**
+ * \brief Macro options
+ *
+ * Follows the key array of macro actions inside version 2 profile blobs. Legacy programming ioctls & version 1 
+ * blobs don't carry it, and their macros get the default options (all fields set to 0).
+ */
+
+struct t_JSMAPPER_MACRO_OPTIONS
+{
+    /** Re-trigger policy - see JSMAPPER_MACRO_xxx constants */
+    __u16  policy;
+    /** Reserved, must be 0 */
+    __u16  reserved;
+};
+
+
 /**
   * \brief Mode structure
   * This structure is used to add / remove modes from the device.
@@ -240,7 +356,14 @@ struct t_JSMAPPER_ACTION
 	/** Action type - see JSMAPPER_ACTION_xxx constants */
 	__s16 type;
 
-    /** If true, button event will be filtered out. Else, it will make its way to the joystick driver */
+    /** 
+     * If true, button event will be filtered out. Else, it will make its way to the joystick driver.
+     * 
+     * The flag is applied per event, as soon as the event arrives: it's taken from the action assigned in the modes 
+     * active at that point, while the action fired is resolved once the whole input frame is received. So, when a 
+     * mode changes later in the same frame (i.e. a shift button reported after the button), the event is filtered 
+     * (or not) as the action of the previous mode says, even if the action fired is the one of the new mode.
+     */
 	__u8 filter;
     
 	/** Variable union struct containing action data */
@@ -257,6 +380,228 @@ struct t_JSMAPPER_ACTION
 
 
 
+/**
+ * \brief Profile blob header
+ *
+ * A profile blob is a compact, serialized form of a whole profile, loaded into the device in a single 
+ * JMIOCLOADPROFILE call. All records are aligned to 4 bytes. The layout is:
+ *
+ *  - this header;
+ *  - the profile name (name_length bytes, not null-terminated), padded to 4 bytes;
+ *  - mode_count t_JSMAPPER_MODE records. The root mode is implicit and has index 0, so the record at position i
+ *    describes the mode with index i + 1. Its mode_id field must contain that index, and its parent_mode_id the 
+ *    index of a mode defined before it;
+ *  - action_count t_JSMAPPER_PROFILE_ACTION records, each one with a mode_id field referring to a mode index.
+ *
+ * Since the device is cleared before loading the blob, mode indexes match the mode IDs assigned by the device.
+ *
+ * Version 2 blobs (accepted since API version 1.4.0) differ from version 1 ones only in macro action records, 
+ * whose key array is followed by a t_JSMAPPER_MACRO_OPTIONS structure.
+ */
+
+struct t_JSMAPPER_PROFILE_HEADER
+{
+	/** JSMAPPER_PROFILE_MAGIC */
+	__u32 magic;
+	/** Blob format version (JSMAPPER_PROFILE_VERSION) */
+	__u16 version;
+	/** Profile name length, in bytes */
+	__u16 name_length;
+	/** Total blob size, in bytes, header included */
+	__u32 size;
+	/** Number of mode records, root mode not included */
+	__u16 mode_count;
+	/** Reserved, must be 0 */
+	__u16 reserved;
+	/** Number of action records */
+	__u32 action_count;
+};
+
+
+/**
+ * \brief Profile blob action record
+ *
+ * Variable-sized record wrapping a t_JSMAPPER_ACTION structure (which can contain an arbitrary number of macro 
+ * keys), assigned either to a button or to an axis band.
+ */
+
+struct t_JSMAPPER_PROFILE_ACTION
+{
+	/** Record size in bytes, this header included. Must be a multiple of 4 */
+	__u16 size;
+	/** Action target - see JSMAPPER_PROFILE_TARGET_xxx constants */
+	__u16 target;
+	/** Action definition */
+	struct t_JSMAPPER_ACTION action;
+};
+
+
+/**
+ * \brief JMIOCLOADPROFILE parameter
+ */
+
+struct t_JSMAPPER_PROFILE_LOAD
+{
+	/** Userspace pointer to the profile blob */
+	__u64 data;
+	/** Profile blob size, in bytes: at least sizeof( struct t_JSMAPPER_PROFILE_HEADER ), up to JSMAPPER_PROFILE_MAX_SIZE */
+	__u32 size;
+	/** Bank to load the profile into (1..JSMAPPER_BANK_COUNT), or JSMAPPER_BANK_ACTIVE to replace the profile in use */
+	__u32 bank;
+};
+
+
+/**
+ * \brief JMIOCGBANKS parameter
+ */
+
+struct t_JSMAPPER_BANKS
+{
+	/** Active bank number (1..JSMAPPER_BANK_COUNT) */
+	__u32 active;
+	/** Loaded banks bitmap: bit n - 1 is set if bank n holds a profile */
+	__u32 loaded;
+	/** ID of the button cycling through loaded banks, -1 if none */
+	__s32 button;
+	/** Reserved, set to 0 */
+	__u32 reserved;
+};
+
+
+
+/*************************************************************************************************************
+ * 
+ * Event stream:
+ * 
+ *    Reading from a jsmapper device returns a stream of t_JSMAPPER_EVENT records, telling what happens inside 
+ * the device. Every file descriptor gets its own stream, started the first time the descriptor is read, polled 
+ * or set up for asynchronous notification (O_ASYNC), so descriptors only used for ioctls don't cost anything. If a 
+ * reader doesn't keep up, records are dropped, and a JSMAPPER_EVENT_OVERFLOW one tells how many of them were lost.
+ * 
+ *************************************************************************************************************/
+
+/**
+  Raw button / axis change: target & id tell the button or axis, value holds its new value
+ */
+#define JSMAPPER_EVENT_INPUT			1
+
+/**
+  Mode transition: id is the mode ID, value is 1 if activated, 0 if deactivated
+ */
+#define JSMAPPER_EVENT_MODE				2
+
+/**
+  Action fired: target & id tell the button or axis, value is 1 on activation, 0 on release, and action holds 
+  the action type
+ */
+#define JSMAPPER_EVENT_ACTION			3
+
+/**
+  New profile published: mode & action state must be queried again
+ */
+#define JSMAPPER_EVENT_PROFILE			4
+
+/**
+  Records lost because the reader didn't keep up: value holds how many of them
+ */
+#define JSMAPPER_EVENT_OVERFLOW			5
+
+
+/**
+ * \brief Event stream record
+ */
+
+struct t_JSMAPPER_EVENT
+{
+	/** Timestamp, in milliseconds (wraps around) */
+	__u32 time;
+	/** Record type - see JSMAPPER_EVENT_xxx constants */
+	__u8 type;
+	/** Target of input & action records - see JSMAPPER_PROFILE_TARGET_xxx constants */
+	__u8 target;
+	/** Button / axis ID of input & action records, mode ID of mode records */
+	__u16 id;
+	/** Record value (see record types) */
+	__s32 value;
+	/** Action type of action records - see JSMAPPER_ACTION_xxx constants */
+	__s32 action;
+};
+
+
+
+/*************************************************************************************************************
+ * 
+ * Device state:
+ * 
+ *************************************************************************************************************/
+
+/** Maximum number of buttons reported by JMIOCGSTATE */
+#define JSMAPPER_STATE_BUTTONS			512
+
+/** Maximum number of axes reported by JMIOCGSTATE */
+#define JSMAPPER_STATE_AXES				64
+
+/** Maximum number of mode IDs reported by JMIOCGSTATE */
+#define JSMAPPER_STATE_MODES			256
+
+
+/**
+ * \brief Device state snapshot, as returned by JMIOCGSTATE
+ * 
+ * All values are taken at once, between two input frames. Bitmaps are arrays of 32-bit words: bit n is 
+ * (bitmap[ n / 32 ] >> (n % 32)) & 1.
+ */
+
+struct t_JSMAPPER_STATE
+{
+	/** Snapshot sequence number: incremented on every input frame & profile change (wraps around) */
+	__u32 sequence;
+	/** Number of buttons reported */
+	__u16 button_count;
+	/** Number of axes reported */
+	__u16 axis_count;
+	/** Number of mode IDs in current profile (last mode ID + 1); only the first JSMAPPER_STATE_MODES are reported */
+	__u32 mode_count;
+	/** Reserved, set to 0 */
+	__u32 reserved;
+	/** Button values bitmap, indexed by button ID */
+	__u32 buttons[ JSMAPPER_STATE_BUTTONS / 32 ];
+	/** Axis values, indexed by axis ID */
+	__s32 axes[ JSMAPPER_STATE_AXES ];
+	/** Active modes bitmap, indexed by mode ID (root mode, ID 0, is always active) */
+	__u32 modes[ JSMAPPER_STATE_MODES / 32 ];
+};
+
+
+
+/**
+ * \brief Shared device state page
+ * 
+ * A jsmapper device can be mmap()'ed read-only (a single page, at offset 0) to get a page holding this structure, 
+ * which the driver keeps up to date after every input frame & profile change, as long as it's mapped. So it can be 
+ * sampled without any syscall at all.
+ * 
+ * The page is updated under a sequence count: seq is odd while an update is in progress. A consistent snapshot is 
+ * got by reading seq (must be even), copying the data, and reading seq again: if it changed, the copy must be 
+ * retried. Reads of seq must have acquire semantics, and the second one must be ordered after the copy.
+ */
+
+struct t_JSMAPPER_SHARED_STATE
+{
+	/** Sequence count: odd while page is being updated */
+	__u32 seq;
+	/** Size of this structure, in bytes */
+	__u32 size;
+	/** Profile generation: incremented every time a new profile gets published */
+	__u32 profile_generation;
+	/** ID of the active mode whose programming takes precedence */
+	__u32 active_mode;
+	/** Device state */
+	struct t_JSMAPPER_STATE state;
+};
+
+
+
 /*************************************************************************************************************
   
  IOCTL codes:
@@ -301,6 +646,23 @@ struct t_JSMAPPER_ACTION
   */
 #define JMIOCGAXISVALUE					_IOWR('j', 0x45, __s32)
 
+/**
+  \brief Returns a snapshot of mapped device's whole state: button & axis values, and active modes
+  
+  Meant for clients needing more than a couple of values at once, which would otherwise need a 
+  JMIOCGBUTTONVALUE / JMIOCGAXISVALUE call for each one of them.
+  
+  Available since API version 1.6.0.
+  */
+#define JMIOCGSTATE						_IOR('j', 0x46, struct t_JSMAPPER_STATE)
+
+/**
+  \brief Returns the state of the profile banks: active bank, banks holding a profile & bank cycling button
+  
+  Available since API version 1.8.0.
+  */
+#define JMIOCGBANKS						_IOR('j', 0x47, struct t_JSMAPPER_BANKS)
+
 
 
 /*
@@ -309,6 +671,12 @@ struct t_JSMAPPER_ACTION
 
 /**
   \brief Clears all button & axes actions, modes, etc...
+  
+  Programming codes (JMIOCCLEAR, JMIOCADDMODE, JMIOCSBUTTONACTION, JMIOCSAXISACTION & JMIOCSPROFILENAME) 
+  don't change the programming in use, but a pending copy of it. The pending programming replaces current 
+  one at once when the profile name is set (the last step of legacy programming) or when JMIOCCOMMIT is 
+  called. The pending copy belongs to the device, not to a file descriptor, so it's kept across the open / close 
+  cycles of clients issuing each programming call on its own descriptor.
   */
 #define JMIOCCLEAR						_IO('j', 0x50 )
 
@@ -329,8 +697,8 @@ struct t_JSMAPPER_ACTION
   This function should be called by passing it a pointer to a t_JSMAPPER_ACTION structure, appropiately 
   sized to the action type specified.
   
-  \warning The driver does not perform any check about axis actions ranges overlapping. If they
-		   do, behaviour is unredictable.
+  If bands defined for the same axis and mode overlap, the band defined first takes precedence
+  over the values they share.
   */
 #define JMIOCSAXISACTION(len)			_IOC( _IOC_WRITE, 'j', 0x52, len )
 
@@ -347,6 +715,54 @@ struct t_JSMAPPER_ACTION
 #define JMIOCADDMODE					_IOWR('j', 0x53, struct t_JSMAPPER_MODE )
 
 
+/**
+  \brief Loads a whole profile
+  
+  Validates the given profile blob (see t_JSMAPPER_PROFILE_HEADER) and, if correct, replaces the current device 
+  programming (modes, actions & profile name) with it. If the blob is invalid, the current programming is kept 
+  untouched. Blobs smaller than their header or larger than JSMAPPER_PROFILE_MAX_SIZE fail with EINVAL.
+  
+  Since API version 1.8.0 the profile can be preloaded into any bank instead, to be switched to later on by 
+  JMIOCSBANK without any delay.
+  
+  Available since API version 1.1.0.
+  */
+#define JMIOCLOADPROFILE				_IOW('j', 0x54, struct t_JSMAPPER_PROFILE_LOAD )
+
+
+/**
+  \brief Commits pending programming
+  
+  Makes the programming done through JMIOCCLEAR, JMIOCADDMODE, JMIOCSBUTTONACTION & JMIOCSAXISACTION 
+  the one in use, replacing current one at once. Does nothing if there is no pending programming.
+  
+  Available since API version 1.2.0.
+  */
+#define JMIOCCOMMIT						_IO('j', 0x55 )
+
+
+/**
+  \brief Selects the active bank
+  
+  Makes the profile preloaded in the given bank (1..JSMAPPER_BANK_COUNT) the one in use. Fails with ENOENT if 
+  the bank is empty. Programming codes & JMIOCLOADPROFILE with JSMAPPER_BANK_ACTIVE work on the active bank.
+  
+  Available since API version 1.8.0.
+  */
+#define JMIOCSBANK						_IOW('j', 0x56, __u32)
+
+
+/**
+  \brief Sets the button cycling through the banks
+  
+  Every press of the given button (-1 for none) selects the next bank holding a profile, right from the event 
+  filter. The button itself is filtered out, and it's ignored by profile programming.
+  
+  Available since API version 1.8.0.
+  */
+#define JMIOCSBANKBUTTON				_IOW('j', 0x57, __s32)
+
+
 /**
   \brief Set profile name
 
@@ -24,10 +24,36 @@
 #include "jsmapper_api.h"
 #include "jsmapper_log.h"
 #include "jsmapper_evgen.h"
+#include "jsmapper_trace.h"
 
 #include <linux/kernel.h>
 #include <linux/input.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/spinlock.h>
+#include <linux/percpu.h>
+#include <linux/rcupdate.h>
+
+
+/** Default size of profile arena chunks, in bytes */
+#define JSMAPPER_CORE_ARENA_CHUNK_SIZE		16384
+/** Maximum size of a single profile arena chunk, unless a bigger block is requested */
+#define JSMAPPER_CORE_ARENA_CHUNK_MAX		131072
+/** Alignment of blocks allocated from profile arenas */
+#define JSMAPPER_CORE_ARENA_ALIGN			sizeof(unsigned long long)
+
+
+static int _register_mode( struct jsmapdev_core_profile * profile, struct jsmapdev_core_mode * mode );
+static int _finish_profile( struct jsmapdev_core_profile * profile );
+static void _release_actions( struct jsmapdev_core_profile * profile );
+static void _cycle_bank( struct jsmapdev_core * core );
+static struct jsmapdev_core_axis_action * _resolve_axis_action( struct jsmapdev_core_profile * profile, int axis_id, 
+                                                                int value, int * low, int * high );
+static struct jsmapdev_core_button_action * _mode_button_slot( struct jsmapdev_core_profile * profile, 
+                                                               struct jsmapdev_core_mode * mode, uint button_id );
+static struct jsmapdev_core_axis_actions * _mode_axis_slot( struct jsmapdev_core_profile * profile, 
+                                                            struct jsmapdev_core_mode * mode, uint axis_id );
 
 
 /*******************************************************************************************************
@@ -36,16 +62,17 @@
  * 
  *******************************************************************************************************/
 
-struct jsmapdev_core * jsmapper_core_init( struct input_dev * dev )
+struct jsmapdev_core * jsmapper_core_init( struct input_dev * dev, struct jsmapper_evgen * evgen )
 {
 	struct jsmapdev_core * core = NULL;
+	struct jsmapdev_core_profile * profile = NULL;
 	int i = 0;
 	
 	if( dev ) {
 		core = kzalloc(sizeof(struct jsmapdev_core), GFP_KERNEL);
 		if( core ) {
 			core->dev = dev;
-			core->profile_name = NULL;
+			core->evgen = evgen;
 			/* get buttons: 
 			 * 	Buttons IDs are extracted using a double loop system, just as joydev.c does, so jsmapper
 			 * will map them in the same way original joystick driver does.
@@ -77,14 +104,18 @@ struct jsmapdev_core * jsmapper_core_init( struct input_dev * dev )
 					core->axis_rmap[core->axis_count++] = i;
 				}
 			}
-			for( i = 0; i < core->axis_count; i++ ) {
-				core->current_axis_action[ i ] = NULL;
-			}
 
-			
-			/* initialize mode structure */
-			core->root_mode = jsmapper_core_init_mode( core );
-            core->last_mode_id = 0;
+			/* start with an empty profile: */
+			profile = jsmapper_core_create_profile( core, 0 );
+			if( profile == NULL ) {
+				kfree( core );
+				return NULL;
+			}
+			core->banks[ 0 ] = profile;
+			core->bank = 0;
+			core->bank_button = -1;
+			RCU_INIT_POINTER( core->profile, profile );
+			core->staging = NULL;
 			
 		} else
 			JSMAPPER_LOG_ERROR( "unable to allocate a core structure!" );
@@ -94,240 +125,1656 @@ struct jsmapdev_core * jsmapper_core_init( struct input_dev * dev )
 }
 
 
-void jsmapper_core_clear( struct jsmapdev_core * core, int reset )
+int jsmapper_core_clear( struct jsmapdev_core * core )
 {
-	int i = 0;
+	struct jsmapdev_core_profile * profile = NULL;
+	
+	profile = jsmapper_core_create_profile( core, 0 );
+	if( profile == NULL )
+		return -ENOMEM;
+	
+	jsmapper_core_destroy_profile( core->staging );
+	core->staging = profile;
+	profile->loading = 1;
+	
+	JSMAPPER_LOG_INFO( "device cleared" );
+	return 0;
+}
 
+
+void jsmapper_core_done( struct jsmapdev_core * core )
+{
+	struct jsmapdev_core_profile * profile = NULL;
+	int i = 0;
+	
 	if( core ) {
+		/* input handle is already gone, so nobody else can be reading the published profile: */
+		profile = rcu_dereference_protected( core->profile, 1 );
+		RCU_INIT_POINTER( core->profile, NULL );
+		if( profile )
+			_release_actions( profile );
 		
-		/* clear profile name */
-		if( core->profile_name ) {
-			kfree( core->profile_name );
-			core->profile_name = NULL;
-		}
+		/* the published profile is one of the banks: */
+		for( i = 0; i < JSMAPPER_BANK_COUNT; i++ )
+			jsmapper_core_destroy_profile( core->banks[ i ] );
+		
+		jsmapper_core_destroy_profile( core->staging );
+		kfree( core );
+	}
+}
 
-		/* TODO terminate any current action...? */
-		for( i = 0; i < core->axis_count; i++ ) {
-			if( core->current_axis_action[ i ] ) {
-				JSMAPPER_LOG_DEBUG( "Deactivating old action for axis ID=%u on cleanup", i );
-				jsmapper_evgen_send_action( &core->current_axis_action[ i ]->action, 0 );
-			}
-			
-			core->current_axis_action[ i ] = NULL;
-		}
 
-		/* destroy root mode, including old all submodes: */
-		if( core->root_mode ) {
-			jsmapper_core_clear_mode( core, core->root_mode );
-			core->root_mode = NULL;
-		}
-		
-		core->last_mode_id = 0;
+void jsmapper_core_set_listener( struct jsmapdev_core * core, jsmapdev_core_listener listener, void * data )
+{
+	core->listener = listener;
+	core->listener_data = data;
+}
+
 
-		JSMAPPER_LOG_INFO( "device cleared" );
+void jsmapper_core_set_stats( struct jsmapdev_core * core, struct jsmapdev_core_stats __percpu * stats )
+{
+	core->stats = stats;
+}
+
+
+/**
+ * Increments one of core's counters, if it has any (the preemption-safe op, as allocations happen in process context)
+ */
+#define _core_count( core, counter )	do { if( (core)->stats ) this_cpu_inc( (core)->stats->counter ); } while( 0 )
+
+
+/**
+ * Sends a record to core's listener, if any
+ */
+static inline void _notify( struct jsmapdev_core * core, uint type, uint target, uint id, int value, int action )
+{
+	struct t_JSMAPPER_EVENT event;
+	
+	if( core->listener == NULL )
+		return;
+	
+	event.time = 0;
+	event.type = type;
+	event.target = target;
+	event.id = id;
+	event.value = value;
+	event.action = action;
+	core->listener( core->listener_data, &event );
+}
 
-		if( reset ) {
-			/* re-create new root mode: */
-			core->root_mode = jsmapper_core_init_mode( core );
+
+/**
+ * Resolves the action for an axis value, switching from the previous one if it changed. Returns true if the event 
+ * must be filtered out.
+ */
+static bool _resolve_axis( struct jsmapdev_core_profile * profile, int axis_id, int value )
+{
+	struct jsmapdev_core_axis_action * axis_assign = NULL;
+	struct jsmapdev_core_axis_action * cur_axis_assign = NULL;
+	bool filter = false;
+	
+	/* fast path: value didn't leave the band (or gap) resolved last time */
+	if( jsmapper_core_axis_cache_hit( profile, axis_id, value ) )
+		return false;
+	
+	cur_axis_assign = profile->current_axis_action[ axis_id ];
+	axis_assign = jsmapper_core_find_axis_action( profile, axis_id, value );
+	if( axis_assign != cur_axis_assign ) {
+		
+		if( cur_axis_assign ) {
+			JSMAPPER_LOG_DEBUG( "Deactivating old action for axis ID=%u", axis_id );
+			trace_jsmapper_action( profile->core->dev, JSMAPPER_PROFILE_TARGET_AXIS, axis_id, value, 
+								   cur_axis_assign->action.type, 0 );
+			_notify( profile->core, JSMAPPER_EVENT_ACTION, JSMAPPER_PROFILE_TARGET_AXIS, axis_id, 0, 
+					 cur_axis_assign->action.type );
+			jsmapper_evgen_send_action( profile->core->evgen, &cur_axis_assign->action, 0 );
+			if( cur_axis_assign->filter )
+				filter = true;
+		}
+	
+		profile->current_axis_action[ axis_id ] = axis_assign;
+				
+		if( axis_assign ) {
+			JSMAPPER_LOG_DEBUG( "Activating new action for axis ID=%u", axis_id );
+			trace_jsmapper_action( profile->core->dev, JSMAPPER_PROFILE_TARGET_AXIS, axis_id, value, 
+								   axis_assign->action.type, 1 );
+			_notify( profile->core, JSMAPPER_EVENT_ACTION, JSMAPPER_PROFILE_TARGET_AXIS, axis_id, 1, 
+					 axis_assign->action.type );
+			jsmapper_evgen_send_action( profile->core->evgen, &axis_assign->action, 1 );
+			if( axis_assign->filter )
+				filter = true;
 		}
 	}
+	
+	return filter;
 }
 
 
-void jsmapper_core_done( struct jsmapdev_core * core )
+/**
+ * Tells whether an axis event must be filtered out, as _resolve_axis() would do it, but without sending actions 
+ * nor touching the axis cache. Used when the event arrives, as actions are resolved only once the frame is complete: 
+ * it resolves against the mode state as of this event, so it may disagree with the action finally sent if a later 
+ * event of the frame changes the modes (see jsmapper_core_filter()).
+ */
+static bool _filter_axis( struct jsmapdev_core_profile * profile, int axis_id, int value )
 {
-	if( core ) {
-		jsmapper_core_clear( core, 0 );
-		kfree( core );
+	struct jsmapdev_core_axis_cache * cache = &profile->axis_cache[ axis_id ];
+	struct jsmapdev_core_axis_action * axis_assign = NULL;
+	struct jsmapdev_core_axis_action * cur_axis_assign = profile->current_axis_action[ axis_id ];
+	int low = 0, high = 0;
+	
+	if( cache->generation == profile->generation && value >= cache->low && value <= cache->high )
+		return false;
+	
+	axis_assign = _resolve_axis_action( profile, axis_id, value, &low, &high );
+	return axis_assign != cur_axis_assign
+		&& ( ( cur_axis_assign && cur_axis_assign->filter ) || ( axis_assign && axis_assign->filter ) );
+}
+
+
+/**
+ * Sends the actions triggered by the buffered input frame, resolved against current mode state, in a single 
+ * event generator batch, and empties it
+ */
+static void _resolve_frame( struct jsmapdev_core * core, struct jsmapdev_core_profile * profile )
+{
+	struct jsmapdev_core_frame				* frame = &core->frame;
+	struct jsmapdev_core_button_action      * button_assign = NULL;
+	uint	i = 0;
+	int		axis_id = 0;
+	
+	if( frame->button_count == 0 && bitmap_empty( frame->axes, ABS_CNT ) )
+		return;
+	
+	/* whatever the frame triggers is sent as a single output frame too: */
+	jsmapper_evgen_begin_frame( core->evgen );
+	
+	for( i = 0; i < frame->button_count; i++ ) {
+		button_assign = jsmapper_core_find_button_action( profile, frame->buttons[ i ].id );
+		if( button_assign ) {
+			trace_jsmapper_action( core->dev, JSMAPPER_PROFILE_TARGET_BUTTON, frame->buttons[ i ].id, 
+								   frame->buttons[ i ].value, button_assign->action.type, frame->buttons[ i ].value != 0 );
+			_notify( core, JSMAPPER_EVENT_ACTION, JSMAPPER_PROFILE_TARGET_BUTTON, frame->buttons[ i ].id, 
+					 frame->buttons[ i ].value != 0, button_assign->action.type );
+			jsmapper_evgen_send_action( core->evgen, &button_assign->action, frame->buttons[ i ].value );
+		}
+	}
+	frame->button_count = 0;
+	
+	for_each_set_bit( axis_id, frame->axes, core->axis_count ) {
+		_resolve_axis( profile, axis_id, frame->axis_values[ axis_id ] );
 	}
+	bitmap_zero( frame->axes, ABS_CNT );
+	
+	jsmapper_evgen_end_frame( core->evgen );
+}
+
+
+bool jsmapper_core_filter( struct jsmapdev_core * core, unsigned int type, unsigned int code, int value )
+{
+	bool                                    filter = false;
+    int										button_id = -1;
+    struct jsmapdev_core_button_action      * button_assign = NULL;
+    int										axis_id = -1;
+    struct jsmapdev_core_frame				* frame = &core->frame;
+    struct jsmapdev_core_profile			* profile = NULL;
+    
+    /* published profile can only be replaced once we're done with it: */
+    rcu_read_lock();
+    profile = rcu_dereference( core->profile );
+    
+    switch( type )	{
+    case EV_KEY:
+        button_id = jsmapper_core_map_button( core, code );
+        if( button_id >= 0 && button_id == core->bank_button ) {
+            /* bank button is not seen by profile programming, banks are switched once the frame is complete: */
+            if( value == 1 )
+                core->bank_cycle = 1;
+            filter = true;
+        } else if( button_id >= 0 ) {
+            // JSMAPPER_LOG_DEBUG("filter( button ID=%u, value=%i )", button_id, value );
+            
+            /* mode state first, actions once the frame is complete (the filter flag can't wait for it, so it's 
+               taken from the mode state as of this event, see jsmapper_core_filter()): */
+            jsmapper_core_button_changed( profile, button_id );
+            button_assign = jsmapper_core_find_button_action( profile, button_id );
+            if( button_assign ) {
+                filter = button_assign->filter;
+            }
+            
+            if( frame->button_count == JSMAPPER_CORE_FRAME_BUTTONS ) {
+                _resolve_frame( core, profile );
+            }
+            frame->buttons[ frame->button_count ].id = button_id;
+            frame->buttons[ frame->button_count ].value = value;
+            frame->button_count++;
+        }
+        else
+            JSMAPPER_LOG_WARNING_RATELIMITED( "unknown key code: 0x%x!", (uint) code );
+        break;
+        
+    case EV_ABS:
+        axis_id = jsmapper_core_map_axis( core, code );
+        if( axis_id >= 0 ) {
+            // JSMAPPER_LOG_DEBUG( "filter( axis ID=%u, value=%i )", axis_id, value );
+
+            jsmapper_core_axis_changed( profile, axis_id );
+            filter = _filter_axis( profile, axis_id, value );
+            
+            set_bit( axis_id, frame->axes );
+            frame->axis_values[ axis_id ] = value;
+        }
+        else
+            JSMAPPER_LOG_WARNING_RATELIMITED( "unknown axis code: 0x%x!", (uint) code );
+        break;
+        
+    case EV_SYN:
+        if( code == SYN_REPORT ) {
+            _resolve_frame( core, profile );
+            core->sequence++;
+            if( core->bank_cycle ) {
+                core->bank_cycle = 0;
+                _cycle_bank( core );
+            }
+        }
+        break;
+        
+    default:
+        break;
+    }
+    
+    rcu_read_unlock();
+	
+	return filter;
 }
 
 
-void jsmapper_core_set_profile_name( struct jsmapdev_core * core, char * profile_name )
+int jsmapper_core_set_profile_name( struct jsmapdev_core_profile * profile, const char * profile_name )
 {
-	if( core->profile_name && core->profile_name != profile_name ) {
-		kfree( core->profile_name );
+	char * name = NULL;
+	
+	if( profile_name ) {
+		name = jsmapper_core_alloc( profile, strlen( profile_name ) + 1 );
+		if( name == NULL )
+			return -ENOMEM;
+		
+		strcpy( name, profile_name );
 	}
 
-	core->profile_name = profile_name;
+	/* old name, if any, stays in the arena until the profile is destroyed: */
+	profile->profile_name = name;
+	return 0;
 }
 
-char * jsmapper_core_get_profile_name( struct jsmapdev_core * core )
+char * jsmapper_core_get_profile_name( struct jsmapdev_core_profile * profile )
 {
-	return core->profile_name;
+	return profile->profile_name;
 }
 
 
+
 /********************************************************************************************************
  * 
- * Mode management functions
+ * Profile functions
  * 
  ********************************************************************************************************/
 
-int jsmapper_core_add_mode( struct jsmapdev_core * core, struct t_JSMAPPER_MODE * mode_p )
+/**
+ * Adds a new chunk to an arena, big enough for a block of the given size
+ */
+static int _arena_grow( struct jsmapdev_core_arena * arena, size_t size, size_t chunk_size )
 {
-    int ret = -EINVAL;
-    
-    if( core && mode_p ) {
-        struct jsmapdev_core_mode * parent_mode = jsmapper_core_find_mode( core->root_mode, mode_p->parent_mode_id );
-        if( parent_mode ) {
-			struct jsmapdev_core_mode * mode = jsmapper_core_init_mode( core );
-            if( mode ) {
-                
-                mode->mode_id = ++core->last_mode_id;
-                mode->parent = parent_mode;
-                list_add_tail( &mode->child_item, &parent_mode->children_list );
-                
-                mode->condition_type = mode_p->condition_type;
-                if( mode->condition_type == JSMAPPER_MODE_CONDITION_BUTTON ) {
-					mode->condition.button.id = mode_p->condition.button.id;
-                } else if( mode->condition_type == JSMAPPER_MODE_CONDITION_AXIS ) {
-					mode->condition.axis.id = mode_p->condition.axis.id;
-					mode->condition.axis.low = mode_p->condition.axis.low;
-					mode->condition.axis.high = mode_p->condition.axis.high;
-                }
-                
-                JSMAPPER_LOG_INFO( "created new mode ID=%u", (uint) mode->mode_id );
-                mode_p->mode_id = mode->mode_id;
-                ret = 0;
-                        
-            } else {
-                JSMAPPER_LOG_ERROR( "failed to allocate new mode!" );
-                ret = -ENOMEM;
-            }
-            
-        } else {
-            JSMAPPER_LOG_ERROR( "invalid parent mode ID: %u", (uint) mode_p->parent_mode_id );
-        }
-    }
-    
-    return ret;
+	struct jsmapdev_core_arena_chunk * chunk = NULL;
+	
+	if( chunk_size < size )
+		chunk_size = size;
+	
+	chunk = kmalloc( sizeof(struct jsmapdev_core_arena_chunk) + chunk_size, GFP_KERNEL );
+	if( chunk == NULL ) {
+		JSMAPPER_LOG_ERROR( "unable to allocate %u-byte profile memory chunk!", (uint) chunk_size );
+		return -ENOMEM;
+	}
+	
+	chunk->size = chunk_size;
+	chunk->used = 0;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	
+	return 0;
+}
+
+static void * _arena_alloc( struct jsmapdev_core_arena * arena, size_t size )
+{
+	struct jsmapdev_core_arena_chunk * chunk = arena->chunks;
+	void * block = NULL;
+	
+	size = ALIGN( size, JSMAPPER_CORE_ARENA_ALIGN );
+	if( chunk == NULL || chunk->size - chunk->used < size ) {
+		/* space left in current chunk is wasted; bigger profiles will most probably keep growing: */
+		if( _arena_grow( arena, size, chunk ? min_t( size_t, chunk->size * 2, JSMAPPER_CORE_ARENA_CHUNK_MAX ) 
+		                                    : JSMAPPER_CORE_ARENA_CHUNK_SIZE ) != 0 )
+			return NULL;
+		chunk = arena->chunks;
+	}
+	
+	block = chunk->data + chunk->used;
+	chunk->used += size;
+	memset( block, 0, size );
+	
+	return block;
+}
+
+static size_t _arena_used( struct jsmapdev_core_arena * arena )
+{
+	struct jsmapdev_core_arena_chunk * chunk = NULL;
+	size_t used = 0;
+	
+	for( chunk = arena->chunks; chunk; chunk = chunk->next ) {
+		used += chunk->used;
+	}
+	
+	return used;
+}
+
+static void _arena_free( struct jsmapdev_core_arena * arena )
+{
+	struct jsmapdev_core_arena_chunk * chunk = arena->chunks;
+	struct jsmapdev_core_arena_chunk * next = NULL;
+	
+	while( chunk ) {
+		next = chunk->next;
+		kfree( chunk );
+		chunk = next;
+	}
+	
+	arena->chunks = NULL;
+}
+
+
+struct jsmapdev_core_profile * jsmapper_core_create_profile( struct jsmapdev_core * core, size_t size )
+{
+	struct jsmapdev_core_profile * profile = NULL;
+	struct jsmapdev_core_arena arena = { NULL };
+	int i = 0;
+	
+	/* the profile itself is the first block of its own arena: */
+	size += ALIGN( sizeof(struct jsmapdev_core_profile), JSMAPPER_CORE_ARENA_ALIGN );
+	if( _arena_grow( &arena, sizeof(struct jsmapdev_core_profile), 
+	                 clamp_t( size_t, size, JSMAPPER_CORE_ARENA_CHUNK_SIZE, JSMAPPER_CORE_ARENA_CHUNK_MAX ) ) != 0 ) {
+		_core_count( core, alloc_failures );
+		return NULL;
+	}
+	
+	profile = _arena_alloc( &arena, sizeof(struct jsmapdev_core_profile) );
+	profile->arena = arena;
+	profile->core = core;
+	kref_init( &profile->ref );
+	
+	/* effective button actions table & reverse trigger index: */
+	profile->button_table = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_button_action *) * core->button_count );
+	profile->button_modes = jsmapper_core_alloc( profile, sizeof(struct list_head) * core->button_count );
+	profile->axis_modes = jsmapper_core_alloc( profile, sizeof(struct list_head) * core->axis_count );
+	if( profile->button_table == NULL || profile->button_modes == NULL || profile->axis_modes == NULL ) {
+		JSMAPPER_LOG_ERROR( "unable to allocate %u-button action table!", core->button_count );
+		jsmapper_core_destroy_profile( profile );
+		return NULL;
+	}
+	for( i = 0; i < core->button_count; i++ ) {
+		INIT_LIST_HEAD( &profile->button_modes[ i ] );
+	}
+	for( i = 0; i < core->axis_count; i++ ) {
+		INIT_LIST_HEAD( &profile->axis_modes[ i ] );
+	}
+	
+	/* generation 0 is reserved for never-resolved axis caches: */
+	profile->generation = 1;
+	
+	/* initialize mode structure */
+	profile->root_mode = jsmapper_core_init_mode( profile, 1 );
+	profile->last_mode_id = 0;
+	if( _register_mode( profile, profile->root_mode ) != 0 
+			|| jsmapper_core_flatten_modes( profile ) != 0 ) {
+		jsmapper_core_destroy_profile( profile );
+		return NULL;
+	}
+	
+	return profile;
+}
+
+
+static void _free_profile( struct kref * ref )
+{
+	struct jsmapdev_core_profile * profile = container_of( ref, struct jsmapdev_core_profile, ref );
+	struct jsmapdev_core_arena arena;
+	
+	/* profile struct lives inside the arena too: */
+	arena = profile->arena;
+	_arena_free( &arena );
+}
+
+
+void jsmapper_core_destroy_profile( struct jsmapdev_core_profile * profile )
+{
+	if( profile ) {
+		jsmapper_core_put_profile( profile );
+	}
+}
+
+
+void jsmapper_core_hold_profile( struct jsmapdev_core_profile * profile )
+{
+	kref_get( &profile->ref );
+}
+
+
+void jsmapper_core_put_profile( struct jsmapdev_core_profile * profile )
+{
+	kref_put( &profile->ref, _free_profile );
+}
+
+
+void * jsmapper_core_alloc( struct jsmapdev_core_profile * profile, size_t size )
+{
+	void * block = _arena_alloc( &profile->arena, size );
+	
+	if( block == NULL )
+		_core_count( profile->core, alloc_failures );
+	return block;
+}
+
+
+struct jsmapdev_core_profile * jsmapper_core_clone_profile( struct jsmapdev_core_profile * profile )
+{
+	struct jsmapdev_core				* core = profile->core;
+	struct jsmapdev_core_profile		* clone = NULL;
+	struct jsmapdev_core_mode			* mode = NULL;
+	struct jsmapdev_core_button_action	* button_assign = NULL;
+	struct jsmapdev_core_axis_actions	* axis_actions = NULL;
+	struct jsmapdev_core_axis_action	* axis_assign = NULL;
+	struct t_JSMAPPER_MODE				mode_p;
+	uint	i = 0;
+	int		b = 0, a = 0;
+	int		ret = 0;
+	
+	/* the copy will need about the same memory as the original: */
+	clone = jsmapper_core_create_profile( core, _arena_used( &profile->arena ) );
+	if( clone == NULL )
+		return NULL;
+	
+	clone->loading = 1;
+	
+	/* mode IDs are assigned sequentially, and parents are always created before their children: */
+	for( i = 1; i <= profile->last_mode_id && ret == 0; i++ ) {
+		mode = jsmapper_core_find_mode( profile, i );
+		memset( &mode_p, 0, sizeof( mode_p ) );
+		mode_p.parent_mode_id = mode->parent->mode_id;
+		mode_p.condition_type = mode->condition_type;
+		if( mode->condition_type == JSMAPPER_MODE_CONDITION_BUTTON ) {
+			mode_p.condition.button.id = mode->condition.button.id;
+		} else if( mode->condition_type == JSMAPPER_MODE_CONDITION_AXIS ) {
+			mode_p.condition.axis.id = mode->condition.axis.id;
+			mode_p.condition.axis.low = mode->condition.axis.low;
+			mode_p.condition.axis.high = mode->condition.axis.high;
+		}
+		ret = jsmapper_core_add_mode( clone, &mode_p );
+	}
+	
+	for( i = 0; i <= profile->last_mode_id && ret == 0; i++ ) {
+		mode = jsmapper_core_find_mode( profile, i );
+		for( b = 0; b < core->button_count && ret == 0; b++ ) {
+			button_assign = jsmapper_core_mode_button( mode, b );
+			if( button_assign && ( button_assign->action.type != JSMAPPER_ACTION_DEFAULT || button_assign->filter ) ) {
+				ret = jsmapper_core_set_button_action( clone, b, i, button_assign );
+			}
+		}
+		
+		/* bands are added to the head of the list, so walk it backwards to keep their precedence: */
+		for( a = 0; a < core->axis_count && ret == 0; a++ ) {
+			axis_actions = jsmapper_core_mode_axis( mode, a );
+			if( axis_actions == NULL )
+				continue;
+			
+			list_for_each_entry_reverse( axis_assign, &axis_actions->action_list, child_item ) {
+				ret = jsmapper_core_set_axis_action( clone, a, i, axis_assign );
+				if( ret != 0 )
+					break;
+			}
+		}
+	}
+	
+	if( ret == 0 ) {
+		ret = jsmapper_core_set_profile_name( clone, profile->profile_name );
+	}
+	
+	if( ret != 0 ) {
+		JSMAPPER_LOG_ERROR( "failed to copy profile (error %i)!", ret );
+		jsmapper_core_destroy_profile( clone );
+		return NULL;
+	}
+	
+	return clone;
+}
+
+
+struct jsmapdev_core_profile * jsmapper_core_get_profile( struct jsmapdev_core * core )
+{
+	/* the event filter may switch banks meanwhile, but profiles are only destroyed by callers serialized with this 
+	 * one, so the one returned stays valid without the RCU read lock: */
+	return rcu_dereference_protected( core->profile, 1 );
+}
+
+
+struct jsmapdev_core_profile * jsmapper_core_get_staging( struct jsmapdev_core * core )
+{
+	if( core->staging == NULL ) {
+		core->staging = jsmapper_core_clone_profile( jsmapper_core_get_profile( core ) );
+	}
+	
+	return core->staging;
+}
+
+
+/**
+ * Sends the release event for every action an unpublished profile still keeps active: current axis band 
+ * actions, and the actions of the buttons still pressed.
+ */
+static void _release_actions( struct jsmapdev_core_profile * profile )
+{
+	struct jsmapdev_core * core = profile->core;
+	int i = 0;
+	
+	for( i = 0; i < core->axis_count; i++ ) {
+		if( profile->current_axis_action[ i ] ) {
+			JSMAPPER_LOG_DEBUG( "Deactivating old action for axis ID=%u on profile switch", i );
+			jsmapper_evgen_send_action( core->evgen, &profile->current_axis_action[ i ]->action, 0 );
+			profile->current_axis_action[ i ] = NULL;
+		}
+	}
+	
+	for( i = 0; i < core->button_count; i++ ) {
+		/* bank button actions never get pressed: */
+		if( i == core->bank_button )
+			continue;
+		
+		if( profile->button_table[ i ] && test_bit( core->button_rmap[ i ], core->dev->key ) ) {
+			jsmapper_evgen_send_action( core->evgen, &profile->button_table[ i ]->action, 0 );
+		}
+	}
+}
+
+
+/**
+ * Makes a profile the one used by the event filter, releasing the actions the previous one still keeps active. 
+ * Must be called under the device's event lock, which keeps the event filter out.
+ */
+static void _switch_profile( struct jsmapdev_core * core, struct jsmapdev_core_profile * profile )
+{
+	struct jsmapdev_core_profile	* old = rcu_dereference_protected( core->profile, 1 );
+	
+	if( old && old != profile )
+		_release_actions( old );
+	
+	/* a banked profile may have been published before: axis resolutions cached back then don't hold any more */
+	profile->generation++;
+	jsmapper_core_update_modes( profile );
+	rcu_assign_pointer( core->profile, profile );
+	core->sequence++;
+	core->profile_generation++;
+	_notify( core, JSMAPPER_EVENT_PROFILE, 0, 0, 0, 0 );
+}
+
+
+void jsmapper_core_publish( struct jsmapdev_core * core, struct jsmapdev_core_profile * profile )
+{
+	jsmapper_core_store( core, JSMAPPER_CORE_BANK_ACTIVE, profile );
+}
+
+
+void jsmapper_core_store( struct jsmapdev_core * core, int bank, struct jsmapdev_core_profile * profile )
+{
+	struct jsmapdev_core_profile	* old = NULL;
+	unsigned long					flags = 0;
+	
+	if( profile == core->staging )
+		core->staging = NULL;
+	
+	/* the event filter may switch banks on its own, so the active one is only known under the event lock. Triggers 
+	 * are evaluated under it as well, so no input change gets lost between evaluation & publication: */
+	spin_lock_irqsave( &core->dev->event_lock, flags );
+	if( bank == JSMAPPER_CORE_BANK_ACTIVE )
+		bank = core->bank;
+	old = core->banks[ bank ];
+	core->banks[ bank ] = profile;
+	if( bank == core->bank )
+		_switch_profile( core, profile );
+	spin_unlock_irqrestore( &core->dev->event_lock, flags );
+	
+	if( old ) {
+		/* wait for any event still being handled with old programming: */
+		synchronize_rcu();
+		jsmapper_core_destroy_profile( old );
+	}
+	
+	JSMAPPER_LOG_INFO( "stored profile '%s' in bank %i", profile->profile_name ? profile->profile_name : "", bank + 1 );
+}
+
+
+int jsmapper_core_select_bank( struct jsmapdev_core * core, uint bank )
+{
+	unsigned long					flags = 0;
+	int								ret = 0;
+	
+	if( bank >= JSMAPPER_BANK_COUNT )
+		return -EINVAL;
+	
+	spin_lock_irqsave( &core->dev->event_lock, flags );
+	if( core->banks[ bank ] == NULL ) {
+		ret = -ENOENT;
+	} else if( bank != core->bank ) {
+		core->bank = bank;
+		_switch_profile( core, core->banks[ bank ] );
+	}
+	spin_unlock_irqrestore( &core->dev->event_lock, flags );
+	
+	if( ret == 0 )
+		JSMAPPER_LOG_DEBUG( "selected bank %u", bank + 1 );
+	return ret;
+}
+
+
+void jsmapper_core_get_banks( struct jsmapdev_core * core, struct t_JSMAPPER_BANKS * banks )
+{
+	unsigned long					flags = 0;
+	uint							i = 0;
+	
+	memset( banks, 0, sizeof( *banks ) );
+	
+	spin_lock_irqsave( &core->dev->event_lock, flags );
+	banks->active = core->bank + 1;
+	banks->button = core->bank_button;
+	for( i = 0; i < JSMAPPER_BANK_COUNT; i++ ) {
+		if( core->banks[ i ] )
+			banks->loaded |= 1u << i;
+	}
+	spin_unlock_irqrestore( &core->dev->event_lock, flags );
+}
+
+
+/**
+ * Switches to the next non-empty bank. Called from the event filter, once the input frame is complete.
+ */
+static void _cycle_bank( struct jsmapdev_core * core )
+{
+	uint i, bank;
+	
+	for( i = 1; i < JSMAPPER_BANK_COUNT; i++ ) {
+		bank = ( core->bank + i ) % JSMAPPER_BANK_COUNT;
+		if( core->banks[ bank ] ) {
+			core->bank = bank;
+			_switch_profile( core, core->banks[ bank ] );
+			return;
+		}
+	}
+}
+
+
+int jsmapper_core_set_bank_button( struct jsmapdev_core * core, int button_id )
+{
+	unsigned long					flags = 0;
+	
+	if( button_id < -1 || button_id >= core->button_count )
+		return -EINVAL;
+	
+	spin_lock_irqsave( &core->dev->event_lock, flags );
+	core->bank_button = button_id;
+	core->bank_cycle = 0;
+	spin_unlock_irqrestore( &core->dev->event_lock, flags );
+	
+	return 0;
+}
+
+
+int jsmapper_core_commit( struct jsmapdev_core * core )
+{
+	struct jsmapdev_core_profile * staging = core->staging;
+	int ret = 0;
+	
+	if( staging ) {
+		/* deferred work for all the programming received since staging was created: */
+		staging->loading = 0;
+		ret = _finish_profile( staging );
+		if( ret != 0 ) {
+			JSMAPPER_LOG_ERROR( "failed to commit profile (error %i)!", ret );
+			staging->loading = 1;
+			return ret;
+		}
+		
+		jsmapper_core_publish( core, staging );
+	}
+	
+	return 0;
+}
+
+/********************************************************************************************************
+ * 
+ * Mode management functions
+ * 
+ ********************************************************************************************************/
+
+/**
+ * Stores a mode in profile's ID-indexed mode table, growing it if needed
+ */
+static int _register_mode( struct jsmapdev_core_profile * profile, struct jsmapdev_core_mode * mode )
+{
+	struct jsmapdev_core_mode ** table = NULL;
+	uint size = 0;
+	uint i = 0;
+	
+	if( mode == NULL )
+		return -EINVAL;
+	
+	if( mode->mode_id >= profile->mode_table_size ) {
+		size = profile->mode_table_size ? profile->mode_table_size : 16;
+		while( size <= mode->mode_id )
+			size *= 2;
+		
+		/* old table is left in the arena; geometric growth keeps the waste bounded: */
+		table = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_mode *) * size );
+		if( table == NULL ) {
+			JSMAPPER_LOG_ERROR( "unable to grow mode table to %u entries!", size );
+			return -ENOMEM;
+		}
+		
+		for( i = 0; i < profile->mode_table_size; i++ ) {
+			table[ i ] = profile->mode_table[ i ];
+		}
+		
+		profile->mode_table = table;
+		profile->mode_table_size = size;
+	}
+	
+	profile->mode_table[ mode->mode_id ] = mode;
+	return 0;
+}
+
+int jsmapper_core_add_mode( struct jsmapdev_core_profile * profile, struct t_JSMAPPER_MODE * mode_p )
+{
+    int ret = -EINVAL;
+    
+    if( profile && mode_p ) {
+        struct jsmapdev_core_mode * parent_mode = jsmapper_core_find_mode( profile, mode_p->parent_mode_id );
+        if( parent_mode ) {
+			struct jsmapdev_core_mode * mode = jsmapper_core_init_mode( profile, 0 );
+            if( mode ) {
+                
+                mode->mode_id = profile->last_mode_id + 1;
+                if( _register_mode( profile, mode ) != 0 ) {
+                    return -ENOMEM;
+                }
+                
+                profile->last_mode_id = mode->mode_id;
+                mode->parent = parent_mode;
+                list_add_tail( &mode->child_item, &parent_mode->children_list );
+                
+                mode->condition_type = mode_p->condition_type;
+                if( mode->condition_type == JSMAPPER_MODE_CONDITION_BUTTON ) {
+					mode->condition.button.id = mode_p->condition.button.id;
+                } else if( mode->condition_type == JSMAPPER_MODE_CONDITION_AXIS ) {
+					mode->condition.axis.id = mode_p->condition.axis.id;
+					mode->condition.axis.low = mode_p->condition.axis.low;
+					mode->condition.axis.high = mode_p->condition.axis.high;
+                }
+                
+                JSMAPPER_LOG_INFO( "created new mode ID=%u", (uint) mode->mode_id );
+                mode_p->mode_id = mode->mode_id;
+                /* while loading a profile blob, the list will be flattened once at the end: */
+                if( profile->loading == 0 )
+                    ret = jsmapper_core_flatten_modes( profile );
+                else
+                    ret = 0;
+                        
+            } else {
+                JSMAPPER_LOG_ERROR( "failed to allocate new mode!" );
+                ret = -ENOMEM;
+            }
+            
+        } else {
+            JSMAPPER_LOG_ERROR( "invalid parent mode ID: %u", (uint) mode_p->parent_mode_id );
+        }
+    }
+    
+    return ret;
+}
+
+
+struct jsmapdev_core_mode * jsmapper_core_init_mode( struct jsmapdev_core_profile * profile, int dense )
+{
+	struct jsmapdev_core * core = profile->core;
+	int i = 0;
+	
+	struct jsmapdev_core_mode * mode = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_mode) );
+	if( mode ) {
+        mode->parent = NULL;
+        mode->mode_id = 0;
+        mode->condition_type = JSMAPPER_MODE_CONDITION_NONE;
+        memset( &mode->condition, 0, sizeof( mode->condition ) );
+        INIT_LIST_HEAD( &mode->child_item );
+        INIT_LIST_HEAD( &mode->children_list );
+        INIT_LIST_HEAD( &mode->condition_item );
+        
+		/* submodes start empty, their overrides get allocated as they are set: */
+		if( !dense )
+			return mode;
+		
+		// buttons array
+		mode->buttons = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_button_action) * core->button_count );
+		if( mode->buttons ) {
+			for( i = 0; i < core->button_count; i++ ) {
+				mode->buttons[i].filter = false;
+				jsmapper_core_init_action( &mode->buttons[i].action );
+			}
+		}
+		else
+			JSMAPPER_LOG_ERROR( "unable to allocate %u-button array!", core->button_count );
+		
+		// axes array:
+		mode->axes = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_axis_actions) * core->axis_count );
+		if( mode->axes ) {
+			for( i = 0; i < core->axis_count; i++ ) {
+				jsmapper_core_init_axis_actions( &mode->axes[i] );
+			}
+		}
+		else
+			JSMAPPER_LOG_ERROR( "unable to allocate %u-axis array!", core->axis_count );
+	}
+	else
+		JSMAPPER_LOG_ERROR( "unable to allocate a mode structure!" );
+	
+	return mode;
+}
+
+
+struct jsmapdev_core_mode * jsmapper_core_find_mode( struct jsmapdev_core_profile * profile, uint mode_id )
+{
+    if( mode_id < profile->mode_table_size )
+        return profile->mode_table[ mode_id ];
+
+    return NULL;
+}
+
+
+/**
+ * Returns the position of a button in a submode's override array, or the position where it should be inserted.
+ */
+static uint _button_override_pos( struct jsmapdev_core_mode * mode, uint button_id )
+{
+	uint lo = 0, hi = mode->button_override_count, mid = 0;
+	
+	while( lo < hi ) {
+		mid = lo + ( hi - lo ) / 2;
+		if( mode->button_overrides[ mid ].id < button_id )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	
+	return lo;
+}
+
+
+/**
+ * Returns the position of an axis in a submode's override array, or the position where it should be inserted.
+ */
+static uint _axis_override_pos( struct jsmapdev_core_mode * mode, uint axis_id )
+{
+	uint lo = 0, hi = mode->axis_override_count, mid = 0;
+	
+	while( lo < hi ) {
+		mid = lo + ( hi - lo ) / 2;
+		if( mode->axis_overrides[ mid ].id < axis_id )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	
+	return lo;
+}
+
+
+struct jsmapdev_core_button_action * jsmapper_core_mode_button( struct jsmapdev_core_mode * mode, uint button_id )
+{
+	uint pos = 0;
+	
+	if( mode->buttons )
+		return &mode->buttons[ button_id ];
+	
+	pos = _button_override_pos( mode, button_id );
+	if( pos < mode->button_override_count && mode->button_overrides[ pos ].id == button_id )
+		return &mode->button_overrides[ pos ].assign;
+	
+	return NULL;
+}
+
+
+struct jsmapdev_core_axis_actions * jsmapper_core_mode_axis( struct jsmapdev_core_mode * mode, uint axis_id )
+{
+	uint pos = 0;
+	
+	if( mode->axes )
+		return &mode->axes[ axis_id ];
+	
+	pos = _axis_override_pos( mode, axis_id );
+	if( pos < mode->axis_override_count && mode->axis_overrides[ pos ].id == axis_id )
+		return mode->axis_overrides[ pos ].actions;
+	
+	return NULL;
+}
+
+
+/**
+ * Returns the button action defined by a mode, adding a default one to the override array if needed. Growing 
+ * the array moves its entries, so the effective button table must be rebuilt afterwards.
+ */
+static struct jsmapdev_core_button_action * _mode_button_slot( struct jsmapdev_core_profile * profile, 
+                                                               struct jsmapdev_core_mode * mode, uint button_id )
+{
+	struct jsmapdev_core_button_override * overrides = NULL;
+	uint pos = 0;
+	uint size = 0;
+	
+	if( mode->buttons )
+		return &mode->buttons[ button_id ];
+	
+	pos = _button_override_pos( mode, button_id );
+	if( pos < mode->button_override_count && mode->button_overrides[ pos ].id == button_id )
+		return &mode->button_overrides[ pos ].assign;
+	
+	if( mode->button_override_count == mode->button_override_size ) {
+		size = min_t( uint, max_t( uint, 4, mode->button_override_size * 2 ), profile->core->button_count );
+		overrides = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_button_override) * size );
+		if( overrides == NULL ) {
+			JSMAPPER_LOG_ERROR( "unable to allocate %u-button override array!", size );
+			return NULL;
+		}
+		
+		/* old array stays in the arena until the profile is destroyed: */
+		if( mode->button_override_count > 0 )
+			memcpy( overrides, mode->button_overrides, sizeof(struct jsmapdev_core_button_override) * mode->button_override_count );
+		mode->button_overrides = overrides;
+		mode->button_override_size = size;
+	}
+	
+	memmove( &mode->button_overrides[ pos + 1 ], &mode->button_overrides[ pos ], 
+	         sizeof(struct jsmapdev_core_button_override) * ( mode->button_override_count - pos ) );
+	mode->button_override_count++;
+	
+	mode->button_overrides[ pos ].id = button_id;
+	mode->button_overrides[ pos ].assign.filter = false;
+	jsmapper_core_init_action( &mode->button_overrides[ pos ].assign.action );
+	
+	return &mode->button_overrides[ pos ].assign;
+}
+
+
+/**
+ * Returns the axis bands defined by a mode, adding an empty band list to the override array if needed.
+ */
+static struct jsmapdev_core_axis_actions * _mode_axis_slot( struct jsmapdev_core_profile * profile, 
+                                                            struct jsmapdev_core_mode * mode, uint axis_id )
+{
+	struct jsmapdev_core_axis_override * overrides = NULL;
+	struct jsmapdev_core_axis_actions * actions = NULL;
+	uint pos = 0;
+	uint size = 0;
+	
+	if( mode->axes )
+		return &mode->axes[ axis_id ];
+	
+	pos = _axis_override_pos( mode, axis_id );
+	if( pos < mode->axis_override_count && mode->axis_overrides[ pos ].id == axis_id )
+		return mode->axis_overrides[ pos ].actions;
+	
+	/* band lists are linked through their heads, so they get their own block & never move: */
+	actions = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_axis_actions) );
+	if( actions == NULL ) {
+		JSMAPPER_LOG_ERROR( "unable to allocate axis override!" );
+		return NULL;
+	}
+	jsmapper_core_init_axis_actions( actions );
+	
+	if( mode->axis_override_count == mode->axis_override_size ) {
+		size = min_t( uint, max_t( uint, 4, mode->axis_override_size * 2 ), profile->core->axis_count );
+		overrides = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_axis_override) * size );
+		if( overrides == NULL ) {
+			JSMAPPER_LOG_ERROR( "unable to allocate %u-axis override array!", size );
+			return NULL;
+		}
+		
+		if( mode->axis_override_count > 0 )
+			memcpy( overrides, mode->axis_overrides, sizeof(struct jsmapdev_core_axis_override) * mode->axis_override_count );
+		mode->axis_overrides = overrides;
+		mode->axis_override_size = size;
+	}
+	
+	memmove( &mode->axis_overrides[ pos + 1 ], &mode->axis_overrides[ pos ], 
+	         sizeof(struct jsmapdev_core_axis_override) * ( mode->axis_override_count - pos ) );
+	mode->axis_override_count++;
+	
+	mode->axis_overrides[ pos ].id = axis_id;
+	mode->axis_overrides[ pos ].actions = actions;
+	
+	return actions;
+}
+
+
+int jsmapper_core_mode_is_active( struct jsmapdev_core_profile * profile, struct jsmapdev_core_mode * mode )
+{
+	struct jsmapdev_core * core = profile->core;
+	int result = 0;
+	
+	switch( mode->condition_type ) {
+	case JSMAPPER_MODE_CONDITION_BUTTON:
+		if( mode->condition.button.id >= 0 && mode->condition.button.id < core->button_count ) {
+			uint key = core->button_rmap[ mode->condition.button.id ];
+			if( test_bit( key, core->dev->key) ) {
+				result = 1;
+			}
+		}
+		break;
+	
+	case JSMAPPER_MODE_CONDITION_AXIS:
+		if( mode->condition.axis.id >= 0 && mode->condition.axis.id < core->axis_count ) {
+			uint axis = core->axis_rmap[ mode->condition.axis.id ];
+			int value = input_abs_get_val( core->dev, axis );
+			if( value >= mode->condition.axis.low && value <= mode->condition.axis.high ) {
+				result = 1;
+			}
+		}
+		break;
+	}
+	
+	return result;
+}
+
+
+/**
+ * Recomputes the active bit of every mode in the [first, end) range of the flattened list, given their 
+ * 'triggered' flags. Pre-order guarantees parents are evaluated before their children. Returns non-zero 
+ * if any bit changed.
+ */
+static int _update_active_modes( struct jsmapdev_core_profile * profile, uint first, uint end )
+{
+	struct jsmapdev_core_mode * mode = NULL;
+	int changed = 0;
+	int active = 0;
+	uint i = 0;
+	
+	for( i = first; i < end; i++ ) {
+		mode = profile->mode_list[ i ];
+		if( mode->parent == NULL ) {
+			active = 1;
+		} else {
+			active = test_bit( mode->parent->index, profile->active_modes ) && mode->triggered;
+		}
+		
+		if( active != test_bit( i, profile->active_modes ) ) {
+			trace_jsmapper_mode( profile->core->dev, mode->mode_id, active );
+			if( rcu_access_pointer( profile->core->profile ) == profile )
+				_notify( profile->core, JSMAPPER_EVENT_MODE, 0, mode->mode_id, active, 0 );
+			if( active )
+				set_bit( i, profile->active_modes );
+			else
+				clear_bit( i, profile->active_modes );
+			changed = 1;
+		}
+	}
+	
+	return changed;
+}
+
+/**
+ * Single point where the effects of an active mode set change are applied
+ */
+static void _active_modes_changed( struct jsmapdev_core_profile * profile )
+{
+	jsmapper_core_build_button_table( profile );
+	profile->generation++;
+}
+
+/**
+ * Re-evaluates the trigger of every mode in a reverse index list, updating the active bits of the modes 
+ * whose trigger changed along with their submodes.
+ */
+static void _trigger_changed( struct jsmapdev_core_profile * profile, struct list_head * modes )
+{
+	struct jsmapdev_core_mode * mode = NULL;
+	int triggered = 0;
+	int changed = 0;
+	
+	list_for_each_entry( mode, modes, condition_item ) {
+		triggered = jsmapper_core_mode_is_active( profile, mode );
+		if( triggered != mode->triggered ) {
+			mode->triggered = triggered;
+			if( _update_active_modes( profile, mode->index, mode->subtree_end ) )
+				changed = 1;
+		}
+	}
+	
+	if( changed ) {
+		_active_modes_changed( profile );
+	}
+}
+
+static uint _count_modes( struct jsmapdev_core_mode * mode )
+{
+	struct jsmapdev_core_mode * child = NULL;
+	uint count = 1;
+	
+	list_for_each_entry( child, &mode->children_list, child_item ) {
+		count += _count_modes( child );
+	}
+	
+	return count;
+}
+
+static uint _flatten_mode( struct jsmapdev_core_mode ** list, uint pos, struct jsmapdev_core_mode * mode )
+{
+	struct jsmapdev_core_mode * child = NULL;
+	
+	mode->index = pos;
+	list[ pos++ ] = mode;
+	list_for_each_entry( child, &mode->children_list, child_item ) {
+		pos = _flatten_mode( list, pos, child );
+	}
+	mode->subtree_end = pos;
+	
+	return pos;
+}
+
+
+int jsmapper_core_flatten_modes( struct jsmapdev_core_profile * profile )
+{
+	struct jsmapdev_core * core = profile->core;
+	struct jsmapdev_core_mode ** list = NULL;
+	struct jsmapdev_core_mode * mode = NULL;
+	unsigned long * active_modes = NULL;
+	uint count = 0;
+	uint i = 0;
+	
+	if( profile->root_mode == NULL )
+		return -EINVAL;
+	
+	count = _count_modes( profile->root_mode );
+	list = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_mode *) * count );
+	active_modes = jsmapper_core_alloc( profile, sizeof(unsigned long) * BITS_TO_LONGS( count ) );
+	if( list == NULL || active_modes == NULL ) {
+		JSMAPPER_LOG_ERROR( "unable to allocate %u-mode list!", count );
+		return -ENOMEM;
+	}
+	
+	_flatten_mode( list, 0, profile->root_mode );
+	
+	profile->mode_list = list;
+	profile->mode_count = count;
+	profile->active_modes = active_modes;
+	
+	/* rebuild reverse trigger index; pre-order insertion ensures parents get updated before their children: */
+	for( i = 0; i < core->button_count; i++ ) {
+		INIT_LIST_HEAD( &profile->button_modes[ i ] );
+	}
+	for( i = 0; i < core->axis_count; i++ ) {
+		INIT_LIST_HEAD( &profile->axis_modes[ i ] );
+	}
+	for( i = 0; i < count; i++ ) {
+		mode = list[ i ];
+		if( mode->condition_type == JSMAPPER_MODE_CONDITION_BUTTON 
+				&& mode->condition.button.id < core->button_count ) {
+			list_add_tail( &mode->condition_item, &profile->button_modes[ mode->condition.button.id ] );
+		} else if( mode->condition_type == JSMAPPER_MODE_CONDITION_AXIS
+				&& mode->condition.axis.id < core->axis_count ) {
+			list_add_tail( &mode->condition_item, &profile->axis_modes[ mode->condition.axis.id ] );
+		}
+	}
+	
+	/* new modes must be evaluated, and table rebuilt even if no mode changed its state: */
+	if( jsmapper_core_update_modes( profile ) == 0 ) {
+		_active_modes_changed( profile );
+	}
+	
+	return 0;
+}
+
+
+int jsmapper_core_update_modes( struct jsmapdev_core_profile * profile )
+{
+	struct jsmapdev_core_mode * mode = NULL;
+	int changed = 0;
+	uint i = 0;
+	
+	for( i = 0; i < profile->mode_count; i++ ) {
+		mode = profile->mode_list[ i ];
+		if( mode->parent == NULL ) {
+			mode->triggered = 1;
+		} else {
+			mode->triggered = jsmapper_core_mode_is_active( profile, mode );
+		}
+	}
+	
+	changed = _update_active_modes( profile, 0, profile->mode_count );
+	if( changed ) {
+		_active_modes_changed( profile );
+	}
+	
+	return changed;
+}
+
+
+int jsmapper_core_is_mode_active( struct jsmapdev_core_profile * profile, struct jsmapdev_core_mode * mode )
+{
+	return test_bit( mode->index, profile->active_modes );
+}
+
+
+uint jsmapper_core_fill_state( struct jsmapdev_core * core, struct t_JSMAPPER_STATE * state )
+{
+	struct jsmapdev_core_profile	* profile = NULL;
+	struct input_dev				* dev = core->dev;
+	uint							i, id, active_mode = 0;
+	
+	memset( state, 0, sizeof( *state ) );
+	state->sequence = core->sequence;
+	state->button_count = min_t( int, core->button_count, JSMAPPER_STATE_BUTTONS );
+	state->axis_count = min_t( int, core->axis_count, JSMAPPER_STATE_AXES );
+	
+	for( i = 0; i < state->button_count; i++ ) {
+		if( test_bit( core->button_rmap[ i ], dev->key ) )
+			state->buttons[ i / 32 ] |= 1u << ( i % 32 );
+	}
+	for( i = 0; i < state->axis_count; i++ )
+		state->axes[ i ] = input_abs_get_val( dev, core->axis_rmap[ i ] );
+	
+	rcu_read_lock();
+	profile = rcu_dereference( core->profile );
+	state->mode_count = profile->last_mode_id + 1;
+	for( i = 0; i < profile->mode_count; i++ ) {
+		if( !test_bit( i, profile->active_modes ) )
+			continue;
+		
+		/* flattened list is in precedence order, so last active mode wins: */
+		id = profile->mode_list[ i ]->mode_id;
+		active_mode = id;
+		if( id < JSMAPPER_STATE_MODES )
+			state->modes[ id / 32 ] |= 1u << ( id % 32 );
+	}
+	rcu_read_unlock();
+	
+	return active_mode;
+}
+
+
+void jsmapper_core_get_state( struct jsmapdev_core * core, struct t_JSMAPPER_STATE * state )
+{
+	unsigned long					flags = 0;
+	
+	/* the event lock keeps the filter out, so values, modes & sequence all belong to the same frame: */
+	spin_lock_irqsave( &core->dev->event_lock, flags );
+	jsmapper_core_fill_state( core, state );
+	spin_unlock_irqrestore( &core->dev->event_lock, flags );
+}
+
+
+
+/********************************************************************************************************
+ *
+ * Profile blob loading
+ *
+ ********************************************************************************************************/
+
+/**
+ * Returns the options following the key array of a macro action, in version 2 profile blobs
+ */
+static inline const struct t_JSMAPPER_MACRO_OPTIONS * _api_macro_options( const struct t_JSMAPPER_ACTION * api_action )
+{
+	return (const struct t_JSMAPPER_MACRO_OPTIONS *) &api_action->data.macro.keys[ api_action->data.macro.count ];
+}
+
+/**
+ * Checks action type, macro key count & options against the size of the buffer containing the action
+ */
+static int _check_api_action( const struct t_JSMAPPER_ACTION * api_action, size_t size, uint version )
+{
+	size_t macro_size = 0;
+	
+
+	switch( api_action->type )
+	{
+	case JSMAPPER_ACTION_DEFAULT:
+	case JSMAPPER_ACTION_NONE:
+	case JSMAPPER_ACTION_KEY:
+	case JSMAPPER_ACTION_REL:
+		return 0;
+		
+	case JSMAPPER_ACTION_MOTION:
+		if( sizeof( struct t_JSMAPPER_ACTION ) + sizeof( struct t_JSMAPPER_MOTION ) > size ) {
+			JSMAPPER_LOG_ERROR( "motion parameters exceed action size (%u bytes)!", (uint) size );
+			return -EINVAL;
+		}
+		return 0;
+		
+	case JSMAPPER_ACTION_MACRO:
+		macro_size = offsetof( struct t_JSMAPPER_ACTION, data.macro.keys ) 
+				+ sizeof( struct t_JSMAPPER_KEY ) * api_action->data.macro.count;
+		if( version >= 2 )
+			macro_size += sizeof( struct t_JSMAPPER_MACRO_OPTIONS );
+		
+		if( macro_size > size ) {
+			JSMAPPER_LOG_ERROR( "macro key count (%u) exceeds action size (%u bytes)!", 
+								(uint) api_action->data.macro.count, (uint) size );
+			return -EINVAL;
+		}
+		if( version >= 2 && _api_macro_options( api_action )->policy > JSMAPPER_MACRO_CANCEL ) {
+			JSMAPPER_LOG_ERROR( "invalid macro policy (%u)!", (uint) _api_macro_options( api_action )->policy );
+			return -EINVAL;
+		}
+		return 0;
+		
+	default:
+		JSMAPPER_LOG_ERROR( "invalid action type (%i)!", (int) api_action->type );
+		return -EINVAL;
+	}
+}
+
+static int _validate_profile_action( struct jsmapdev_core * core, const struct t_JSMAPPER_PROFILE_HEADER * header, 
+                                     const struct t_JSMAPPER_PROFILE_ACTION * record, size_t avail )
+{
+	if( avail < sizeof( struct t_JSMAPPER_PROFILE_ACTION )
+			|| record->size < sizeof( struct t_JSMAPPER_PROFILE_ACTION )
+			|| record->size > avail
+			|| record->size % 4 != 0 ) {
+		JSMAPPER_LOG_ERROR( "invalid profile action record size!" );
+		return -EINVAL;
+	}
+	
+	if( record->action.mode_id > header->mode_count ) {
+		JSMAPPER_LOG_ERROR( "invalid mode index %u in profile action record!", (uint) record->action.mode_id );
+		return -EINVAL;
+	}
+	
+	switch( record->target )
+	{
+	case JSMAPPER_PROFILE_TARGET_BUTTON:
+		if( record->action.button.id >= core->button_count ) {
+			JSMAPPER_LOG_ERROR( "invalid button ID=%u in profile action record!", (uint) record->action.button.id );
+			return -EINVAL;
+		}
+		break;
+		
+	case JSMAPPER_PROFILE_TARGET_AXIS:
+		if( record->action.axis.id >= core->axis_count ) {
+			JSMAPPER_LOG_ERROR( "invalid axis ID=%u in profile action record!", (uint) record->action.axis.id );
+			return -EINVAL;
+		}
+		break;
+		
+	default:
+		JSMAPPER_LOG_ERROR( "invalid profile action target (%u)!", (uint) record->target );
+		return -EINVAL;
+	}
+	
+	return _check_api_action( &record->action, record->size - offsetof( struct t_JSMAPPER_PROFILE_ACTION, action ), 
+							  header->version );
+}
+
+static int _validate_profile( struct jsmapdev_core * core, const void * blob, size_t size )
+{
+	const struct t_JSMAPPER_PROFILE_HEADER * header = blob;
+	const struct t_JSMAPPER_PROFILE_ACTION * record = NULL;
+	const struct t_JSMAPPER_MODE * mode_p = NULL;
+	size_t offset = 0;
+	uint i = 0;
+	int ret = 0;
+	
+	if( size < sizeof( struct t_JSMAPPER_PROFILE_HEADER ) ) {
+		JSMAPPER_LOG_ERROR( "profile blob too small (%u bytes)!", (uint) size );
+		return -EINVAL;
+	}
+	
+	if( header->magic != JSMAPPER_PROFILE_MAGIC || header->version < 1 || header->version > JSMAPPER_PROFILE_VERSION ) {
+		JSMAPPER_LOG_ERROR( "unsupported profile blob (magic=0x%08x, version=%u)!", header->magic, (uint) header->version );
+		return -EINVAL;
+	}
+	
+	if( header->size != size || header->reserved != 0 ) {
+		JSMAPPER_LOG_ERROR( "invalid profile blob header!" );
+		return -EINVAL;
+	}
+	
+	/* modes: */
+	offset = sizeof( struct t_JSMAPPER_PROFILE_HEADER ) + ALIGN( header->name_length, 4 );
+	if( offset > size || ( size - offset ) / sizeof( struct t_JSMAPPER_MODE ) < header->mode_count ) {
+		JSMAPPER_LOG_ERROR( "truncated profile blob!" );
+		return -EINVAL;
+	}
+	
+	mode_p = blob + offset;
+	for( i = 0; i < header->mode_count; i++, mode_p++ ) {
+		if( mode_p->mode_id != i + 1 || mode_p->parent_mode_id > i ) {
+			JSMAPPER_LOG_ERROR( "invalid mode record #%u (ID=%u, parent ID=%u)!", 
+								i, (uint) mode_p->mode_id, (uint) mode_p->parent_mode_id );
+			return -EINVAL;
+		}
+		
+		if( !( mode_p->condition_type == JSMAPPER_MODE_CONDITION_BUTTON && mode_p->condition.button.id < core->button_count )
+				&& !( mode_p->condition_type == JSMAPPER_MODE_CONDITION_AXIS && mode_p->condition.axis.id < core->axis_count ) ) {
+			JSMAPPER_LOG_ERROR( "invalid condition for mode record #%u!", i );
+			return -EINVAL;
+		}
+	}
+	offset += sizeof( struct t_JSMAPPER_MODE ) * header->mode_count;
+	
+	/* actions: */
+	for( i = 0; i < header->action_count; i++ ) {
+		record = blob + offset;
+		ret = _validate_profile_action( core, header, record, size - offset );
+		if( ret != 0 )
+			return ret;
+		
+		offset += record->size;
+	}
+	
+	if( offset != size ) {
+		JSMAPPER_LOG_ERROR( "unexpected data at the end of profile blob!" );
+		return -EINVAL;
+	}
+	
+	return 0;
 }
 
-
-struct jsmapdev_core_mode * jsmapper_core_init_mode( struct jsmapdev_core * core )
+static int _load_profile_action( struct jsmapdev_core_profile * profile, const struct t_JSMAPPER_PROFILE_ACTION * record, 
+                                 uint version )
 {
-	int i = 0;
+	struct jsmapdev_core_button_action btn_assign;
+	struct jsmapdev_core_axis_action axis_assign;
+	size_t size = record->size - offsetof( struct t_JSMAPPER_PROFILE_ACTION, action );
+	int ret = 0;
 	
-	struct jsmapdev_core_mode * mode = kzalloc(sizeof(struct jsmapdev_core_mode), GFP_KERNEL);
-	if( mode ) {
-        mode->parent = NULL;
-        mode->mode_id = 0;
-        mode->condition_type = JSMAPPER_MODE_CONDITION_NONE;
-        memset( &mode->condition, 0, sizeof( mode->condition ) );
-        INIT_LIST_HEAD( &mode->child_item );
-        INIT_LIST_HEAD( &mode->children_list );
-        
-		// buttons array
-		mode->buttons = kzalloc(sizeof(struct jsmapdev_core_button_action) * core->button_count, GFP_KERNEL);
-		if( mode->buttons ) {
-			for( i = 0; i < core->button_count; i++ ) {
-				mode->buttons[i].filter = false;
-				jsmapper_core_init_action( &mode->buttons[i].action );
-			}
+	if( record->target == JSMAPPER_PROFILE_TARGET_BUTTON ) {
+		jsmapper_core_init_action( &btn_assign.action );
+		btn_assign.filter = record->action.filter;
+		ret = jsmapper_core_decode_action( &record->action, size, version, &btn_assign.action );
+		if( ret == 0 ) {
+			ret = jsmapper_core_set_button_action( profile, record->action.button.id, record->action.mode_id, &btn_assign );
 		}
-		else
-			JSMAPPER_LOG_ERROR( "unable to allocate %u-button array!", core->button_count );
+		jsmapper_core_clear_action( &btn_assign.action );
 		
-		// axes array:
-		mode->axes = kzalloc(sizeof(struct jsmapdev_core_axis_actions) * core->axis_count, GFP_KERNEL);
-		if( mode->axes ) {
-			for( i = 0; i < core->axis_count; i++ ) {
-				jsmapper_core_init_axis_actions( &mode->axes[i] );
-			}
+	} else {
+		jsmapper_core_init_action( &axis_assign.action );
+		axis_assign.band_low = record->action.axis.low;
+		axis_assign.band_high = record->action.axis.high;
+		axis_assign.filter = record->action.filter;
+		ret = jsmapper_core_decode_action( &record->action, size, version, &axis_assign.action );
+		if( ret == 0 ) {
+			ret = jsmapper_core_set_axis_action( profile, record->action.axis.id, record->action.mode_id, &axis_assign );
 		}
-		else
-			JSMAPPER_LOG_ERROR( "unable to allocate %u-axis array!", core->axis_count );
+		jsmapper_core_clear_action( &axis_assign.action );
 	}
-	else
-		JSMAPPER_LOG_ERROR( "unable to allocate a mode structure!" );
 	
-	return mode;
+	return ret;
 }
 
-
-struct jsmapdev_core_mode * jsmapper_core_find_mode( struct jsmapdev_core_mode * root, uint mode_id )
+/**
+ * Deferred work after a profile has been built with 'loading' set: flatten mode tree & compile axis bands
+ */
+static int _finish_profile( struct jsmapdev_core_profile * profile )
 {
-    struct jsmapdev_core_mode * result = NULL;
-    struct jsmapdev_core_mode * child = NULL;
-
-    if( root ) {
-        if( root->mode_id == mode_id ) {
-            result = root;
-        } else {
-            /** start recursive search */
-            list_for_each_entry( child, &root->children_list, child_item ) {
-                result = jsmapper_core_find_mode( child, mode_id );
-                if( result )
-                    break;
-            }
-        }
-    }
-
-    return result;
+	struct jsmapdev_core_mode * mode = NULL;
+	struct jsmapdev_core_axis_actions * axis_actions = NULL;
+	uint i = 0;
+	int a = 0;
+	int ret = 0;
+	
+	ret = jsmapper_core_flatten_modes( profile );
+	for( i = 0; i < profile->mode_count && ret == 0; i++ ) {
+		mode = profile->mode_list[ i ];
+		for( a = 0; a < profile->core->axis_count && ret == 0; a++ ) {
+			axis_actions = jsmapper_core_mode_axis( mode, a );
+			if( axis_actions )
+				ret = jsmapper_core_compile_axis_actions( profile, axis_actions );
+		}
+	}
+	
+	return ret;
 }
 
+/**
+ * Size a block takes inside a profile arena
+ */
+static inline size_t _arena_size( size_t size )
+{
+	return ALIGN( size, JSMAPPER_CORE_ARENA_ALIGN );
+}
 
-int jsmapper_core_mode_is_active( struct jsmapdev_core * core, struct jsmapdev_core_mode * mode )
+/**
+ * Pre-pass over a validated blob, computing the arena size needed by the profile it describes, so it 
+ * can usually be allocated as a single chunk. Mode lists & tables are accounted for twice, as they are 
+ * built once for the empty profile and then grown or rebuilt.
+ */
+static size_t _profile_size( struct jsmapdev_core * core, const void * blob, size_t offset )
 {
-	int result = 0;
+	const struct t_JSMAPPER_PROFILE_HEADER * header = blob;
+	const struct t_JSMAPPER_PROFILE_ACTION * record = NULL;
+	uint	modes = header->mode_count + 1;
+	size_t	size = 0;
+	uint	i = 0;
 	
-	switch( mode->condition_type ) {
-	case JSMAPPER_MODE_CONDITION_BUTTON:
-		if( mode->condition.button.id >= 0 && mode->condition.button.id < core->button_count ) {
-			uint key = core->button_rmap[ mode->condition.button.id ];
-			if( test_bit( key, core->dev->key) ) {
-				result = 1;
-			}
-		}
-		break;
+	size += _arena_size( sizeof(struct jsmapdev_core_button_action *) * core->button_count )
+	      + _arena_size( sizeof(struct list_head) * core->button_count )
+	      + _arena_size( sizeof(struct list_head) * core->axis_count )
+	      + _arena_size( header->name_length + 1 );
 	
-	case JSMAPPER_MODE_CONDITION_AXIS:
-		if( mode->condition.axis.id >= 0 && mode->condition.axis.id < core->axis_count ) {
-			uint axis = core->axis_rmap[ mode->condition.axis.id ];
-			uint value = input_abs_get_val( core->dev, axis );
-			if( value >= mode->condition.axis.low && value <= mode->condition.axis.high ) {
-				result = 1;
-			}
+	/* only root mode gets dense arrays, submodes grow override arrays as actions are set: */
+	size += modes * _arena_size( sizeof(struct jsmapdev_core_mode) )
+	      + _arena_size( sizeof(struct jsmapdev_core_button_action) * core->button_count )
+	      + _arena_size( sizeof(struct jsmapdev_core_axis_actions) * core->axis_count );
+	size += 2 * ( _arena_size( sizeof(struct jsmapdev_core_mode *) * 2 * max_t( uint, modes, 16 ) )
+	              + _arena_size( sizeof(struct jsmapdev_core_mode *) * modes )
+	              + _arena_size( sizeof(unsigned long) * BITS_TO_LONGS( modes ) ) );
+	
+	offset += sizeof( struct t_JSMAPPER_MODE ) * header->mode_count;
+	for( i = 0; i < header->action_count; i++ ) {
+		record = blob + offset;
+		offset += record->size;
+		
+		/* every band adds at most two segments to its axis index: */
+		if( record->target == JSMAPPER_PROFILE_TARGET_AXIS ) {
+			size += _arena_size( sizeof(struct jsmapdev_core_axis_action) ) 
+			      + 2 * sizeof(struct jsmapdev_core_axis_segment) + JSMAPPER_CORE_ARENA_ALIGN;
+		}
+		/* doubling override arrays keep at most twice the entries actually used: */
+		if( record->action.mode_id != 0 ) {
+			if( record->target == JSMAPPER_PROFILE_TARGET_AXIS )
+				size += 2 * ( sizeof(struct jsmapdev_core_axis_override) + _arena_size( sizeof(struct jsmapdev_core_axis_actions) ) );
+			else
+				size += 2 * sizeof(struct jsmapdev_core_button_override);
+		}
+		if( record->action.type == JSMAPPER_ACTION_MACRO ) {
+			size += _arena_size( sizeof(struct jsmapdev_core_key) * record->action.data.macro.count );
 		}
-		break;
 	}
 	
-	return result;
+	return size;
 }
 
-
-void jsmapper_core_clear_mode( struct jsmapdev_core * core, struct jsmapdev_core_mode * mode )
+int jsmapper_core_load_profile( struct jsmapdev_core * core, const void * blob, size_t size, int bank )
 {
-    struct jsmapdev_core_mode * child = NULL;
-    struct jsmapdev_core_mode * tmp = NULL;
-            
-	if( mode ) {
-        JSMAPPER_LOG_INFO( "destroying mode ID=%u", (uint) mode->mode_id );
-        
-        list_for_each_entry_safe( child, tmp, &mode->children_list, child_item ) {
-            list_del( &child->child_item );
-			jsmapper_core_clear_mode( core, child );
-        }
-        
-		if( mode->buttons ) {
-			int i;
-			for( i = 0; i < core->button_count; i++ )
-				jsmapper_core_clear_action( &mode->buttons[i].action );
-			
-			kfree( mode->buttons );
-		}
+	const struct t_JSMAPPER_PROFILE_HEADER * header = blob;
+	const struct t_JSMAPPER_PROFILE_ACTION * record = NULL;
+	struct jsmapdev_core_profile * profile = NULL;
+	struct t_JSMAPPER_MODE mode_p;
+	char * name = NULL;
+	size_t offset = 0;
+	uint i = 0;
+	int ret = 0;
+	
+	if( bank < JSMAPPER_CORE_BANK_ACTIVE || bank >= JSMAPPER_BANK_COUNT ) {
+		JSMAPPER_LOG_ERROR( "invalid bank index (%i)!", bank );
+		return -EINVAL;
+	}
+	
+	ret = _validate_profile( core, blob, size );
+	if( ret != 0 )
+		return ret;
+	
+	/* new profile is built off to the side, current one keeps working meanwhile: */
+	offset = sizeof( struct t_JSMAPPER_PROFILE_HEADER ) + ALIGN( header->name_length, 4 );
+	profile = jsmapper_core_create_profile( core, _profile_size( core, blob, offset ) );
+	if( profile == NULL )
+		return -ENOMEM;
+	
+	name = jsmapper_core_alloc( profile, header->name_length + 1 );
+	if( name == NULL ) {
+		jsmapper_core_destroy_profile( profile );
+		return -ENOMEM;
+	}
+	memcpy( name, blob + sizeof( struct t_JSMAPPER_PROFILE_HEADER ), header->name_length );
+	profile->profile_name = name;
+	profile->loading = 1;
+	
+	/* mode indexes inside the blob match the IDs assigned by add_mode() on an empty profile: */
+	for( i = 0; i < header->mode_count && ret == 0; i++ ) {
+		memcpy( &mode_p, blob + offset, sizeof( struct t_JSMAPPER_MODE ) );
+		offset += sizeof( struct t_JSMAPPER_MODE );
+		ret = jsmapper_core_add_mode( profile, &mode_p );
+	}
+	
+	for( i = 0; i < header->action_count && ret == 0; i++ ) {
+		record = blob + offset;
+		offset += record->size;
+		ret = _load_profile_action( profile, record, header->version );
+	}
+	
+	profile->loading = 0;
+	
+	if( ret == 0 ) {
+		ret = _finish_profile( profile );
+	}
+	
+	if( ret == 0 ) {
+		JSMAPPER_LOG_INFO( "loaded profile '%s' (%u modes, %u actions)", 
+						   name, (uint) header->mode_count + 1, (uint) header->action_count );
 		
-		if( mode->axes ) {
-			int i;
-			for( i = 0; i < core->axis_count; i++ )
-				jsmapper_core_clear_axis_actions( &mode->axes[i] );
-			
-			kfree( mode->axes );
+		/* a whole profile for the active bank supersedes any pending legacy programming: */
+		if( bank == JSMAPPER_CORE_BANK_ACTIVE ) {
+			jsmapper_core_destroy_profile( core->staging );
+			core->staging = NULL;
 		}
-		
-		kfree( mode );
+		jsmapper_core_store( core, bank, profile );
+	} else {
+		JSMAPPER_LOG_ERROR( "failed to load profile (error %i)!", ret );
+		jsmapper_core_destroy_profile( profile );
 	}
+	
+	return ret;
 }
 
 
@@ -364,8 +1811,13 @@ int jsmapper_core_copy_action( const struct jsmapdev_core_action * from,  struct
         to->rel = from->rel;
         break;
         
+    case JSMAPPER_ACTION_MOTION:
+        to->motion = from->motion;
+        break;
+        
 	case JSMAPPER_ACTION_MACRO:
         to->macro.spacing = from->macro.spacing;
+        to->macro.policy = from->macro.policy;
         if( from->macro.count > 0 ) {
             size_t cbKeys = sizeof( from->macro.keys[0] ) * from->macro.count;
             to->macro.keys = (struct jsmapdev_core_key *) kmalloc( cbKeys, GFP_KERNEL );
@@ -386,6 +1838,78 @@ int jsmapper_core_copy_action( const struct jsmapdev_core_action * from,  struct
 	return 0;
 }
 
+int jsmapper_core_decode_action( const struct t_JSMAPPER_ACTION * api_action, size_t size, uint version, 
+                                 struct jsmapdev_core_action * core_action )
+{
+    const struct t_JSMAPPER_MOTION * api_motion = NULL;
+    int ret = 0;
+    int i;
+    
+    ret = _check_api_action( api_action, size, version );
+    if( ret != 0 )
+        return ret;
+    
+    core_action->type = api_action->type;
+    switch( core_action->type ) 
+    {
+    case JSMAPPER_ACTION_KEY:
+        core_action->key.id = api_action->data.key.id;
+        core_action->key.modifiers = api_action->data.key.modifiers;
+        core_action->key.single = api_action->data.key.single;
+        break;
+        
+    case JSMAPPER_ACTION_REL:
+        core_action->rel.id = api_action->data.rel.id;
+        core_action->rel.single = api_action->data.rel.single;
+        core_action->rel.step = api_action->data.rel.step;
+        core_action->rel.spacing = api_action->data.rel.spacing;
+        break;
+        
+    case JSMAPPER_ACTION_MOTION:
+        /* motion parameters follow the action struct: */
+        api_motion = (const struct t_JSMAPPER_MOTION *)( api_action + 1 );
+        core_action->motion.id = api_motion->id;
+        core_action->motion.spacing = api_motion->spacing;
+        core_action->motion.center = api_motion->center;
+        core_action->motion.deadzone = api_motion->deadzone;
+        core_action->motion.range = api_motion->range;
+        core_action->motion.max_step = api_motion->max_step;
+        core_action->motion.curve = min_t( uint, api_motion->curve, 1 << 15 );
+        core_action->motion.dev = NULL;
+        core_action->motion.abs = 0;
+        break;
+            
+    case JSMAPPER_ACTION_MACRO:
+        core_action->macro.spacing = api_action->data.macro.spacing;
+        core_action->macro.policy = version >= 2 ? _api_macro_options( api_action )->policy : JSMAPPER_MACRO_QUEUE;
+        if( api_action->data.macro.count > 0 )  {
+            
+            size_t cb_keys = sizeof( core_action->macro.keys[0] ) * api_action->data.macro.count;
+            core_action->macro.keys = kmalloc( cb_keys, GFP_KERNEL );
+            if( core_action->macro.keys ) {
+                
+                for( i = 0; i < api_action->data.macro.count; i++ ) {
+                    core_action->macro.keys[i].id = api_action->data.macro.keys[i].id;
+                    core_action->macro.keys[i].modifiers = api_action->data.macro.keys[i].modifiers;
+                    core_action->macro.keys[i].single = api_action->data.macro.keys[i].single;
+                }
+                core_action->macro.count = api_action->data.macro.count;
+                
+            } else {
+                JSMAPPER_LOG_ERROR( "failed to allocate buffer for keys!" );
+                ret = -ENOMEM;
+            }
+        }
+        break;
+        
+    default:
+        break;
+    }
+    
+    return ret;
+}
+
+
 void jsmapper_core_clear_action( struct jsmapdev_core_action * action )
 {
     switch( action->type )
@@ -406,6 +1930,45 @@ void jsmapper_core_clear_action( struct jsmapdev_core_action * action )
 	action->type = JSMAPPER_ACTION_DEFAULT;
 }
 
+/**
+ * Copies an action into a profile, taking macro keys memory from profile's arena. Previous data of the 
+ * target action is simply overwritten, as it belongs to the arena too.
+ */
+static int _copy_profile_action( struct jsmapdev_core_profile * profile, const struct jsmapdev_core_action * from, 
+                                 struct jsmapdev_core_action * to )
+{
+	struct jsmapdev_core_key * keys = NULL;
+	size_t cb_keys = 0;
+	
+	*to = *from;
+	if( from->type == JSMAPPER_ACTION_MACRO ) {
+		to->macro.keys = NULL;
+		to->macro.count = 0;
+		if( from->macro.count > 0 ) {
+			cb_keys = sizeof( from->macro.keys[0] ) * from->macro.count;
+			keys = jsmapper_core_alloc( profile, cb_keys );
+			if( keys == NULL ) {
+				JSMAPPER_LOG_ERROR( "failed to allocate memory for %u keys!", from->macro.count );
+				jsmapper_core_init_action( to );
+				return -ENOMEM;
+			}
+			
+			memcpy( keys, from->macro.keys, cb_keys );
+			to->macro.keys = keys;
+			to->macro.count = from->macro.count;
+		}
+		
+		/* preallocate run state, so playing the macro doesn't need any allocation: */
+		to->macro.run = NULL;
+		if( jsmapper_evgen_init_macro( profile, &to->macro ) != 0 ) {
+			jsmapper_core_init_action( to );
+			return -ENOMEM;
+		}
+	}
+	
+	return 0;
+}
+
 
 /********************************************************************************************************
  * 
@@ -413,21 +1976,40 @@ void jsmapper_core_clear_action( struct jsmapdev_core_action * action )
  * 
  ********************************************************************************************************/
 
-int jsmapper_core_set_button_action( struct jsmapdev_core * core, uint button_id, uint mode_id, const struct jsmapdev_core_button_action * assign )
+int jsmapper_core_set_button_action( struct jsmapdev_core_profile * profile, uint button_id, uint mode_id, const struct jsmapdev_core_button_action * assign )
 {
+	struct jsmapdev_core * core = profile->core;
 	int ret = 0;
 	struct jsmapdev_core_mode * mode = NULL;
+	struct jsmapdev_core_button_action * button_assign = NULL;
 	
-	if( core 
-			&& button_id >= 0
+	if( button_id >= 0
 			&& button_id < core->button_count ) {
 		
-        mode = jsmapper_core_find_mode( core->root_mode, mode_id );
-		if( mode && mode->buttons ) {
-			mode->buttons[button_id].filter = assign->filter;
-			ret = jsmapper_core_copy_action( &assign->action, &mode->buttons[button_id].action );
+        mode = jsmapper_core_find_mode( profile, mode_id );
+		if( mode ) {
+			if( assign->action.type == JSMAPPER_ACTION_MOTION ) {
+				JSMAPPER_LOG_ERROR( "motion actions can only be assigned to axes (button ID=%u)!", button_id );
+				return -EINVAL;
+			}
+			
+			/* unassigning a button a submode doesn't override yet is a no-op: */
+			button_assign = jsmapper_core_mode_button( mode, button_id );
+			if( button_assign == NULL && assign->action.type == JSMAPPER_ACTION_DEFAULT && !assign->filter )
+				return 0;
+			
+			button_assign = _mode_button_slot( profile, mode, button_id );
+			if( button_assign ) {
+				button_assign->filter = assign->filter;
+				ret = _copy_profile_action( profile, &assign->action, &button_assign->action );
+			} else
+				ret = -ENOMEM;
+			
             if( ret == 0 )
 				JSMAPPER_LOG_INFO( "assigned action to button ID=%u on mode ID=%u", button_id, mode_id );
+			
+			if( profile->loading == 0 )
+				jsmapper_core_build_button_table( profile );
 
 		} else {
             JSMAPPER_LOG_ERROR( "invalid mode specified ID=%u", mode_id );
@@ -442,19 +2024,26 @@ int jsmapper_core_set_button_action( struct jsmapdev_core * core, uint button_id
 }
 
 
-int jsmapper_core_get_button_action( struct jsmapdev_core * core, uint button_id, uint mode_id, struct jsmapdev_core_button_action * assign )
+int jsmapper_core_get_button_action( struct jsmapdev_core_profile * profile, uint button_id, uint mode_id, struct jsmapdev_core_button_action * assign )
 {
+	struct jsmapdev_core * core = profile->core;
 	int ret = 0;
 	struct jsmapdev_core_mode * mode = NULL;
+	struct jsmapdev_core_button_action * button_assign = NULL;
 	
-	if( core 
-			&& button_id >= 0
+	if( button_id >= 0
 			&& button_id < core->button_count ) {
 		
-        mode = jsmapper_core_find_mode( core->root_mode, mode_id );
-		if( mode && mode->buttons ) {
-			assign->filter = mode->buttons[button_id].filter;
-			ret = jsmapper_core_copy_action( &mode->buttons[button_id].action, &assign->action );
+        mode = jsmapper_core_find_mode( profile, mode_id );
+		if( mode ) {
+			button_assign = jsmapper_core_mode_button( mode, button_id );
+			if( button_assign ) {
+				assign->filter = button_assign->filter;
+				ret = jsmapper_core_copy_action( &button_assign->action, &assign->action );
+			} else {
+				assign->filter = false;
+				jsmapper_core_init_action( &assign->action );
+			}
 		} else {
             JSMAPPER_LOG_ERROR( "invalid mode specified ID=%u", mode_id );
             ret = -EINVAL;
@@ -468,42 +2057,77 @@ int jsmapper_core_get_button_action( struct jsmapdev_core * core, uint button_id
 }
 
 
-struct jsmapdev_core_button_action * jsmapper_core_find_button_action( struct jsmapdev_core * core, 
-                                                                         struct jsmapdev_core_mode * mode, 
-                                                                         int button_id )
+void jsmapper_core_build_button_table( struct jsmapdev_core_profile * profile )
 {
-	struct jsmapdev_core_button_action 	* action = NULL;
-	struct jsmapdev_core_mode			* submode = NULL;
+	struct jsmapdev_core * core = profile->core;
+	struct jsmapdev_core_mode * mode = NULL;
+	struct jsmapdev_core_button_action * assign = NULL;
+	uint i = 0;
+	uint o = 0;
+	int b = 0;
 	
-	if( core 
-			&& button_id >= 0
-			&& button_id < core->button_count) {
+	for( b = 0; b < core->button_count; b++ ) {
+		profile->button_table[ b ] = NULL;
+	}
+	
+	/* walk modes forwards, so more specific ones override their parents & previous siblings: */
+	for( i = 0; i < profile->mode_count; i++ ) {
+		mode = profile->mode_list[ i ];
+		if( !test_bit( i, profile->active_modes ) )
+			continue;
 		
-		/* first, try if mapped by any of the submodes: */
-		list_for_each_entry_reverse( submode, &mode->children_list, child_item ) {
-			if( jsmapper_core_mode_is_active( core, submode )) {
-				action = jsmapper_core_find_button_action( core, submode, button_id );
-				if( action != NULL ) {
-					break;
+		if( mode->buttons ) {
+			for( b = 0; b < core->button_count; b++ ) {
+				if( mode->buttons[ b ].action.type != JSMAPPER_ACTION_DEFAULT ) {
+					profile->button_table[ b ] = &mode->buttons[ b ];
 				}
 			}
-		}
-		
-		/* if not, check if mapped by this mode: */
-		if( action == NULL ) {
-			if( mode->buttons ) {
-				if( mode->buttons[ button_id ].action.type != JSMAPPER_ACTION_DEFAULT ) {
-					// JSMAPPER_LOG_DEBUG( "    Found action in mode ID=%u for button ID=%i", mode->mode_id, button_id );
-					action = &mode->buttons[ button_id ];
+		} else {
+			for( o = 0; o < mode->button_override_count; o++ ) {
+				assign = &mode->button_overrides[ o ].assign;
+				if( assign->action.type != JSMAPPER_ACTION_DEFAULT ) {
+					profile->button_table[ mode->button_overrides[ o ].id ] = assign;
 				}
 			}
 		}
 	}
+}
+
+
+struct jsmapdev_core_button_action * jsmapper_core_find_button_action( struct jsmapdev_core_profile * profile, int button_id )
+{
+	struct jsmapdev_core * core = profile->core;
+	struct jsmapdev_core_button_action * action = NULL;
+	
+	if( button_id >= 0
+			&& button_id < core->button_count) {
+		action = profile->button_table[ button_id ];
+	}
 	
 	return action;
 }
 
 
+void jsmapper_core_button_changed( struct jsmapdev_core_profile * profile, int button_id )
+{
+	struct jsmapdev_core * core = profile->core;
+	if( button_id >= 0 
+			&& button_id < core->button_count
+			&& !list_empty( &profile->button_modes[ button_id ] ) ) {
+		_trigger_changed( profile, &profile->button_modes[ button_id ] );
+	}
+}
+
+
+void jsmapper_core_axis_changed( struct jsmapdev_core_profile * profile, int axis_id )
+{
+	struct jsmapdev_core * core = profile->core;
+	if( axis_id >= 0 
+			&& axis_id < core->axis_count
+			&& !list_empty( &profile->axis_modes[ axis_id ] ) ) {
+		_trigger_changed( profile, &profile->axis_modes[ axis_id ] );
+	}
+}
 
 
 
@@ -516,35 +2140,146 @@ struct jsmapdev_core_button_action * jsmapper_core_find_button_action( struct js
 void jsmapper_core_init_axis_actions( struct jsmapdev_core_axis_actions * actions )
 {
 	INIT_LIST_HEAD( &actions->action_list );
+	actions->segments = NULL;
+	actions->segment_count = 0;
 }
 
-void jsmapper_core_clear_axis_actions( struct jsmapdev_core_axis_actions * actions )
+static int _compare_s64( const void * a, const void * b )
 {
-	struct jsmapdev_core_axis_action * assign = NULL;
-    struct jsmapdev_core_axis_action * tmp = NULL;
+	s64 x = *(const s64 *) a;
+	s64 y = *(const s64 *) b;
 	
-	list_for_each_entry_safe( assign, tmp, &actions->action_list, child_item ) {
-		list_del( &assign->child_item );
-		jsmapper_core_clear_action( &assign->action );
-		kfree( assign );
-    }
+	return ( x < y )? -1 : ( x > y )? 1 : 0;
+}
+
+int jsmapper_core_compile_axis_actions( struct jsmapdev_core_profile * profile, struct jsmapdev_core_axis_actions * actions )
+{
+	struct jsmapdev_core_axis_action	* assign = NULL;
+	struct jsmapdev_core_axis_action	* winner = NULL;
+	struct jsmapdev_core_axis_segment	* segments = NULL;
+	s64		* points = NULL;
+	uint	band_count = 0;
+	uint	point_count = 0;
+	uint	count = 0;
+	uint	i = 0, j = 0;
+	
+	list_for_each_entry( assign, &actions->action_list, child_item ) {
+		if( assign->action.type != JSMAPPER_ACTION_DEFAULT && assign->band_low <= assign->band_high )
+			band_count++;
+	}
+	
+	if( band_count > 0 ) {
+		/* every band may start a segment at its lower bound and end one right after its upper bound: */
+		points = kmalloc( sizeof(s64) * band_count * 2, GFP_KERNEL );
+		segments = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_axis_segment) * ( band_count * 2 - 1 ) );
+		if( points == NULL || segments == NULL ) {
+			JSMAPPER_LOG_ERROR( "failed to allocate %u-band axis index!", band_count );
+			kfree( points );
+			return -ENOMEM;
+		}
+		
+		list_for_each_entry( assign, &actions->action_list, child_item ) {
+			if( assign->action.type != JSMAPPER_ACTION_DEFAULT && assign->band_low <= assign->band_high ) {
+				points[ point_count++ ] = assign->band_low;
+				points[ point_count++ ] = (s64) assign->band_high + 1;
+			}
+		}
+		sort( points, point_count, sizeof(s64), _compare_s64, NULL );
+		
+		/* resolve every elementary interval between consecutive points, merging adjacent ones: */
+		for( i = 0; i + 1 < point_count; i++ ) {
+			if( points[ i ] == points[ i + 1 ] )
+				continue;
+			
+			/* same precedence as the list scan: first band found walking backwards wins */
+			winner = NULL;
+			list_for_each_entry_reverse( assign, &actions->action_list, child_item ) {
+				if( assign->action.type != JSMAPPER_ACTION_DEFAULT
+						&& points[ i ] >= assign->band_low
+						&& points[ i ] <= assign->band_high ) {
+					winner = assign;
+					break;
+				}
+			}
+			
+			if( winner == NULL )
+				continue;
+			
+			if( count > 0 
+					&& segments[ count - 1 ].action == winner
+					&& (s64) segments[ count - 1 ].high + 1 == points[ i ] ) {
+				segments[ count - 1 ].high = (int) ( points[ i + 1 ] - 1 );
+			} else {
+				j = count++;
+				segments[ j ].low = (int) points[ i ];
+				segments[ j ].high = (int) ( points[ i + 1 ] - 1 );
+				segments[ j ].action = winner;
+			}
+		}
+		
+		kfree( points );
+	}
+	
+	/* previous segments belong to the arena, so they just get abandoned until the profile goes away */
+	actions->segments = segments;
+	actions->segment_count = count;
+	
+	return 0;
+}
+
+
+struct jsmapdev_core_axis_action * jsmapper_core_find_axis_band( struct jsmapdev_core_axis_actions * actions, int value,
+                                                                 int * low_p, int * high_p )
+{
+	struct jsmapdev_core_axis_segment * segment = NULL;
+	uint low = 0;
+	uint high = actions->segment_count;
+	uint mid = 0;
+	
+	while( low < high ) {
+		mid = low + ( high - low ) / 2;
+		segment = &actions->segments[ mid ];
+		if( value < segment->low ) {
+			high = mid;
+		} else if( value > segment->high ) {
+			low = mid + 1;
+		} else {
+			if( low_p && *low_p < segment->low )
+				*low_p = segment->low;
+			if( high_p && *high_p > segment->high )
+				*high_p = segment->high;
+			
+			return segment->action;
+		}
+	}
+	
+	/* value lies in the gap between segments low - 1 and low: */
+	if( low_p && low > 0 && *low_p <= actions->segments[ low - 1 ].high )
+		*low_p = actions->segments[ low - 1 ].high + 1;
+	if( high_p && low < actions->segment_count && *high_p >= actions->segments[ low ].low )
+		*high_p = actions->segments[ low ].low - 1;
+	
+	return NULL;
 }
 
 
-int jsmapper_core_set_axis_action( struct jsmapdev_core * core, uint axis_id, uint mode_id, const struct jsmapdev_core_axis_action * assign )
+int jsmapper_core_set_axis_action( struct jsmapdev_core_profile * profile, uint axis_id, uint mode_id, const struct jsmapdev_core_axis_action * assign )
 {
+	struct jsmapdev_core * core = profile->core;
 	int ret = 0;
 	struct jsmapdev_core_mode * mode = NULL;
+	struct jsmapdev_core_axis_actions * axis_actions = NULL;
+	struct jsmapdev_core_axis_action * axis_assign = NULL;
 
-	if( core
-			&& axis_id >= 0
+	if( axis_id >= 0
 			&& axis_id < core->axis_count ) {
 
 		/* find mode */
-		mode = jsmapper_core_find_mode( core->root_mode, mode_id );
-		if( mode && mode->axes ) {
-			struct jsmapdev_core_axis_action * axis_assign		= NULL;
-			struct jsmapdev_core_axis_actions * axis_actions	= &mode->axes[ axis_id ];
+		mode = jsmapper_core_find_mode( profile, mode_id );
+		if( mode ) {
+			axis_actions = _mode_axis_slot( profile, mode, axis_id );
+			if( axis_actions == NULL )
+				return -ENOMEM;
 
 			/* check if an action featuring the same band is yet defined */
 			list_for_each_entry( axis_assign, &axis_actions->action_list, child_item ) {
@@ -553,7 +2288,7 @@ int jsmapper_core_set_axis_action( struct jsmapdev_core * core, uint axis_id, ui
 					axis_assign->band_high = assign->band_high;
 					axis_assign->band_low = assign->band_low;
 					axis_assign->filter = assign->filter;
-					jsmapper_core_copy_action( &assign->action, &axis_assign->action );
+					ret = _copy_profile_action( profile, &assign->action, &axis_assign->action );
 
 					JSMAPPER_LOG_INFO( "modified action on axis ID=%u, band=(%i,%i) on mode ID=%u",
 									   axis_id, assign->band_low, assign->band_high, mode_id );
@@ -565,13 +2300,12 @@ int jsmapper_core_set_axis_action( struct jsmapdev_core * core, uint axis_id, ui
 
 			/* if not done yet, then add it to the list */
 			if( assign ) {
-				axis_assign = kzalloc( sizeof(struct jsmapdev_core_axis_action), GFP_KERNEL);
+				axis_assign = jsmapper_core_alloc( profile, sizeof(struct jsmapdev_core_axis_action) );
 				if( axis_assign ) {
 					axis_assign->band_high = assign->band_high;
 					axis_assign->band_low = assign->band_low;
 					axis_assign->filter = assign->filter;
-					jsmapper_core_init_action( &axis_assign->action );
-					jsmapper_core_copy_action( &assign->action, &axis_assign->action );
+					ret = _copy_profile_action( profile, &assign->action, &axis_assign->action );
 
 					INIT_LIST_HEAD( &axis_assign->child_item );
 					list_add( &axis_assign->child_item, &axis_actions->action_list );
@@ -583,6 +2317,17 @@ int jsmapper_core_set_axis_action( struct jsmapdev_core * core, uint axis_id, ui
 					ret = -ENOMEM;
 				}
 			}
+			
+			/* motion actions read the value of the axis they're assigned to on every step: */
+			if( ret == 0 && axis_assign->action.type == JSMAPPER_ACTION_MOTION ) {
+				axis_assign->action.motion.dev = core->dev;
+				axis_assign->action.motion.abs = core->axis_rmap[ axis_id ];
+			}
+			
+			if( ret == 0 && profile->loading == 0 ) {
+				ret = jsmapper_core_compile_axis_actions( profile, axis_actions );
+				profile->generation++;
+			}
 
 		} else {
 			JSMAPPER_LOG_ERROR( "invalid mode ID=%u", mode_id );
@@ -598,51 +2343,71 @@ int jsmapper_core_set_axis_action( struct jsmapdev_core * core, uint axis_id, ui
 }
 
 
-struct jsmapdev_core_axis_action * jsmapper_core_find_axis_action( struct jsmapdev_core * core, 
-                                                                   struct jsmapdev_core_mode * mode, 
-                                                                   int axis_id, int value )
+/**
+ * Searches the action for an axis value, storing into low & high the range of values around it for which the 
+ * result holds
+ */
+static struct jsmapdev_core_axis_action * _resolve_axis_action( struct jsmapdev_core_profile * profile, int axis_id, 
+                                                                int value, int * low, int * high )
 {
-	struct jsmapdev_core_mode			* submode = NULL;
+	struct jsmapdev_core_mode			* mode = NULL;
 	struct jsmapdev_core_axis_actions	* axis_actions = NULL;
 	struct jsmapdev_core_axis_action 	* axis_action = NULL;
-	struct jsmapdev_core_axis_action 	* action = NULL;
+	int i = 0;
 	
-	if( core 
-			&& axis_id >= 0
-			&& axis_id < core->axis_count) {
-		
-		/* first, try if mapped by any of the submodes: */
-		list_for_each_entry_reverse( submode, &mode->children_list, child_item ) {
-			if( jsmapper_core_mode_is_active( core, submode )) {
-				action = jsmapper_core_find_axis_action( core, submode, axis_id, value );
-				if( action != NULL )
-					break;
-			}
-		}
-		
-		/* if not, check if mapped by this mode: */
-		if( action == NULL ) {
+	/* the range narrows with every mode checked, as a higher-priority mode could map values around this one: */
+	*low = INT_MIN;
+	*high = INT_MAX;
+	
+	/* walk modes backwards, so most specific active modes are checked first: */
+	for( i = profile->mode_count - 1; i >= 0; i-- ) {
+		mode = profile->mode_list[ i ];
+		if( !test_bit( i, profile->active_modes ) )
+			continue;
 		
-			if( mode->axes ) {
-				// JSMAPPER_LOG_DEBUG( "Checking mode ID=%u for action on axis ID=%u, value=%i", mode->mode_id, button_id, value );
-				axis_actions = &mode->axes[ axis_id ];
+		axis_actions = jsmapper_core_mode_axis( mode, axis_id );
+		if( axis_actions == NULL )
+			continue;
+
+		axis_action = jsmapper_core_find_axis_band( axis_actions, value, low, high );
+		if( axis_action )
+			return axis_action;
+	}
 	
-				/* check if an action featuring the same band is yet defined */
-				list_for_each_entry_reverse( axis_action, &axis_actions->action_list, child_item ) {
-					if( value >= axis_action->band_low 
-							&& value <= axis_action->band_high 
-					        && axis_action->action.type != JSMAPPER_ACTION_DEFAULT ) {
-						
-						// JSMAPPER_LOG_DEBUG( "Found action in mode ID=%u for axis ID=%i, value=%i", mode->mode_id, axis_id, value );
-						action = axis_action;
-						break;
-					}
-				}
-			}
-		}
+	return NULL;
+}
+
+
+struct jsmapdev_core_axis_action * jsmapper_core_find_axis_action( struct jsmapdev_core_profile * profile, int axis_id, int value )
+{
+	struct jsmapdev_core * core = profile->core;
+	struct jsmapdev_core_axis_cache		* cache = NULL;
+	
+	if( axis_id >= 0
+			&& axis_id < core->axis_count) {
+		cache = &profile->axis_cache[ axis_id ];
+		cache->generation = profile->generation;
+		return _resolve_axis_action( profile, axis_id, value, &cache->low, &cache->high );
 	}
 	
-	return action;
+	return NULL;
+}
+
+
+int jsmapper_core_axis_cache_hit( struct jsmapdev_core_profile * profile, int axis_id, int value )
+{
+	struct jsmapdev_core * core = profile->core;
+	struct jsmapdev_core_axis_cache * cache = &profile->axis_cache[ axis_id ];
+	
+	if( cache->generation == profile->generation
+			&& value >= cache->low
+			&& value <= cache->high ) {
+		_core_count( core, axis_cache_hits );
+		return 1;
+	}
+	
+	_core_count( core, axis_cache_misses );
+	return 0;
 }
 
 
@@ -24,13 +24,19 @@
 #define __JSMAPPER_CORE_H_
 
 #include <linux/input.h>
+#include <linux/kref.h>
 #include <linux/list.h>
+#include <linux/percpu.h>
+#include <linux/rcupdate.h>
 
 #include "jsmapper_api.h"
 
+struct jsmapdev_core;
+struct jsmapper_evgen;
 struct jsmapdev_core_key;
 struct jsmapdev_core_button_action;
 struct jsmapdev_core_mode;
+struct jsmapdev_core_axis_segment;
 
 /********************************************************************************************************
  * 
@@ -38,12 +44,181 @@ struct jsmapdev_core_mode;
  * 
  ******************************************************************************************************/
 
+/**
+ * \brief Internal struct caching the last resolution of an axis
+ * 
+ * As long as the axis value stays inside [low, high] and profile's generation hasn't changed, the action 
+ * resolved for the axis is guaranteed to be the same, so there's no need to search for it again.
+ */
+
+struct jsmapdev_core_axis_cache {
+	/** Lower value of the range the resolution holds for */
+	int low;
+	/** Upper value of the range the resolution holds for */
+	int high;
+	/** Profile generation the resolution was made on (0 means never resolved) */
+	uint generation;
+};
+
+
+/**
+ * \brief Internal struct defining a block of profile memory
+ */
+
+struct jsmapdev_core_arena_chunk {
+	/** Next (older) chunk in the arena, if any */
+	struct jsmapdev_core_arena_chunk * next;
+	/** Usable size of data, in bytes */
+	size_t size;
+	/** Number of bytes of data already handed out */
+	size_t used;
+	/** Chunk memory */
+	char data[];
+};
+
+
+/**
+ * \brief Internal struct defining a profile memory arena
+ *
+ * All the memory owned by a profile (the profile structure itself, modes & their action arrays, axis band nodes, 
+ * macro keys, compiled segments and lookup tables) is carved sequentially out of a few big chunks, so related data 
+ * ends up contiguous in memory. Nothing is freed individually: destroying the profile releases all chunks at once.
+ *
+ * Profiles are reference counted, so data still in use by the event generator after a profile gets replaced 
+ * (macros being played) outlives it: chunks are released along with the last reference.
+ */
+
+struct jsmapdev_core_arena {
+	/** Chunk list, most recent first */
+	struct jsmapdev_core_arena_chunk * chunks;
+};
+
+
+/**
+ * \brief Device programming: a full profile, plus the runtime state derived from it
+ *
+ * Profiles are built off to the side (either from a profile blob, or by accumulating legacy programming ioctls 
+ * on core's staging profile) and then stored into one of the core's banks as a whole by jsmapper_core_publish() 
+ * or jsmapper_core_store(). Once stored, the programming part (modes, actions & name) is never modified again: 
+ * the event filter reads the one in the active bank under RCU, and a profile gets destroyed only after a grace 
+ * period, when a newer one replaces it in its bank.
+ *
+ * The runtime part (active modes, effective button table, current axis actions & axis caches) is only updated 
+ * by the event filter, which input core serializes with the device's event_lock.
+ */
+
+struct jsmapdev_core_profile {
+	/** Pointer to the core this profile was built for, used for device info */
+	struct jsmapdev_core * core;
+	/** Memory arena holding the profile and all its data */
+	struct jsmapdev_core_arena arena;
+	/** References: the one of its owner (core or loader), plus one for every macro being played from it */
+	struct kref ref;
+	/** Profile name, if any */
+	char * profile_name;
+	/** Pointers to currently active action, for every axis */
+	struct jsmapdev_core_axis_action * current_axis_action[ABS_CNT];
+	/** Value range & generation for which the resolution of current_axis_action holds, for every axis */
+	struct jsmapdev_core_axis_cache axis_cache[ABS_CNT];
+	/** Incremented every time active modes or axis programming change, invalidating axis caches */
+	uint generation;
+	/** Pointer to root mode */
+	struct jsmapdev_core_mode * root_mode;
+    /** Last mode ID value assigned when creating a new mode */
+    uint last_mode_id;
+	/** Non-zero while the profile is being built: mode flattening & band compilation are deferred */
+	int loading;
+	/** Mode lookup table, indexed by mode ID */
+	struct jsmapdev_core_mode ** mode_table;
+	/** Number of entries allocated in mode_table */
+	uint mode_table_size;
+	/** Flattened mode tree, in pre-order (root first). Later entries take precedence over earlier ones */
+	struct jsmapdev_core_mode ** mode_list;
+	/** Number of entries in mode_list */
+	uint mode_count;
+	/** Effective button action table for currently active modes, indexed by button ID */
+	struct jsmapdev_core_button_action ** button_table;
+	/** Active mode bitmap, indexed by mode position in mode_list */
+	unsigned long * active_modes;
+	/** Reverse trigger index: list of modes triggered by every button, indexed by button ID */
+	struct list_head * button_modes;
+	/** Reverse trigger index: list of modes triggered by every axis, indexed by axis ID */
+	struct list_head * axis_modes;
+};
+
+
+/** Bank index standing for the active bank, whichever it is */
+#define JSMAPPER_CORE_BANK_ACTIVE		-1
+
+
+/** Maximum number of button changes buffered in an input frame: fuller frames get resolved early */
+#define JSMAPPER_CORE_FRAME_BUTTONS		32
+
+/**
+ * \brief Button change buffered in an input frame
+ */
+
+struct jsmapdev_core_frame_button {
+	/** Button identifier, in the range 0..numButtons - 1 */
+	uint id;
+	/** New button value */
+	int value;
+};
+
+
+/**
+ * \brief Input frame being received
+ *
+ * Events received between two SYN_REPORTs are buffered here, and resolved together once the frame is complete. 
+ * Button changes are kept in order, as a button may be pressed & released inside a single frame. For axes only 
+ * the last value matters.
+ */
+
+struct jsmapdev_core_frame {
+	/** Button changes, in arrival order */
+	struct jsmapdev_core_frame_button buttons[ JSMAPPER_CORE_FRAME_BUTTONS ];
+	/** Number of button changes buffered */
+	uint button_count;
+	/** Bitmap of axes changed in this frame, indexed by axis ID */
+	unsigned long axes[ BITS_TO_LONGS( ABS_CNT ) ];
+	/** Last value received for every axis changed, indexed by axis ID */
+	int axis_values[ ABS_CNT ];
+};
+
+
+/**
+ * \brief Core counters
+ *
+ * Updated from the event filter & from profile allocations, so they're kept per CPU by the device owning the core, 
+ * along with its own counters.
+ */
+
+struct jsmapdev_core_stats {
+	/** Number of axis events resolved through the axis cache */
+	unsigned long axis_cache_hits;
+	/** Number of axis events that needed a full action resolution */
+	unsigned long axis_cache_misses;
+	/** Number of profile memory allocations failed */
+	unsigned long alloc_failures;
+};
+
+
+/**
+ * \brief Receives the mode transitions & actions fired by the core (see jsmapper_core_set_listener())
+ *
+ * Called from the event filter, with the source device's event lock held, so calls are never concurrent. The 
+ * record timestamp is left for the listener to fill.
+ */
+
+typedef void (* jsmapdev_core_listener)( void * data, struct t_JSMAPPER_EVENT * event );
+
+
 /**
  * \brief Core info associated with a jsmapper device
  * 
  * This structure contains all data members related to core device functionality. This involves both 
- * some info gathered from the device itself (number of buttons, etc...), plus all the associated
- * data involving device programming, mapping modes, etc...
+ * some info gathered from the device itself (number of buttons, etc...), plus the published profile and 
+ * the one being programmed through the legacy ioctls, if any.
  * 
  * A pointer to a jsmapdev_core structure is obtained through a call to jsmapdev_core_init() function, which will 
  * allocate the structure and fill it withe initial data. This is usually performed when connect() function is called
@@ -52,14 +227,14 @@ struct jsmapdev_core_mode;
  * The pointer must be freed when destroying the device by calling jsmapdev_core_done(), which will free up any associated
  * data members.
  *
- * \todo Add mutex to protect from concurrent access!
+ * Functions changing the programming (publishing profiles, handling staging) must be serialized by the caller.
  */
 
 struct jsmapdev_core {
 	/** Pointer to actual input device, for convenience */
 	struct input_dev * dev;
-	/** Current profile name, if any */
-	char * profile_name;
+	/** Event generator the actions are sent to */
+	struct jsmapper_evgen * evgen;
 	/** Number of buttons actually found in device */
 	int button_count;
 	/** Maps from input key ID to a button index */
@@ -72,12 +247,30 @@ struct jsmapdev_core {
 	uint axis_map[ABS_CNT];
 	/** Maps from axis index to input axis ID */
 	uint axis_rmap[ABS_CNT];
-	/** Pointers to currently active action, for every axis */
-	struct jsmapdev_core_axis_action * current_axis_action[ABS_CNT];
-	/** Pointer to root mode */
-	struct jsmapdev_core_mode * root_mode;
-    /** Last mode ID value assigned when creating a new mode */
-    uint last_mode_id;
+	/** Profile currently in use by the event filter: the one in the active bank (never NULL while the device exists) */
+	struct jsmapdev_core_profile __rcu * profile;
+	/** Fully built profiles, ready to be switched to (NULL for empty banks) */
+	struct jsmapdev_core_profile * banks[JSMAPPER_BANK_COUNT];
+	/** Index of the active bank (changed under the device's event lock) */
+	uint bank;
+	/** ID of the button cycling through the loaded banks, -1 if none (changed under the device's event lock) */
+	int bank_button;
+	/** Non-zero if the bank button got pressed in the input frame being received, only touched by the event filter */
+	int bank_cycle;
+	/** Profile being modified by legacy programming ioctls, not published yet (NULL if none) */
+	struct jsmapdev_core_profile * staging;
+	/** Input frame being received, only touched by the event filter */
+	struct jsmapdev_core_frame frame;
+	/** Per-CPU counters, owned by the device (NULL if not counted, see jsmapper_core_set_stats()) */
+	struct jsmapdev_core_stats __percpu * stats;
+	/** State sequence number, incremented on every input frame & profile published (under the device's event lock) */
+	uint sequence;
+	/** Profile generation, incremented on every profile published (under the device's event lock) */
+	uint profile_generation;
+	/** Listener of mode transitions & actions fired, if any */
+	jsmapdev_core_listener listener;
+	/** Data passed to the listener */
+	void * listener_data;
 };
 
 
@@ -115,6 +308,37 @@ struct jsmapdev_core_rel {
 };
 
 
+/**
+ * \brief Internal struct representing a relative axis movement proportional to an absolute axis
+ * 
+ * This structure mimics the API-related JSMAPPER_MOTION type, plus the source axis, which is set when the 
+ * action gets assigned to an axis band.
+ */
+
+struct jsmapdev_core_motion {
+	/** A relative axis ID */
+	uint id;
+    /** Time spacing between steps, in ms */
+    uint spacing;
+	/** Source axis value at rest */
+	int center;
+	/** Deflection from center producing no movement */
+	int deadzone;
+	/** Deflection from center producing full speed */
+	int range;
+	/** Number of axis units to move per step at full deflection */
+	int max_step;
+	/** Response curve, Q15 */
+	uint curve;
+	/** Source device, whose cached axis value is read on every step */
+	struct input_dev * dev;
+	/** Source axis code (ABS_xxx) */
+	uint abs;
+};
+
+
+struct jsmapper_evgen_macro_run;
+
 /**
  * \brief Internal struct representing a macro
  */
@@ -124,8 +348,12 @@ struct jsmapdev_core_macro {
     uint spacing;
     /** number of keys contained in array */
     uint count;
+    /** re-trigger policy - see JSMAPPER_MACRO_xxx constants in API header */
+    uint policy;
     /** Pointer to array containing the key sequence (macro) to issue */
     struct jsmapdev_core_key * keys;
+    /** Run state used by the event generator, allocated along with the action in profile's arena (NULL otherwise) */
+    struct jsmapper_evgen_macro_run * run;
 };
 
 
@@ -152,6 +380,8 @@ struct jsmapdev_core_action {
 		struct jsmapdev_core_rel rel;
         /** action struct used for 'macro' */
         struct jsmapdev_core_macro macro;
+        /** action struct used for 'motion' action type */
+        struct jsmapdev_core_motion motion;
 	};
 };
 
@@ -187,6 +417,28 @@ struct jsmapdev_core_button_action {
 struct jsmapdev_core_axis_actions {
 	/** Axis bands list */
     struct list_head action_list;
+	/** Compiled band index: non-overlapping segments, sorted by value (built from action_list) */
+	struct jsmapdev_core_axis_segment * segments;
+	/** Number of entries in segments array */
+	uint segment_count;
+};
+
+
+/**
+  * \brief Internal struct defining a compiled axis band segment
+  *
+  * Axis bands defined by the user might overlap. In order to avoid scanning the whole band list on every axis 
+  * event, the list is compiled into an array of non-overlapping segments sorted by value, each one pointing 
+  * to the band action that wins for that range of values. This allows a binary search to find the action.
+  */
+
+struct jsmapdev_core_axis_segment {
+	/** Lower segment value */
+	int low;
+	/** Upper segment value */
+	int high;
+	/** Band action applying to this segment */
+	struct jsmapdev_core_axis_action * action;
 };
 
 
@@ -212,6 +464,30 @@ struct jsmapdev_core_axis_action {
 };
 
 
+/**
+  * \brief Internal struct defining a button overridden by a submode
+  */
+
+struct jsmapdev_core_button_override {
+	/** Button ID */
+	uint id;
+	/** Button action defined by the submode */
+	struct jsmapdev_core_button_action assign;
+};
+
+
+/**
+  * \brief Internal struct defining an axis overridden by a submode
+  */
+
+struct jsmapdev_core_axis_override {
+	/** Axis ID */
+	uint id;
+	/** Axis bands defined by the submode */
+	struct jsmapdev_core_axis_actions * actions;
+};
+
+
 /**
  * \brief Internal struct defining a mode
  * 
@@ -221,6 +497,9 @@ struct jsmapdev_core_axis_action {
  * @li Parent mode ID: a numeric value identifying parent mode, if any (will be set to 0 for root mode)
  * @li Trigger condition: the condition ( button pressed, etc...) which triggers the mode.
  * @li Button actions: the size of the array will be the number of buttons detected in the device.
+ * 
+ * Root mode defines every button & axis, so it keeps them in arrays indexed by ID. Submodes usually override just 
+ * a few of them, so they only store those, in arrays sorted by ID.
  */
 
 struct jsmapdev_core_mode {
@@ -230,6 +509,14 @@ struct jsmapdev_core_mode {
     struct list_head child_item;
     /** Mode ID */
     uint mode_id;
+    /** Position in profile's flattened mode list, also used as bit index in profile's active_modes bitmap */
+    uint index;
+    /** Position in profile's flattened mode list right past this mode's last descendant */
+    uint subtree_end;
+    /** Non-zero if this mode's own trigger condition is currently met */
+    int triggered;
+    /** List item for this mode, used for insertion in profile's reverse trigger index */
+    struct list_head condition_item;
     /** Trigger type */
     uint condition_type;
     /** Union containing trigger condition data, to be interpreted according to conditionType field */
@@ -249,11 +536,25 @@ struct jsmapdev_core_mode {
         } axis;
     } condition;
     
-	/** Button action array */
+	/** Button action array, indexed by button ID (root mode only) */
 	struct jsmapdev_core_button_action * buttons;
 	
-	/** Axes bands array */
+	/** Axes bands array, indexed by axis ID (root mode only) */
 	struct jsmapdev_core_axis_actions * axes;
+	
+	/** Overridden buttons, sorted by ID (submodes only) */
+	struct jsmapdev_core_button_override * button_overrides;
+	/** Number of entries in button_overrides array */
+	uint button_override_count;
+	/** Number of entries allocated for button_overrides array */
+	uint button_override_size;
+	
+	/** Overridden axes, sorted by ID (submodes only) */
+	struct jsmapdev_core_axis_override * axis_overrides;
+	/** Number of entries in axis_overrides array */
+	uint axis_override_count;
+	/** Number of entries allocated for axis_overrides array */
+	uint axis_override_size;
     
     /** Children modes list */
     struct list_head children_list;
@@ -274,21 +575,49 @@ struct jsmapdev_core_mode {
  * gathering from the device the number of buttons & axes if offers, build up the button keymap, etc...
  * 
  * @param dev Pointer to the input device just connected
+ * @param evgen Event generator the actions will be sent to, which must outlive the core
  * @return A pointer to a core structure if succesful, NULL otherwise
  */
 
-struct jsmapdev_core * jsmapper_core_init( struct input_dev * dev );
+struct jsmapdev_core * jsmapper_core_init( struct input_dev * dev, struct jsmapper_evgen * evgen );
+
+
+/**
+ * \brief Sets the listener of the mode transitions & actions fired
+ * 
+ * Only the published profile reports mode transitions, as they happen. A JSMAPPER_EVENT_PROFILE record is sent 
+ * whenever a new profile gets published instead of the transitions it causes.
+ * 
+ * Must be called before the device gets opened, as the event filter reads it without locking.
+ * 
+ * @param core Pointer to core structure
+ * @param listener Listener function, NULL for none
+ * @param data Data passed to the listener
+ */
+void jsmapper_core_set_listener( struct jsmapdev_core * core, jsmapdev_core_listener listener, void * data );
+
+
+/**
+ * \brief Sets the per-CPU counters updated by the core
+ * 
+ * Must be called before the device gets opened, as the event filter reads it without locking.
+ * 
+ * @param core Pointer to core structure
+ * @param stats Per-CPU counters, owned by the caller and living as long as the core; NULL for none
+ */
+void jsmapper_core_set_stats( struct jsmapdev_core * core, struct jsmapdev_core_stats __percpu * stats );
 
 
 /**
  * \brief Clears all current actions, modes, etc...
  * 
- * This function will reset the core to its default state, so no actions are made to any button nor axe
+ * This function replaces core's staging profile with an empty one, so no actions are made to any button nor axe 
+ * once it gets published by jsmapper_core_commit(). Current programming keeps working until then.
  * 
  * @param core Pointer to core structure to reset
- * @param reset If 1, a new, empty root mode will be allocated. If 0, it won't.
+ * @return 0 if succesful, a negative number indicating an error code otherwise
  */
-void jsmapper_core_clear( struct jsmapdev_core * core, int reset );
+int jsmapper_core_clear( struct jsmapdev_core * core );
 
 
 /**
@@ -304,20 +633,183 @@ void jsmapper_core_clear( struct jsmapdev_core * core, int reset );
 
 void jsmapper_core_done( struct jsmapdev_core * core );
 
+
+/**
+ * \brief Processes an event coming from the device
+ * 
+ * This is the body of the input handler's filter. It runs in interrupt context, with device's event lock held, 
+ * so it never sleeps.
+ * 
+ * Events are handled a frame at a time: button & axis changes update the active modes of the published profile 
+ * as they arrive, but are only buffered. Once the SYN_REPORT closing the frame is received, the actions triggered 
+ * by the whole frame are resolved against the final mode state and sent to the event generator together, in 
+ * arrival order (axes last, with their latest value).
+ * 
+ * Whether an event is filtered out must be decided as soon as it arrives, before the rest of the frame is seen, 
+ * so the filter flag is per event, not per frame: it's based on the mode state at that point, with the changes 
+ * of the events received before it in the frame, but not of the ones after it. If a mode switch comes later in 
+ * the same frame, the event gets filtered by the action of the previous mode while the action sent is the one 
+ * of the new mode.
+ * 
+ * @param core Pointer to the core structure
+ * @param type Event type
+ * @param code Event code
+ * @param value Event value
+ * @return true if the event must be filtered out, false if it should make its way to the joystick driver
+ */
+
+bool jsmapper_core_filter( struct jsmapdev_core * core, unsigned int type, unsigned int code, int value );
+
 /**
- * @brief Sets profile name into core
+ * @brief Sets profile name into a profile
  * @param profile_name Pointer to new profile name (might be NULL)
+ * @return 0 if succesful, a negative number indicating an error code otherwise
  *
- * The pointer passed is owned by the core after calling this function, so it
- * will get freed automatically.
+ * The name is copied into profile's memory, so the caller keeps owning the pointer passed.
  */
-void jsmapper_core_set_profile_name( struct jsmapdev_core * core, char * profile_name );
+int jsmapper_core_set_profile_name( struct jsmapdev_core_profile * profile, const char * profile_name );
 
 /**
- * @brief Returns current profile name
+ * @brief Returns profile name
  * @return Pointer to profile name (might be NULL)
  */
-char * jsmapper_core_get_profile_name( struct jsmapdev_core * core );
+char * jsmapper_core_get_profile_name( struct jsmapdev_core_profile * profile );
+
+
+/********************************************************************************************************
+ * 
+ * Profile functions
+ * 
+ ********************************************************************************************************/
+
+/**
+ * \brief Allocates an empty profile for the given core
+ * 
+ * The new profile only contains the root mode, with no actions.
+ * 
+ * @param core Pointer to core structure
+ * @param size Expected size of the whole profile, in bytes, used to size its memory arena (0 if unknown)
+ * @return A pointer to the new profile if succesful, NULL otherwise
+ */
+struct jsmapdev_core_profile * jsmapper_core_create_profile( struct jsmapdev_core * core, size_t size );
+
+/**
+ * \brief Destroys a profile, including all its modes & actions
+ * 
+ * Drops the reference of profile's owner. All profile data lives in its arena, so once the last reference is gone 
+ * (macros being played hold one) this only releases arena chunks. Can be called from any context.
+ * 
+ * \warning The profile must not be published, nor be referenced by any event being processed.
+ */
+void jsmapper_core_destroy_profile( struct jsmapdev_core_profile * profile );
+
+/**
+ * \brief Takes an extra reference on a profile, keeping its data alive until released by jsmapper_core_put_profile()
+ */
+void jsmapper_core_hold_profile( struct jsmapdev_core_profile * profile );
+
+/**
+ * \brief Releases a reference taken by jsmapper_core_hold_profile(), freeing the profile if it was the last one
+ */
+void jsmapper_core_put_profile( struct jsmapdev_core_profile * profile );
+
+/**
+ * \brief Allocates zeroed memory from a profile's arena
+ * 
+ * The memory is owned by the profile, and released only when the profile is destroyed.
+ * 
+ * @return A pointer to the memory block, or NULL if it couldn't be allocated
+ */
+void * jsmapper_core_alloc( struct jsmapdev_core_profile * profile, size_t size );
+
+/**
+ * \brief Creates an unpublished copy of a profile, including its modes, actions & name
+ * 
+ * Mode IDs are kept, so ids known by userspace still refer to the same modes in the copy. The copy is 
+ * returned in loading state: mode list & band indexes will get built when it's committed.
+ * 
+ * @return A pointer to the new profile if succesful, NULL otherwise
+ */
+struct jsmapdev_core_profile * jsmapper_core_clone_profile( struct jsmapdev_core_profile * profile );
+
+/**
+ * \brief Returns the published profile, from the update side
+ * 
+ * Event handling code must use rcu_dereference() on core's profile pointer instead.
+ */
+struct jsmapdev_core_profile * jsmapper_core_get_profile( struct jsmapdev_core * core );
+
+/**
+ * \brief Returns core's staging profile, creating it from the published one if needed
+ * 
+ * Legacy programming ioctls (adding modes, setting actions, ...) modify the staging profile, which is 
+ * published as a whole by jsmapper_core_commit().
+ * 
+ * @return A pointer to the staging profile, or NULL if it couldn't be allocated
+ */
+struct jsmapdev_core_profile * jsmapper_core_get_staging( struct jsmapdev_core * core );
+
+/**
+ * \brief Makes a profile the one used by the event filter, replacing the one in the active bank
+ * 
+ * Same as jsmapper_core_store() on the active bank.
+ */
+void jsmapper_core_publish( struct jsmapdev_core * core, struct jsmapdev_core_profile * profile );
+
+/**
+ * \brief Stores a profile into a bank
+ * 
+ * If the bank is the active one, the actions the old profile still keeps active are released, mode triggers of 
+ * the new profile are evaluated against current device state and the profile pointer is swapped atomically, so 
+ * every event gets handled either completely with old programming or completely with the new one. The profile 
+ * previously in the bank, if any, is destroyed once all events using it are done.
+ * 
+ * The core takes ownership of the profile. Must be called from process context.
+ * 
+ * @param core Pointer to core structure
+ * @param bank Bank index, in the range 0..JSMAPPER_BANK_COUNT-1, or JSMAPPER_CORE_BANK_ACTIVE
+ * @param profile Fully built profile
+ */
+void jsmapper_core_store( struct jsmapdev_core * core, int bank, struct jsmapdev_core_profile * profile );
+
+/**
+ * \brief Makes the profile stored in a bank the one used by the event filter
+ * 
+ * Profiles in banks are fully built already, so switching to one of them just takes releasing the actions kept 
+ * active by current one, evaluating mode triggers of the new one and swapping the profile pointer, all under the 
+ * device's event lock. Nothing gets destroyed, so there's no need to wait for a grace period.
+ * 
+ * @param core Pointer to core structure
+ * @param bank Bank index, in the range 0..JSMAPPER_BANK_COUNT-1
+ * @return 0 if succesful, -ENOENT if the bank is empty, -EINVAL if out of range
+ */
+int jsmapper_core_select_bank( struct jsmapdev_core * core, uint bank );
+
+/**
+ * \brief Returns the state of the banks: active one (numbered from 1), the ones holding a profile & bank button
+ */
+void jsmapper_core_get_banks( struct jsmapdev_core * core, struct t_JSMAPPER_BANKS * banks );
+
+/**
+ * \brief Sets the button cycling through the loaded banks
+ * 
+ * Every press of the button switches to the next non-empty bank, from the event filter itself. The button is 
+ * filtered out, and it's never seen by profile programming (neither its actions nor mode triggers).
+ * 
+ * @param core Pointer to core structure
+ * @param button_id Button ID, in the range 0..numButtons-1, or -1 to disable bank cycling
+ * @return 0 if succesful, -EINVAL if the button ID is out of range
+ */
+int jsmapper_core_set_bank_button( struct jsmapdev_core * core, int button_id );
+
+/**
+ * \brief Publishes core's staging profile, if any
+ * 
+ * Staging profiles are kept in loading state, so the mode list & band indexes are built only once, here.
+ * 
+ * @return 0 if succesful, a negative number indicating an error code otherwise
+ */
+int jsmapper_core_commit( struct jsmapdev_core * core );
 
 
 /********************************************************************************************************
@@ -327,7 +819,7 @@ char * jsmapper_core_get_profile_name( struct jsmapdev_core * core );
  ********************************************************************************************************/
 
 /**
-  \brief Adds a new mode to core 
+  \brief Adds a new mode to a profile
   
   This function gets called from the main IOCTL implementation. It takes care of internally creating the new mode, 
   based on the parameters passed. The 'mode' structure passed should specify a valid parentmode_id field (0 for root), 
@@ -336,23 +828,43 @@ char * jsmapper_core_get_profile_name( struct jsmapdev_core * core );
   On exit, and if succesful, the mode_id member of the 'mode' structure will contain the ID for the newly created
   mode.
   
-  \param core Pointer to driver core structure
+  \param profile Pointer to profile structure
   \param mode_p Pointer to new mode parameters (IMPORTANT: must converted from user to kernel space )
   \return 0 if succesful, an error code if not
   */
-int jsmapper_core_add_mode( struct jsmapdev_core * core, struct t_JSMAPPER_MODE  * mode_p );
+int jsmapper_core_add_mode( struct jsmapdev_core_profile * profile, struct t_JSMAPPER_MODE  * mode_p );
+
+
+/**
+  \brief Initializes a core mode structure, allocated from profile's arena
+  
+  \param profile Profile the mode belongs to
+  \param dense If non-zero, button & axis arrays covering the whole device are allocated (root mode). Otherwise 
+  the mode will only store the elements it overrides.
+  */
+struct jsmapdev_core_mode * jsmapper_core_init_mode( struct jsmapdev_core_profile * profile, int dense );
 
 
 /**
-  \brief Initializes a core mode structure
+  \brief Returns the button action defined by a mode, or NULL if the mode doesn't override the button
   */
-struct jsmapdev_core_mode * jsmapper_core_init_mode( struct jsmapdev_core * core );
+struct jsmapdev_core_button_action * jsmapper_core_mode_button( struct jsmapdev_core_mode * mode, uint button_id );
 
 
 /**
-  \brief Finds a mode given its ID, starting search at given root mode
+  \brief Returns the axis bands defined by a mode, or NULL if the mode doesn't override the axis
+  */
+struct jsmapdev_core_axis_actions * jsmapper_core_mode_axis( struct jsmapdev_core_mode * mode, uint axis_id );
+
+
+/**
+  \brief Finds a mode given its ID
+  
+  This is a direct access to profile's ID-indexed mode table, which is maintained by jsmapper_core_add_mode().
+  
+  \return The mode with the given ID, or NULL if no such mode exists
   */
-struct jsmapdev_core_mode * jsmapper_core_find_mode( struct jsmapdev_core_mode * root, uint mode_id );
+struct jsmapdev_core_mode * jsmapper_core_find_mode( struct jsmapdev_core_profile * profile, uint mode_id );
 
 
 /**
@@ -360,13 +872,93 @@ struct jsmapdev_core_mode * jsmapper_core_find_mode( struct jsmapdev_core_mode *
   
   This function will check if device state matches mode trigger, and will return != 0 if so.
   */
-int jsmapper_core_mode_is_active( struct jsmapdev_core * core, struct jsmapdev_core_mode * mode );
+int jsmapper_core_mode_is_active( struct jsmapdev_core_profile * profile, struct jsmapdev_core_mode * mode );
+
+
+/**
+  \brief Rebuilds the flattened mode list
+  
+  This function walks the mode tree and stores every mode in profile's mode_list array, in pre-order (root first, 
+  then every child subtree in insertion order). When iterating that list forwards, modes found later always 
+  take precedence over the ones found before them, which matches the lookup order used by the recursive search.
+  
+  It also rebuilds the reverse trigger index (the modes depending on every button & axis), and re-evaluates 
+  the active modes.
+  
+  \param profile Pointer to profile structure
+  \return 0 if succesful, an error code if not
+  */
+int jsmapper_core_flatten_modes( struct jsmapdev_core_profile * profile );
 
 
 /**
-  \brief Destroys a core mode structure, including all its submodes
+  \brief Re-evaluates all mode triggers against current device state
+  
+  This function rebuilds profile's active mode bitmap from scratch. A mode is active only if its own trigger 
+  condition is met and its parent mode is active too. If the set of active modes changes, the effective 
+  button action table gets rebuilt.
+  
+  During event processing only the modes depending on the changed input are re-evaluated, through 
+  jsmapper_core_button_changed() and jsmapper_core_axis_changed().
+  
+  \param profile Pointer to profile structure
+  \return Non-zero if the set of active modes changed
+  */
+int jsmapper_core_update_modes( struct jsmapdev_core_profile * profile );
+
+
+/**
+  \brief Checks whether a mode is currently active
+  
+  \param profile Pointer to profile structure
+  \param mode Mode to check, which must be part of profile's flattened mode list
+  \return Non-zero if the mode, and all its parents, are active
   */
-void jsmapper_core_clear_mode( struct jsmapdev_core * core, struct jsmapdev_core_mode * mode );
+int jsmapper_core_is_mode_active( struct jsmapdev_core_profile * profile, struct jsmapdev_core_mode * mode );
+
+
+/**
+  \brief Fills a device state structure
+  
+  Unlike jsmapper_core_get_state(), the caller must hold the device's event lock: meant to be called from the 
+  event filter.
+  
+  \param core Pointer to core structure
+  \param state Pointer to state structure to fill
+  \return ID of the active mode taking precedence (the last active one in the flattened mode list)
+  */
+uint jsmapper_core_fill_state( struct jsmapdev_core * core, struct t_JSMAPPER_STATE * state );
+
+
+/**
+  \brief Takes a snapshot of device state
+  
+  Button & axis values, active modes of the published profile and sequence number are all read under the 
+  device's event lock, so they match each other. May be called from process context only.
+  
+  \param core Pointer to core structure
+  \param state Pointer to state structure to fill
+  */
+void jsmapper_core_get_state( struct jsmapdev_core * core, struct t_JSMAPPER_STATE * state );
+
+
+/**
+ * \brief Loads a whole profile from a serialized blob
+ *
+ * The blob (see t_JSMAPPER_PROFILE_HEADER) is fully validated before touching current programming, so an 
+ * invalid blob leaves the device as it was. Then a new profile is built off to the side with all modes, actions & 
+ * the profile name (mode flattening and axis band compilation are performed only once, at the end), and stored 
+ * into a bank (see jsmapper_core_store()). If it's the active one, any pending staging programming is 
+ * discarded.
+ *
+ * @param core Pointer to driver core structure
+ * @param blob Profile blob, already copied to kernel space
+ * @param size Blob size, in bytes
+ * @param bank Bank index, in the range 0..JSMAPPER_BANK_COUNT-1, or JSMAPPER_CORE_BANK_ACTIVE
+ * @return 0 if succesful, a negative number indicating an error code otherwise
+ */
+
+int jsmapper_core_load_profile( struct jsmapdev_core * core, const void * blob, size_t size, int bank );
 
 
 /********************************************************************************************************
@@ -410,6 +1002,22 @@ int jsmapper_core_copy_action( const struct jsmapdev_core_action * from,  struct
 
 void jsmapper_core_clear_action( struct jsmapdev_core_action * action );
 
+/**
+ *  \brief Decodes an API action struct into a core action
+ *
+ * This function converts the action data received from userspace (either through the single action ioctls 
+ * or inside a profile blob) into a core action, checking that the macro key array fits in the given size.
+ *
+ * @param api_action API action structure, already copied to kernel space
+ * @param size Size of the buffer containing api_action, in bytes
+ * @param version Format version of the profile blob containing the action, 1 for single action ioctls
+ * @param core_action Target action structure, which should had been initialized using jsmapper_core_init_action()
+ * @return 0 if succesful, a negative number indicating an error code otherwise
+ */
+
+int jsmapper_core_decode_action( const struct t_JSMAPPER_ACTION * api_action, size_t size, uint version, 
+                                 struct jsmapdev_core_action * core_action );
+
 
 /********************************************************************************************************
  * 
@@ -423,14 +1031,14 @@ void jsmapper_core_clear_action( struct jsmapdev_core_action * action );
  * This function changes the action for a given button and mode. The action data is properly copied into the target mode, 
  * so it's safe to destroy the argument variable using jsmapper_core_clear_button_action() after calling this function.
  * 
- * @param core Pointer to the device's core structure
+ * @param profile Pointer to the profile to modify
  * @param button_id ID of the button to assign, in the range 0..numButtons - 1
  * @param mode_id ID of the mode to change. Not used right now, shoud be zero.
  * @param assign Pointer to the action to set.
  * @param 0 if succesful, a negative number indicating an error code otherwise
  */
 
-int jsmapper_core_set_button_action( struct jsmapdev_core * core, uint button_id, uint mode_id, const struct jsmapdev_core_button_action * assign );
+int jsmapper_core_set_button_action( struct jsmapdev_core_profile * profile, uint button_id, uint mode_id, const struct jsmapdev_core_button_action * assign );
 
 
 /**
@@ -440,38 +1048,71 @@ int jsmapper_core_set_button_action( struct jsmapdev_core * core, uint button_id
  * the internal structures to the provided assign struct, so jsmapper_core_clear_button_action()() should be called over it
  * after calling this function and using the returned data.
  * 
- * @param core Pointer to the device's core structure
+ * @param profile Pointer to the profile to modify
  * @param button_id ID of the button to check, in the range 0..numButtons - 1
  * @param mode_id ID of the mode to check. Not used right now, shoud be zero.
  * @param assign Pointer to the action variable that will receive the data.
  * @param 0 if succesful, a negative number indicating an error code otherwise
  */
 
-int jsmapper_core_get_button_action( struct jsmapdev_core * core, uint button_id, 
+int jsmapper_core_get_button_action( struct jsmapdev_core_profile * profile, uint button_id, 
 										uint mode_id, struct jsmapdev_core_button_action * assign );
 
 
+/**
+ * \brief Rebuilds the effective button action table
+ * 
+ * This function fills profile's button_table with the action that applies to every button given the currently 
+ * active modes. The flattened mode list is walked forwards, so the action defined by the most specific active 
+ * mode is the one kept.
+ * 
+ * @param profile Pointer to the profile containing programming schema
+ */
+
+void jsmapper_core_build_button_table( struct jsmapdev_core_profile * profile );
+
+
 /**
  * \brief Searches for the action to apply to a given button
  * 
- * This function will use current core programming and device state to determine which action should be 
- * applied to the goven button. If the button is currently unassigned, it will return NULL.
+ * This function will use profile programming and current device state to determine which action should be 
+ * applied to the given button. If the button is currently unassigned, it will return NULL.
  *
- * The function will start by recursively looking into child modes of the mode provided (if they are active): 
- * if any of them maps the button, then that action is returned. It not, then mode's own mapping is checked. 
- * The function is called initially from main module on root mode, which is always considered active.
- *
- * The submodes list is iterated backwards, so modes added later can override mappings defined by previous child modes.
+ * The lookup is a single access to the effective button table, which is kept up to date whenever the set 
+ * of active modes changes.
  * 
- * @param core Pointer to the core structure containing programming schema
- * @param mode Mode to start search from
- * @param button_id Key identifier received from input core
+ * @param profile Pointer to the profile containing programming schema
+ * @param button_id Button identifier, in the range 0..numButtons - 1
  * @return A pointer to the action to use, or NULL if button is currently unassigned
  */
 
-struct jsmapdev_core_button_action * jsmapper_core_find_button_action( struct jsmapdev_core * core, 
-                                                                        struct jsmapdev_core_mode * mode, 
-																		int button_id );
+struct jsmapdev_core_button_action * jsmapper_core_find_button_action( struct jsmapdev_core_profile * profile, int button_id );
+
+
+/**
+ * \brief Notifies the core about a button state change
+ * 
+ * If the button is used as a mode trigger, the modes depending on it (and their submodes) are re-evaluated, 
+ * and the active mode bitmap updated.
+ * 
+ * @param profile Pointer to the published profile
+ * @param button_id Button identifier, in the range 0..numButtons - 1
+ */
+
+void jsmapper_core_button_changed( struct jsmapdev_core_profile * profile, int button_id );
+
+
+/**
+ * \brief Notifies the core about an axis value change
+ * 
+ * If the axis is used as a mode trigger, the modes depending on it (and their submodes) are re-evaluated, 
+ * and the active mode bitmap updated.
+ * 
+ * @param profile Pointer to the published profile
+ * @param axis_id Axis identifier, in the range 0..numAxes - 1
+ */
+
+void jsmapper_core_axis_changed( struct jsmapdev_core_profile * profile, int axis_id );
 
 
 /********************************************************************************************************
@@ -492,17 +1133,37 @@ struct jsmapdev_core_button_action * jsmapper_core_find_button_action( struct js
 void jsmapper_core_init_axis_actions( struct jsmapdev_core_axis_actions * actions );
 
 /**
- *  \brief Clears an axis actions struct
+ *  \brief Compiles the band list of an axis actions struct into its segment index
  * 
- * This function is called everytime an axis actions structure must be cleared, in order to properly free the external data
- * in case is needed, so no memory leaks are left.
+ * This function rebuilds the sorted, non-overlapping segment array used for lookups from the current band list. 
+ * Where bands overlap, the segment gets the band that would have been found first when walking action_list 
+ * backwards (this is, the one defined first), so results are the same as scanning the list.
  * 
- * It destroys all the actions in list by calling jsmapper_core_clear_axis_action(), then clears the list.
+ * It must be called after every change to the band list. The segment array is allocated from profile's arena.
  * 
- * @param actions Assignment structure to clear
+ * @param profile Profile owning the axis actions structure
+ * @param actions Axis actions structure to compile
+ * @return 0 if succesful, a negative number indicating an error code otherwise
  */
 
-void jsmapper_core_clear_axis_actions( struct jsmapdev_core_axis_actions * actions );
+int jsmapper_core_compile_axis_actions( struct jsmapdev_core_profile * profile, struct jsmapdev_core_axis_actions * actions );
+
+
+/**
+ *  \brief Finds the band action for a given value in an axis actions struct
+ * 
+ * If given, the low & high values are narrowed to the range around the value for which the result is the 
+ * same: the matching segment bounds, or else the gap between segments the value falls in.
+ * 
+ * @param actions Compiled axis actions structure to search
+ * @param value Axis value
+ * @param low Pointer to the lower bound to narrow, or NULL
+ * @param high Pointer to the upper bound to narrow, or NULL
+ * @return A pointer to the band action covering the value, or NULL if none
+ */
+
+struct jsmapdev_core_axis_action * jsmapper_core_find_axis_band( struct jsmapdev_core_axis_actions * actions, int value,
+                                                                 int * low, int * high );
 
 
 /**
@@ -512,45 +1173,58 @@ void jsmapper_core_clear_axis_actions( struct jsmapdev_core_axis_actions * actio
  * the axis value enter the band defined in it.
  *
  * If an action matching the same band definition for this axis is found, it will be overwritten.
- * Else, a new one will be added. Also, if new action's band overlaps another, then behaviour
- * is undefined.
+ * Else, a new one will be added. If new action's band overlaps another, the band defined first
+ * keeps precedence over the shared values.
  *
  * The action data is properly copied into the target mode, so it's safe to destroy
  * the argument variable using jsmapper_core_clear_axis_action() after calling this function.
  *
- * @param core Pointer to the device's core structure
+ * @param profile Pointer to the profile to modify
  * @param axis_id ID of the axis to assign, in the range 0..numAxes - 1
  * @param mode_id ID of the mode to change. Not used right now, shoud be zero.
  * @param assign Pointer to the action to set.
  * @param 0 if succesful, a negative number indicating an error code otherwise
  */
 
-int jsmapper_core_set_axis_action( struct jsmapdev_core * core, uint axis_id, uint mode_id, const struct jsmapdev_core_axis_action * assign );
+int jsmapper_core_set_axis_action( struct jsmapdev_core_profile * profile, uint axis_id, uint mode_id, const struct jsmapdev_core_axis_action * assign );
 
 
 /**
  * \brief Searches for the action to apply to a given axis value change
  * 
- * This function will use current core programming and device state to determine which action should be 
+ * This function will use profile programming and current device state to determine which action should be 
  * applied for a given axis operation, by searching over the bands defined for it, if any. If no matching 
  * band is found for current axis value, it will return NULL.
  * 
- * The function will start by recursively looking into child modes of the mode provided (if they are active): 
- * if any of them maps the axis value, then that action is returned. It not, then mode's own mapping is checked. 
- * The function is called initially from main module on root mode, which is always considered active.
- * 
- * The submodes list is iterated backwards, so modes added later can override mappings defined by previous child modes.
+ * The flattened mode list is walked backwards, skipping inactive modes, so the most specific active mode mapping 
+ * the axis value wins. Sibling modes added later can thus override mappings defined by previous ones.
  *
- * @param core Pointer to the core structure containing programming schema
- * @param mode Mode to start search from
- * @param axisId Key identifier received from input core
+ * The range of values around the given one for which the result holds is stored into the axis cache, so 
+ * following calls to jsmapper_core_axis_cache_hit() can skip the search.
+ *
+ * @param profile Pointer to the profile containing programming schema
+ * @param axis_id Axis identifier, in the range 0..numAxes - 1
  * @param value Current axis value received from input core
  * @return A pointer to the action to use, or NULL if no action is mapped for this axis / value
  */
 
-struct jsmapdev_core_axis_action * jsmapper_core_find_axis_action(struct jsmapdev_core * core, 
-                                                                  struct jsmapdev_core_mode *mode, 
-                                                                  int axis_id, int value );
+struct jsmapdev_core_axis_action * jsmapper_core_find_axis_action( struct jsmapdev_core_profile * profile, int axis_id, int value );
+
+
+/**
+ * \brief Checks whether the last resolution made for an axis still applies
+ * 
+ * This is the fast path for axis events: if the value didn't leave the range cached by the last call to 
+ * jsmapper_core_find_axis_action() and neither active modes nor programming changed since then, the 
+ * current axis action is still the right one. Hits & misses are accounted in core's counters.
+ *
+ * @param profile Pointer to the published profile
+ * @param axis_id Axis identifier, in the range 0..numAxes - 1
+ * @param value Current axis value received from input core
+ * @return Non-zero if current_axis_action is still valid for this value
+ */
+
+int jsmapper_core_axis_cache_hit( struct jsmapdev_core_profile * profile, int axis_id, int value );
 
 
 
@@ -23,13 +23,18 @@
 #include "jsmapper_evgen.h"
 #include "jsmapper_api.h"
 #include "jsmapper_log.h"
+#include "jsmapper_trace.h"
 
 #include <linux/input.h>
+#include <linux/list.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
-#include <linux/delay.h>
-#include <linux/kthread.h> 
-#include <linux/sched.h>    
+#include <linux/percpu.h>
+#include <linux/string.h>
 
 /*************************************************************************************************************
 
@@ -37,61 +42,158 @@
 
 **************************************************************************************************************/
 
-/** The event generator virtual device */
-static struct input_dev * g_evgen_dev = NULL;
+/** Prefix of the physical path of every event generator device, used to tell them apart from real ones */
+#define JSMAPPER_EVGEN_PHYS_PREFIX			"jsmapper/"
+
+/** Modifier key codes, in JSMAPPER_MODIFIER_* bit order */
+static const uint g_evgen_modifier_keys[] = {
+	KEY_LEFTCTRL, KEY_RIGHTCTRL, KEY_LEFTSHIFT, KEY_RIGHTSHIFT, KEY_LEFTALT, KEY_RIGHTALT, KEY_LEFTMETA, KEY_RIGHTMETA
+};
+
+/**
+  * \brief Output batch
+  *
+  * Collects the events generated while an input frame is being resolved, so they're sent with a single sync.
+  */
+
+struct jsmapper_evgen_batch {
+	/** Non-zero while an input frame is being resolved */
+	int active;
+	/** Non-zero if some event is waiting for the sync */
+	int pending;
+	/** Keys changed since last sync: changing any of them again needs a sync in between */
+	unsigned long keys[ BITS_TO_LONGS( KEY_CNT ) ];
+	/** Output counters (see struct jsmapper_evgen_stats) */
+	struct jsmapper_evgen_stats stats;
+};
+
+/** Minimum time spacing between relative axis steps, in ns (used when the action specifies none) */
+#define JSMAPPER_EVGEN_REL_MIN_SPACING		( 1 * NSEC_PER_MSEC )
+/** Steps due within this time of the one being sent are sent in the same frame, in ns */
+#define JSMAPPER_EVGEN_REL_SLACK			( 250 * NSEC_PER_USEC )
 
 /**
-  * \brief Parameter struct for _send_rel() call
+  * \brief Relative axis emitter
   *
-  * Contains the parameters used to ctrl the background thread used to generate relative axis movement events.
+  * Contains the status of a non-single relative axis or motion action being held. All of them are driven by a 
+  * single high resolution timer per event generator.
   */
 
-struct send_rel_thread_params {
-    /** axis ID (REL_xxx) */
-    uint id;
-	/** Number of steps to perform per movement*/
+struct jsmapper_evgen_rel_emitter {
+	/** Number of axis units to move per step */
 	int step;
-    /** Time spacing between steps, in ms */
-    uint  spacing;
-    /** Cancellation flag */
-    int cancel;
+	/** Time spacing between steps */
+	ktime_t spacing;
+	/** Time when next step is due */
+	ktime_t next;
+	/** Motion parameters, if step is computed from an absolute axis (motion.dev is NULL otherwise) */
+	struct jsmapdev_core_motion motion;
+	/** Fraction of axis unit carried to next step, in Q15 */
+	int remainder;
 };
 
-/** array containing parameters struct for all relative axis actions currently being executed */
-struct send_rel_thread_params * g_evgen_rel[REL_CNT];
 
-/** protects certain parts of event generator */
-spinlock_t g_evgen_lock; 
+/** Maximum number of runs queued behind a running macro (JSMAPPER_MACRO_QUEUE policy) */
+#define JSMAPPER_EVGEN_MACRO_MAX_QUEUED		16
+
+/**
+  * \brief Macro run
+  *
+  * Contains the status of a macro action. It's allocated along with the action when installed in a profile, so 
+  * playing the macro needs no allocation at all. While being played, the run holds a reference on the profile, 
+  * which keeps its (immutable) key sequence alive even if the profile gets replaced meanwhile.
+  *
+  * Every run is driven by its own high resolution timer, which sends a key on every expiration, so any number of 
+  * macros can be played at once without blocking anything.
+  */
+
+struct jsmapper_evgen_macro_run {
+	/** Timer sending the keys */
+	struct hrtimer timer;
+	/** Link into the macro list of the event generator playing it */
+	struct list_head list;
+	/** Event generator playing the macro, while active */
+	struct jsmapper_evgen * evgen;
+	/** Profile the macro belongs to */
+	struct jsmapdev_core_profile * profile;
+	/** Re-trigger policy */
+	uint policy;
+	/** Key sequence, in profile's arena */
+	const struct jsmapdev_core_key * keys;
+	/** Number of keys in sequence */
+	uint count;
+	/** Time spacing between keys */
+	ktime_t spacing;
+	/** Index of next key to send */
+	uint pos;
+	/** Number of runs queued behind the current one */
+	uint queued;
+	/** Non-zero while the macro is being played */
+	int active;
+	/** Set when the run gets cancelled, so the timer drops the remaining keys */
+	int cancelled;
+};
 
 
 /**
- * @brief Wrapper for the send_rel_params work item
- *This structure hols a workqueue control item plus the params for the axis action thread. 
- */
-struct send_rel_work_params {
-	/** Workqueue control item - required */
-    struct work_struct work;
-	/** Non-zero if button was being pressed, 0 if released */
-	int press;
-	/** Thread params */
-	struct send_rel_thread_params rel;
+  * \brief Event generator counters, updated from every context actions are sent from (see struct jsmapper_evgen_stats)
+  */
+
+struct jsmapper_evgen_counters {
+	unsigned long actions[ JSMAPPER_EVGEN_ACTION_TYPES ];
+	unsigned long timer_events;
+	unsigned long work_items;
 };
 
 
 /**
-  * \brief Parameter struct for send_macro() call
+  * \brief Virtual event generator
   *
-  * Contains a 'work_struct' item on top, in order to be inserted into a workqueue.
+  * Every jsmapper device gets its own event generator, with its own output device, relative axis emitters, macro 
+  * runs and lock, so devices never contend with each other, nor cancel each other's emitters.
+  *
+  * The output device can't be registered (nor unregistered) from the input handler callbacks, as they're called 
+  * with the input core lock held, so that's deferred to g_evgen_wq. Until registered, events are dropped.
   */
-struct send_macro_work {
-    /** Workqueue control item - required */
-    struct work_struct work;
-    /** Macro definition */
-    struct jsmapdev_core_macro macro;
+
+struct jsmapper_evgen {
+	/** Output device */
+	struct input_dev * dev;
+	/** Non-zero once the output device is registered */
+	int registered;
+	/** Device name */
+	char name[ 64 ];
+	/** Device physical path */
+	char phys[ 32 ];
+	/** Registers (or unregisters & frees, once destroyed) the output device */
+	struct work_struct work;
+	/** Per-CPU action & deferred event counters, so devices firing actions from several CPUs don't share them */
+	struct jsmapper_evgen_counters __percpu * counters;
+	
+	/** Protects everything below */
+	spinlock_t lock;
+	
+	/** Output batch */
+	struct jsmapper_evgen_batch batch;
+	
+	/** Emitters for every relative axis, only those flagged in rel_active are running */
+	struct jsmapper_evgen_rel_emitter rel[ REL_CNT ];
+	/** Bitmap of relative axes being currently emitted */
+	unsigned long rel_active[ BITS_TO_LONGS( REL_CNT ) ];
+	/** Timer driving relative axis emitters, only armed while some of them is running */
+	struct hrtimer rel_timer;
+	
+	/** Macro runs being played */
+	struct list_head macros;
+	/** Set while the event generator is being destroyed: macro timers stop sending, runs being played belong to jsmapper_evgen_destroy() */
+	int shutdown;
 };
 
-/** The work queue used for macros */
-static struct workqueue_struct  * g_evgen_wq = NULL;
+/** Workqueue (un)registering output devices: ordered, so a device is never unregistered before being registered */
+static struct workqueue_struct * g_evgen_wq = NULL;
+
+static enum hrtimer_restart _send_rel_frame( struct hrtimer * timer );
+static enum hrtimer_restart _send_macro_key( struct hrtimer * timer );
 
 
 /*************************************************************************************************************
@@ -102,113 +204,172 @@ static struct workqueue_struct  * g_evgen_wq = NULL;
 
 int jsmapper_evgen_init()
 {
+	g_evgen_wq = alloc_ordered_workqueue( "jsmapper_evgen", 0 );
+	if( g_evgen_wq == NULL ) {
+		JSMAPPER_LOG_ERROR( "failed to allocate workqueue!" );
+		return -ENOMEM;
+	}
+	
+	return 0;
+}
+
+
+void jsmapper_evgen_done( )
+{
+	/* waits for the output devices still being unregistered: */
+	if( g_evgen_wq ) {
+		destroy_workqueue( g_evgen_wq );
+		g_evgen_wq = NULL;
+	}
+}
+
+
+/**
+  * \brief Output device work
+  *
+  * Registers the output device of a new event generator, or unregisters & frees a destroyed one.
+  */
+
+static void _device_work( struct work_struct * work )
+{
+	struct jsmapper_evgen * evgen = container_of( work, struct jsmapper_evgen, work );
+	unsigned long flags = 0;
 	int result = 0;
+	
+	if( !evgen->shutdown ) {
+		result = input_register_device( evgen->dev );
+		if( result ) {
+			JSMAPPER_LOG_ERROR( "failed to register device '%s' (error %i)!", evgen->name, result );
+			return;
+		}
+		
+		spin_lock_irqsave( &evgen->lock, flags );
+		evgen->registered = 1;
+		spin_unlock_irqrestore( &evgen->lock, flags );
+		
+	} else {
+		JSMAPPER_LOG_INFO( "destroying virtual event generator '%s': %lu input frames sent with %lu syncs (%lu without batching)", 
+						   evgen->name, evgen->batch.stats.frames, evgen->batch.stats.syncs, evgen->batch.stats.requested_syncs );
+		
+        /*  NOTE no need to call input_free_device() as, according to doc, this is not needed 
+            for registered devices (input_unregister_device() will free it)
+		 */
+		if( evgen->registered )
+			input_unregister_device( evgen->dev );
+		else
+			input_free_device( evgen->dev );
+		
+		free_percpu( evgen->counters );
+		kfree( evgen );
+	}
+}
+
+
+struct jsmapper_evgen * jsmapper_evgen_create( const char * name )
+{
+	struct jsmapper_evgen * evgen = NULL;
+	struct input_dev * dev = NULL;
 	uint id = 0;
-    int i = 0;
 		
-	JSMAPPER_LOG_INFO( "creating virtual event generator..." );
-	if( g_evgen_dev ) {
-		JSMAPPER_LOG_WARNING( "yet created!" );
-		return -EBUSY;
+	JSMAPPER_LOG_INFO( "creating virtual event generator for %s...", name );
+	
+	evgen = kzalloc( sizeof( struct jsmapper_evgen ), GFP_KERNEL );
+	if( evgen == NULL ) {
+		JSMAPPER_LOG_ERROR( "failed to allocate event generator!" );
+		return NULL;
 	}
 	
-	g_evgen_dev = input_allocate_device();
-	if( g_evgen_dev == NULL ) {
+	dev = input_allocate_device();
+	if( dev == NULL ) {
 		JSMAPPER_LOG_ERROR( "failed to allocate device!" );
-		return -ENOMEM;
+		kfree( evgen );
+		return NULL;
 	}
+	evgen->counters = alloc_percpu( struct jsmapper_evgen_counters );
+	if( evgen->counters == NULL ) {
+		JSMAPPER_LOG_ERROR( "failed to allocate counters!" );
+		input_free_device( dev );
+		kfree( evgen );
+		return NULL;
+	}
+	evgen->dev = dev;
+	INIT_WORK( &evgen->work, _device_work );
+	spin_lock_init( &evgen->lock );
 	
-	/* init spinlock */
-	spin_lock_init( &g_evgen_lock );
+	/* init relative axis engine & macros: */
+	hrtimer_init( &evgen->rel_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS );
+	evgen->rel_timer.function = _send_rel_frame;
+	INIT_LIST_HEAD( &evgen->macros );
 	
 	/* set up descriptive labels */
-	g_evgen_dev->name = "JSMapper virtual event generator";
+	snprintf( evgen->name, sizeof( evgen->name ), "JSMapper virtual event generator (%s)", name );
+	dev->name = evgen->name;
 	/* phys is unique on a running system */
-	g_evgen_dev->phys = "jsmapper/evgen/0";
-	g_evgen_dev->id.bustype = BUS_VIRTUAL;
+	snprintf( evgen->phys, sizeof( evgen->phys ), JSMAPPER_EVGEN_PHYS_PREFIX "%s/evgen", name );
+	dev->phys = evgen->phys;
+	dev->id.bustype = BUS_VIRTUAL;
 
 	/* set device bits for keyboard events generation: */
-	set_bit( EV_KEY, g_evgen_dev->evbit );
+	set_bit( EV_KEY, dev->evbit );
 	for( id = 0; id < BTN_MISC; id++ )
-		set_bit( id, g_evgen_dev->keybit );
+		set_bit( id, dev->keybit );
     
     /* set device bits for mouse events generation: */
-    set_bit( BTN_LEFT, g_evgen_dev->keybit );
-    set_bit( BTN_MIDDLE, g_evgen_dev->keybit );
-    set_bit( BTN_RIGHT, g_evgen_dev->keybit );
+    set_bit( BTN_LEFT, dev->keybit );
+    set_bit( BTN_MIDDLE, dev->keybit );
+    set_bit( BTN_RIGHT, dev->keybit );
     
-    set_bit( EV_REL, g_evgen_dev->evbit );
+    set_bit( EV_REL, dev->evbit );
     for( id = 0; id < REL_MAX; id++ )
-		set_bit( id, g_evgen_dev->relbit );
+		set_bit( id, dev->relbit );
     
-	/* and finally register with the input core */
-	result = input_register_device( g_evgen_dev );
-	if( result ) {
-		JSMAPPER_LOG_ERROR( "failed to register device!" );
-		
-		input_free_device( g_evgen_dev );
-		g_evgen_dev = NULL;
-		return result;
-	}
+	/* and finally register with the input core, once out of the caller's input core lock */
+	this_cpu_inc( evgen->counters->work_items );
+	queue_work( g_evgen_wq, &evgen->work );
 
-    /* create workqueue for key sequence generation: */
-    g_evgen_wq = create_workqueue( "jsmapper_evgen_wq" );
-    if( g_evgen_wq == NULL ) {
-        JSMAPPER_LOG_ERROR( "failed to create workqueue !" );
-    }
-        
-    /* initialize relative axes status data: */
-    for( i = 0; i < REL_CNT; i++ ) {
-        g_evgen_rel[i] = NULL;
-    }
-    
-	return 0;
+	return evgen;
 }
 
 
-struct input_dev * jsmapper_evgen_device( void )
+void jsmapper_evgen_destroy( struct jsmapper_evgen * evgen )
 {
-	return g_evgen_dev;
-}
+	struct jsmapper_evgen_macro_run * run = NULL;
+	struct jsmapper_evgen_macro_run * tmp = NULL;
+	struct jsmapdev_core_profile * profile = NULL;
+	unsigned long flags = 0;
+	LIST_HEAD( runs );
+	
+	if( evgen == NULL )
+		return;
+    
+    /* stop macros still running: once flagged, their timers don't touch them anymore, so they can be freed here */
+	spin_lock_irqsave( &evgen->lock, flags );
+	evgen->shutdown = 1;
+	list_splice_init( &evgen->macros, &runs );
+	spin_unlock_irqrestore( &evgen->lock, flags );
+	
+	list_for_each_entry_safe( run, tmp, &runs, list ) {
+		/* every run holds its own profile reference, so the next one is still valid after releasing this: */
+		profile = run->profile;
+		hrtimer_cancel( &run->timer );
+		jsmapper_core_put_profile( profile );
+	}
 
+    /* stop relative axis emitters still running, waiting for the timer if it's sending right now: */
+	spin_lock_irqsave( &evgen->lock, flags );
+	bitmap_zero( evgen->rel_active, REL_CNT );
+	spin_unlock_irqrestore( &evgen->lock, flags );
+	hrtimer_cancel( &evgen->rel_timer );
 
-void jsmapper_evgen_done( )
-{
-    int i = 0;
-    
-    /* destroy workqueue used for macros */
-    if( g_evgen_wq )  {
-        JSMAPPER_LOG_DEBUG( "destroying workqueue" );
-        
-        flush_workqueue( g_evgen_wq );
-        destroy_workqueue( g_evgen_wq );
-        
-        g_evgen_wq = NULL;
-    }
+    /* finally, destroy event generator device: queued behind its registration, if still pending */
+	this_cpu_inc( evgen->counters->work_items );
+	queue_work( g_evgen_wq, &evgen->work );
+}
 
-    /* cancel any relative axis thread that might be still running: */
-	spin_lock( &g_evgen_lock );
-    for( i = 0; i < REL_CNT; i++ ) {
-        if( g_evgen_rel[i] ) {
-            JSMAPPER_LOG_WARNING( "Stopping thread for relative axis ID=%u!", i );
-            g_evgen_rel[i]->cancel = 1;
-            g_evgen_rel[i] = NULL;
-            /* WARNING how to ensure thread stops before device is destroyed? Maybe we should simply kill the thread? */
-        }
-    }
-	spin_unlock( &g_evgen_lock );
 
-    /* finally, destroy event generator device */
-	if( g_evgen_dev ) {
-        JSMAPPER_LOG_INFO( "destroying virtual event generator" );
-		
-        /*  NOTE no need to call input_free_device() as, according to doc, this is not needed 
-            for registered devices (input_unregister_device() will free it)
-		 */
-        input_unregister_device( g_evgen_dev );	
-        
-		g_evgen_dev = NULL;
-	}
+bool jsmapper_evgen_is_device( struct input_dev * dev )
+{
+	return dev->phys && strncmp( dev->phys, JSMAPPER_EVGEN_PHYS_PREFIX, strlen( JSMAPPER_EVGEN_PHYS_PREFIX ) ) == 0;
 }
 
 
@@ -218,22 +379,30 @@ void jsmapper_evgen_done( )
 
 **************************************************************************************************************/
 
-int jsmapper_evgen_send_action( struct jsmapdev_core_action * action, int press )
+int jsmapper_evgen_send_action( struct jsmapper_evgen * evgen, struct jsmapdev_core_action * action, int press )
 {
 	int result = -EINVAL;
 	
-	if( action ) {
+	if( evgen && action ) {
+		trace_jsmapper_send_action( evgen->dev, action->type, press );
+		if( press && action->type >= 0 && action->type < JSMAPPER_EVGEN_ACTION_TYPES )
+			this_cpu_inc( evgen->counters->actions[ action->type ] );
+		
 		switch( action->type ) {
 		case JSMAPPER_ACTION_KEY:
-            result = jsmapper_evgen_send_key( &action->key, press );
+            result = jsmapper_evgen_send_key( evgen, &action->key, press );
 			break;
             
         case JSMAPPER_ACTION_REL:
-            result = jsmapper_evgen_send_rel( &action->rel, press );
+            result = jsmapper_evgen_send_rel( evgen, &action->rel, press );
+            break;
+            
+        case JSMAPPER_ACTION_MOTION:
+            result = jsmapper_evgen_send_motion( evgen, &action->motion, press );
             break;
                 
 		case JSMAPPER_ACTION_MACRO:
-            result = jsmapper_evgen_send_macro( &action->macro, press );
+            result = jsmapper_evgen_send_macro( evgen, &action->macro, press );
             break;
                 
 		default:
@@ -247,75 +416,188 @@ int jsmapper_evgen_send_action( struct jsmapdev_core_action * action, int press
 
 /****************************************************************************************************************
   
-  Key actions
+  Output batching
   
 ****************************************************************************************************************/
 
-static void _send_key_modifiers( uint modifiers, int press )
+/**
+  * Sends the sync closing the events just generated, or leaves it pending if an input frame is being resolved. 
+  * Called with event generator lock held.
+  */
+
+static void _batch_sync( struct jsmapper_evgen * evgen )
+{
+	struct jsmapper_evgen_batch * batch = &evgen->batch;
+	
+	if( batch->active ) {
+		batch->stats.requested_syncs++;
+		batch->pending = 1;
+	} else {
+		input_sync( evgen->dev );
+	}
+}
+
+
+/**
+  * Registers the keys a key action is about to change in the current batch. If any of them (modifiers included) was 
+  * already changed since last sync, the pending events are synced first: otherwise, consumers reading the device 
+  * state on every sync would miss the first change, or see the modifiers of both actions at once. Called with 
+  * event generator lock held.
+  */
+
+static void _batch_add_key( struct jsmapper_evgen * evgen, const struct jsmapdev_core_key * key )
 {
-	if( modifiers & JSMAPPER_MODIFIER_CTRL_L )
-		input_event( g_evgen_dev, EV_KEY, KEY_LEFTCTRL, press );
+	struct jsmapper_evgen_batch * batch = &evgen->batch;
+	uint i = 0;
+	int changed = 0;
+	
+	if( !batch->active )
+		return;
+	
+	changed = test_bit( key->id, batch->keys );
+	for( i = 0; i < ARRAY_SIZE( g_evgen_modifier_keys ) && !changed; i++ ) {
+		if( key->modifiers & ( 1 << i ) )
+			changed = test_bit( g_evgen_modifier_keys[ i ], batch->keys );
+	}
 	
-	if( modifiers & JSMAPPER_MODIFIER_CTRL_R )
-		input_event( g_evgen_dev, EV_KEY, KEY_RIGHTCTRL, press );
+	if( changed && batch->pending ) {
+		input_sync( evgen->dev );
+		batch->stats.syncs++;
+		batch->pending = 0;
+		bitmap_zero( batch->keys, KEY_CNT );
+	}
+	
+	set_bit( key->id, batch->keys );
+	for( i = 0; i < ARRAY_SIZE( g_evgen_modifier_keys ); i++ ) {
+		if( key->modifiers & ( 1 << i ) )
+			set_bit( g_evgen_modifier_keys[ i ], batch->keys );
+	}
+}
 
+
+void jsmapper_evgen_begin_frame( struct jsmapper_evgen * evgen )
+{
+	unsigned long flags = 0;
 	
-	if( modifiers & JSMAPPER_MODIFIER_SHIFT_L )
-		input_event( g_evgen_dev, EV_KEY, KEY_LEFTSHIFT, press );
+	spin_lock_irqsave( &evgen->lock, flags );
+	evgen->batch.active = 1;
+	evgen->batch.stats.frames++;
+	spin_unlock_irqrestore( &evgen->lock, flags );
+}
+
+
+void jsmapper_evgen_end_frame( struct jsmapper_evgen * evgen )
+{
+	struct jsmapper_evgen_batch * batch = &evgen->batch;
+	unsigned long flags = 0;
 	
-	if( modifiers & JSMAPPER_MODIFIER_SHIFT_R )
-		input_event( g_evgen_dev, EV_KEY, KEY_RIGHTSHIFT, press );
+	spin_lock_irqsave( &evgen->lock, flags );
+	if( batch->pending ) {
+		input_sync( evgen->dev );
+		batch->stats.syncs++;
+		bitmap_zero( batch->keys, KEY_CNT );
+	}
+	batch->pending = 0;
+	batch->active = 0;
+	spin_unlock_irqrestore( &evgen->lock, flags );
+}
 
+
+void jsmapper_evgen_get_stats( struct jsmapper_evgen * evgen, struct jsmapper_evgen_stats * stats )
+{
+	struct jsmapper_evgen_counters * counters = NULL;
+	unsigned long flags = 0;
+	int cpu = 0;
+	int i = 0;
 	
-	if( modifiers & JSMAPPER_MODIFIER_ALT_L )
-		input_event( g_evgen_dev, EV_KEY, KEY_LEFTALT, press );
+	spin_lock_irqsave( &evgen->lock, flags );
+	*stats = evgen->batch.stats;
+	spin_unlock_irqrestore( &evgen->lock, flags );
 	
-	if( modifiers & JSMAPPER_MODIFIER_ALT_R )
-		input_event( g_evgen_dev, EV_KEY, KEY_RIGHTALT, press );
+	/* per-CPU counters are summed without locking, so they may be a few events behind: */
+	for_each_possible_cpu( cpu ) {
+		counters = per_cpu_ptr( evgen->counters, cpu );
+		for( i = 0; i < JSMAPPER_EVGEN_ACTION_TYPES; i++ )
+			stats->actions[ i ] += counters->actions[ i ];
+		stats->timer_events += counters->timer_events;
+		stats->work_items += counters->work_items;
+	}
+}
+
 
+void jsmapper_evgen_reset_stats( struct jsmapper_evgen * evgen )
+{
+	unsigned long flags = 0;
+	int cpu = 0;
 	
-	if( modifiers & JSMAPPER_MODIFIER_META_L )
-		input_event( g_evgen_dev, EV_KEY, KEY_LEFTMETA, press );
+	spin_lock_irqsave( &evgen->lock, flags );
+	memset( &evgen->batch.stats, 0, sizeof( evgen->batch.stats ) );
+	spin_unlock_irqrestore( &evgen->lock, flags );
 	
-	if( modifiers & JSMAPPER_MODIFIER_META_R )
-		input_event( g_evgen_dev, EV_KEY, KEY_RIGHTMETA, press );
+	/* counters being updated right now may survive the reset: */
+	for_each_possible_cpu( cpu )
+		memset( per_cpu_ptr( evgen->counters, cpu ), 0, sizeof( struct jsmapper_evgen_counters ) );
 }
 
 
-int jsmapper_evgen_send_key( struct jsmapdev_core_key * key, int press )
+/****************************************************************************************************************
+  
+  Key actions
+  
+****************************************************************************************************************/
+
+static void _send_key_modifiers( struct input_dev * dev, uint modifiers, int press )
 {
-    if( g_evgen_dev == NULL ) {
-        JSMAPPER_LOG_ERROR( "event generator device not available!" );
-		return -ENODEV;
+	uint i = 0;
+	
+	for( i = 0; i < ARRAY_SIZE( g_evgen_modifier_keys ); i++ ) {
+		if( modifiers & ( 1 << i ) )
+			input_event( dev, EV_KEY, g_evgen_modifier_keys[ i ], press );
 	}
+}
+
 
+int jsmapper_evgen_send_key( struct jsmapper_evgen * evgen, struct jsmapdev_core_key * key, int press )
+{
+	unsigned long flags = 0;
+	
+	/* single keys only send something on press: */
+	if( key->single && !press )
+		return 0;
+	
+	spin_lock_irqsave( &evgen->lock, flags );
+	
+    if( !evgen->registered ) {
+		spin_unlock_irqrestore( &evgen->lock, flags );
+        JSMAPPER_LOG_DEBUG( "event generator device not available yet!" );
+		return -ENODEV;
+	}
+	
+	_batch_add_key( evgen, key );
+	
     if( key->single ) {
+        JSMAPPER_LOG_DEBUG( "sending single key ID=%u, mod=0x%x", key->id, key->modifiers );
         
-        if( press ) {
-            JSMAPPER_LOG_DEBUG( "sending single key ID=%u, mod=0x%x", key->id, key->modifiers );
-            
-            _send_key_modifiers( key->modifiers, 1 );
-            input_event( g_evgen_dev, EV_KEY, key->id, 1 );
-            input_event( g_evgen_dev, EV_KEY, key->id, 0 );
-            _send_key_modifiers( key->modifiers, 0 );
-            
-            input_sync( g_evgen_dev );
-        }
+        _send_key_modifiers( evgen->dev, key->modifiers, 1 );
+        input_event( evgen->dev, EV_KEY, key->id, 1 );
+        input_event( evgen->dev, EV_KEY, key->id, 0 );
+        _send_key_modifiers( evgen->dev, key->modifiers, 0 );
         
     } else {
         JSMAPPER_LOG_DEBUG( "sending key ID=%u, mod=0x%x, press=%i", key->id, key->modifiers, press );
 
-        if( press || key->single ) 
-            _send_key_modifiers( key->modifiers, 1 );
+        if( press ) 
+            _send_key_modifiers( evgen->dev, key->modifiers, 1 );
         
-        input_event( g_evgen_dev, EV_KEY, key->id, press );
+        input_event( evgen->dev, EV_KEY, key->id, press );
         
         if( press == 0 )
-            _send_key_modifiers( key->modifiers, 0 );
-        
-        input_sync( g_evgen_dev );
+            _send_key_modifiers( evgen->dev, key->modifiers, 0 );
     }
     
+	_batch_sync( evgen );
+	spin_unlock_irqrestore( &evgen->lock, flags );
+    
 	return 0;
 }
 
@@ -326,86 +608,152 @@ int jsmapper_evgen_send_key( struct jsmapdev_core_key * key, int press )
   
 ****************************************************************************************************************/
 
-static int send_rel_thread( void * data )
+/**
+  * \brief Computes the step of a motion emitter from the current value of its source axis
+  */
+
+static int _motion_step( struct jsmapper_evgen_rel_emitter * rel )
 {
-    struct send_rel_thread_params * rel = (struct send_rel_thread_params *) data;
-    
-    JSMAPPER_LOG_DEBUG( "started thread for relative axis ID=%u", rel->id );
-    
-    while( rel->cancel == 0 ) {
-        JSMAPPER_LOG_DEBUG( "sending event for relative axis ID=%u, step=%i", rel->id, rel->step );
-        input_event( g_evgen_dev, EV_REL, rel->id, rel->step );
-        input_sync( g_evgen_dev );
-        
-        if( rel->spacing > 0 ) {
-            msleep( rel->spacing );
-        }
-    }
-    
-    JSMAPPER_LOG_DEBUG( "finished thread for relative axis ID=%u", rel->id );
-    
-    /* destroy ptr to data: */
-    kfree( rel );
-    return 0;
+	const struct jsmapdev_core_motion * motion = &rel->motion;
+	s64		deflection = (s64) input_abs_get_val( motion->dev, motion->abs ) - motion->center;
+	s64		span = (s64) motion->range - motion->deadzone;
+	int		sign = deflection < 0 ? -1 : 1;
+	int		d = 0;
+	int		out = 0;
+	int		step = 0;
+	
+	deflection = ( deflection < 0 ? -deflection : deflection ) - motion->deadzone;
+	if( deflection <= 0 || span <= 0 ) {
+		rel->remainder = 0;
+		return 0;
+	}
+	
+	/* deflection past the deadzone, normalized to Q15, then shaped by the curve: */
+	d = deflection >= span ? ( 1 << 15 ) : (int) div64_s64( deflection << 15, span );
+	d += ( ( ( d * d ) >> 15 ) - d ) * (int) motion->curve >> 15;
+	
+	/* output in Q15 axis units, keeping the fraction for next step: */
+	out = sign * d * motion->max_step + rel->remainder;
+	step = out / ( 1 << 15 );
+	rel->remainder = out - step * ( 1 << 15 );
+	
+	return step;
 }
 
 
-static void send_rel_work( struct work_struct * work )
-{
-	struct send_rel_work_params		* w = (struct send_rel_work_params *) work;
-	struct task_struct				* thread = NULL;
-	struct send_rel_thread_params	* thread_p = NULL;
+/**
+  * \brief Relative axis timer callback
+  * 
+  * Sends a step for every emitter due (or about to be), all of them inside a single frame, then re-arms the timer 
+  * for the next one. The steps are synced as any other output, so they join the batch of an input frame being 
+  * resolved. When no emitter is left running, the timer is not re-armed.
+  * 
+  * If an emitter started on another CPU re-armed the timer while this call waited for the lock, the queued 
+  * expiration sends the frame instead: re-arming a queued timer from here would corrupt the timer queue.
+  */
 
-	spin_lock( &g_evgen_lock );
+static enum hrtimer_restart _send_rel_frame( struct hrtimer * timer )
+{
+	struct jsmapper_evgen * evgen = container_of( timer, struct jsmapper_evgen, rel_timer );
+	struct jsmapper_evgen_rel_emitter * rel = NULL;
+	ktime_t			now = ktime_get();
+	ktime_t			due = ktime_add_ns( now, JSMAPPER_EVGEN_REL_SLACK );
+	ktime_t			next = now;
+	unsigned long	flags = 0;
+	uint			id = 0;
+	int				step = 0;
+	int				running = 0;
+	int				sent = 0;
 	
-	if( g_evgen_rel[w->rel.id] ) {
-        /* stop current thread, if any: */
-        JSMAPPER_LOG_DEBUG( "stopping thread for relative axis ID=%u", w->rel.id );
-        g_evgen_rel[w->rel.id]->cancel = 1;
-        g_evgen_rel[w->rel.id] = NULL;
-    }
-    
-    if( w->press ) {
-        /* copy parameters: */
-        thread_p = (struct send_rel_thread_params *) kzalloc( sizeof( struct send_rel_thread_params ), GFP_KERNEL );
-        if( thread_p ) {
-			memcpy( thread_p, &w->rel, sizeof( w->rel) );
-            
-            /* launch thread: */
-            thread = kthread_create( send_rel_thread, thread_p, "rel_axis" );	// TODO add axis ID to thread name
-            if( thread ) {
-				g_evgen_rel[w->rel.id] = thread_p;
-                wake_up_process( thread );
-                
-            } else {
-                JSMAPPER_LOG_ERROR( "failed to launch relative axis thread!" );
-                kfree( thread_p );
-            }
-            
-        } else {
-            JSMAPPER_LOG_ERROR( "failed to allocate parameters for relative axis thread!" );
-        }
-    }
+	this_cpu_inc( evgen->counters->timer_events );
+	
+	spin_lock_irqsave( &evgen->lock, flags );
+	
+	if( hrtimer_is_queued( timer ) ) {
+		spin_unlock_irqrestore( &evgen->lock, flags );
+		return HRTIMER_NORESTART;
+	}
+	
+	for_each_set_bit( id, evgen->rel_active, REL_CNT ) {
+		rel = &evgen->rel[ id ];
+		if( ktime_compare( rel->next, due ) <= 0 ) {
+			step = rel->motion.dev ? _motion_step( rel ) : rel->step;
+			if( step ) {
+				trace_jsmapper_rel_emitted( evgen->dev, id, step );
+				input_event( evgen->dev, EV_REL, id, step );
+				sent++;
+			}
+			
+			/* keep the pace, but don't try to catch up with steps missed if we were late: */
+			rel->next = ktime_add( rel->next, rel->spacing );
+			if( ktime_compare( rel->next, now ) < 0 )
+				rel->next = ktime_add( now, rel->spacing );
+		}
+		
+		if( running++ == 0 || ktime_compare( rel->next, next ) < 0 )
+			next = rel->next;
+	}
+	
+	/* an input frame may be in progress on another CPU: don't split it, let it close ours too */
+	if( sent )
+		_batch_sync( evgen );
 	
-	kfree( w );
+	if( running )
+		hrtimer_set_expires( timer, next );
 	
-	spin_unlock( &g_evgen_lock );
+	spin_unlock_irqrestore( &evgen->lock, flags );
+	
+	return running ? HRTIMER_RESTART : HRTIMER_NORESTART;
 }
 
 
-int jsmapper_evgen_send_rel( struct jsmapdev_core_rel * rel, int press )
+/**
+  * \brief Starts (or restarts, replacing the previous one) or stops the emitter for a relative axis
+  */
+
+static int _start_rel( struct jsmapper_evgen * evgen, uint id, int step, uint spacing, 
+					   const struct jsmapdev_core_motion * motion, int press )
 {
-    int							result = 0;
-	struct send_rel_work_params	* w = NULL;
-    
-    
-	if( g_evgen_dev == NULL ) {
-        JSMAPPER_LOG_ERROR( "event generator device not available!" );
+	struct jsmapper_evgen_rel_emitter * rel = &evgen->rel[ id ];
+	unsigned long flags = 0;
+	
+	spin_lock_irqsave( &evgen->lock, flags );
+	if( evgen->shutdown ) {
+		spin_unlock_irqrestore( &evgen->lock, flags );
 		return -ENODEV;
 	}
 	
+	if( press ) {
+		rel->step = step;
+		rel->spacing = ns_to_ktime( max_t( u64, (u64) spacing * NSEC_PER_MSEC, JSMAPPER_EVGEN_REL_MIN_SPACING ) );
+		rel->next = ktime_get();
+		rel->remainder = 0;
+		if( motion )
+			rel->motion = *motion;
+		else
+			rel->motion.dev = NULL;
+		set_bit( id, evgen->rel_active );
+		trace_jsmapper_rel_started( evgen->dev, id, step, ktime_to_ns( rel->spacing ) );
+		
+		/* first step is sent right away, the timer will stop by itself once no axis is left running: */
+		hrtimer_start( &evgen->rel_timer, ktime_get(), HRTIMER_MODE_ABS );
+	} else if( test_bit( id, evgen->rel_active ) ) {
+		clear_bit( id, evgen->rel_active );
+		trace_jsmapper_rel_stopped( evgen->dev, id, rel->step, ktime_to_ns( rel->spacing ) );
+	}
+	spin_unlock_irqrestore( &evgen->lock, flags );
+	
+	return 0;
+}
+
+
+int jsmapper_evgen_send_rel( struct jsmapper_evgen * evgen, struct jsmapdev_core_rel * rel, int press )
+{
+	unsigned long flags = 0;
+	int result = 0;
+	
     if( rel->id >= REL_MAX ) {
-        JSMAPPER_LOG_ERROR( "invalid relative axis ID=%u!", rel->id );
+        JSMAPPER_LOG_ERROR_RATELIMITED( "invalid relative axis ID=%u!", rel->id );
 		return -EINVAL;
     }
 
@@ -414,38 +762,42 @@ int jsmapper_evgen_send_rel( struct jsmapdev_core_rel * rel, int press )
         /* throw a single event on button press */
         if( press ) {
             JSMAPPER_LOG_DEBUG( "sending event for relative axis ID=%u, step=%i", rel->id, rel->step );
-            input_event( g_evgen_dev, EV_REL, rel->id, rel->step );
-            input_sync( g_evgen_dev );
+            
+            spin_lock_irqsave( &evgen->lock, flags );
+            if( evgen->registered ) {
+                trace_jsmapper_rel_emitted( evgen->dev, rel->id, rel->step );
+                input_event( evgen->dev, EV_REL, rel->id, rel->step );
+                _batch_sync( evgen );
+            } else {
+                result = -ENODEV;
+            }
+            spin_unlock_irqrestore( &evgen->lock, flags );
         }
         
     } else {
-
-		/* launch action thread: 
-		 *	  As we are in IRQ context, we can't simply create a thread here (causes a kernel crash). Instead, 
-		 * we defer the thread creation to a work item, which will get executed under normal process context.
-	     */
-        w = (struct send_rel_work_params *) kzalloc( sizeof( struct send_rel_work_params ), GFP_ATOMIC );
-        if( w ) {
-			/* copy parameters: */
-			w->press = press;
-			w->rel.id = rel->id;
-            w->rel.step = rel->step;
-            w->rel.spacing = rel->spacing;
-			
-			/* ok, queue work item: */
-			INIT_WORK( &w->work, send_rel_work );
-			result = queue_work( g_evgen_wq, &w->work );
-                
-        } else {
-            JSMAPPER_LOG_ERROR( "failed to allocate work item!" );
-            result = -ENOMEM;
-        }
+		
+		JSMAPPER_LOG_DEBUG( "%s relative axis ID=%u, step=%i, spacing=%u", 
+							press ? "starting" : "stopping", rel->id, rel->step, rel->spacing );
+		result = _start_rel( evgen, rel->id, rel->step, rel->spacing, NULL, press );
     }
 	
 	return result;
 }
 
 
+int jsmapper_evgen_send_motion( struct jsmapper_evgen * evgen, struct jsmapdev_core_motion * motion, int press )
+{
+    if( motion->id >= REL_MAX || motion->dev == NULL ) {
+        JSMAPPER_LOG_ERROR_RATELIMITED( "invalid motion action for relative axis ID=%u!", motion->id );
+		return -EINVAL;
+    }
+	
+	JSMAPPER_LOG_DEBUG( "%s motion on relative axis ID=%u from axis 0x%x", 
+						press ? "starting" : "stopping", motion->id, motion->abs );
+	return _start_rel( evgen, motion->id, 0, motion->spacing, motion, press );
+}
+
+
 
 /****************************************************************************************************************
   
@@ -454,93 +806,185 @@ int jsmapper_evgen_send_rel( struct jsmapdev_core_rel * rel, int press )
 ****************************************************************************************************************/
 
 /**
-  * \brief Work function for key sequence
+  * \brief Macro timer callback
   * 
-  * This callback function gets called from the workqueue when the new item gets scheduled. It takes caree
-  * of actually sending te keys, then cleaning up the data.
+  * Sends the next key of the run (the whole sequence at once if it has no spacing), then re-arms the timer for 
+  * the following one. Once the sequence is finished, starts over if more runs were queued, or else releases the 
+  * profile.
+  * 
+  * If the timer was started again while this call waited for the lock, the queued expiration takes over: this one 
+  * leaves the timer and the profile reference alone.
   */
 
-static void _send_macro( struct work_struct * work )
+static enum hrtimer_restart _send_macro_key( struct hrtimer * timer )
 {
-    struct send_macro_work * p = (struct send_macro_work *) work;
-    struct jsmapdev_core_key * key = NULL;
-    int i = 0;
-
-    JSMAPPER_LOG_DEBUG( "sending macro (keys: %u)", p->macro.count );
-    
-    key = p->macro.keys;
-    for( i = 0; i < p->macro.count; i++ ) {
-        JSMAPPER_LOG_DEBUG( "sending macro key ID=%u, mod=0x%x", key->id, key->modifiers );
-        
-        _send_key_modifiers( key->modifiers, 1 );
-        input_event( g_evgen_dev, EV_KEY, key->id, 1 );
-        input_event( g_evgen_dev, EV_KEY, key->id, 0 );
-        _send_key_modifiers( key->modifiers, 0 );
-        
-        input_sync( g_evgen_dev );
-        
-        if( i < p->macro.count - 1 ) {
-            msleep( p->macro.spacing );
+	struct jsmapper_evgen_macro_run * run = container_of( timer, struct jsmapper_evgen_macro_run, timer );
+	struct jsmapper_evgen * evgen = run->evgen;
+	struct jsmapdev_core_profile * profile = run->profile;
+	const struct jsmapdev_core_key * key = NULL;
+	ktime_t			now = ktime_get();
+	ktime_t			next;
+	unsigned long	flags = 0;
+	int				finished = 0;
+	
+	this_cpu_inc( evgen->counters->timer_events );
+	spin_lock_irqsave( &evgen->lock, flags );
+	
+	if( evgen->shutdown || hrtimer_is_queued( timer ) ) {
+		spin_unlock_irqrestore( &evgen->lock, flags );
+		return HRTIMER_NORESTART;
+	}
+	
+	if( !run->cancelled && run->pos == 0 )
+		trace_jsmapper_macro_started( evgen->dev, run, run->pos, run->count, run->queued );
+	
+	while( !run->cancelled && run->pos < run->count ) {
+		key = &run->keys[ run->pos++ ];
+		
+		if( evgen->registered ) {
+			/* synced as any other output, so keys don't split an input frame being resolved on another CPU: */
+			trace_jsmapper_macro_key( evgen->dev, run, key->id, key->modifiers );
+			_batch_add_key( evgen, key );
+			_send_key_modifiers( evgen->dev, key->modifiers, 1 );
+			input_event( evgen->dev, EV_KEY, key->id, 1 );
+			input_event( evgen->dev, EV_KEY, key->id, 0 );
+			_send_key_modifiers( evgen->dev, key->modifiers, 0 );
+			_batch_sync( evgen );
 		}
-        
-        key++;
-    }
-    
-    JSMAPPER_LOG_DEBUG( "finished sending macro." );
-  
-    kfree( p->macro.keys );
-    kfree( p );
+		
+		if( ktime_to_ns( run->spacing ) > 0 )
+			break;
+	}
+	
+	if( !run->cancelled && run->pos >= run->count && run->queued > 0 ) {
+		run->queued--;
+		run->pos = 0;
+	}
+	
+	finished = run->cancelled || run->pos >= run->count;
+	if( finished ) {
+		trace_jsmapper_macro_finished( evgen->dev, run, run->pos, run->count, run->queued );
+		list_del_init( &run->list );
+		run->active = 0;
+	} else {
+		/* keep the pace, but never send two keys closer than the spacing if we were late: */
+		next = ktime_add( hrtimer_get_expires( timer ), run->spacing );
+		if( ktime_compare( next, now ) < 0 )
+			next = ktime_add( now, run->spacing );
+		hrtimer_set_expires( timer, next );
+	}
+	
+	spin_unlock_irqrestore( &evgen->lock, flags );
+	
+	if( finished ) {
+		/* the run lives in the profile, so it may be gone after this: */
+		jsmapper_core_put_profile( profile );
+		return HRTIMER_NORESTART;
+	}
+	
+	return HRTIMER_RESTART;
 }
 
 
-int jsmapper_evgen_send_macro( struct jsmapdev_core_macro * macro, int press )
+int jsmapper_evgen_init_macro( struct jsmapdev_core_profile * profile, struct jsmapdev_core_macro * macro )
 {
-    int result = 0;
-	size_t keys_cb = 0;
-    struct send_macro_work * p = NULL;
+	struct jsmapper_evgen_macro_run * run = NULL;
 	
-    if( g_evgen_dev == NULL ) {
-        JSMAPPER_LOG_ERROR( "event generator device not available!" );
-        return -ENODEV;
-    }
-    
-    if( g_evgen_wq == NULL ) {
-        JSMAPPER_LOG_ERROR( "workqueue not available!" );
-        return -ENODEV;
-    }
-        
-    
-    if( press ) {
-        /* create work item: */
-        p = (struct send_macro_work *) kmalloc( sizeof( struct send_macro_work ), GFP_ATOMIC );
-        if( p ) {
-            keys_cb = sizeof( macro->keys[0] ) * macro->count;
-            p->macro.keys = (struct jsmapdev_core_key *) kmalloc( keys_cb, GFP_ATOMIC );
-            if( p->macro.keys ) {
-                /* copy keys, etc...: */
-                memcpy( p->macro.keys, macro->keys, keys_cb );
-                p->macro.count = macro->count;
-                p->macro.spacing = macro->spacing;
-                
-                /* ok, queue work item: */
-                INIT_WORK( &p->work, _send_macro );
-                result = queue_work( g_evgen_wq, &p->work );
-                
-            } else {
-                JSMAPPER_LOG_ERROR( "failed to allocate keys buffer!" );
-                kfree( p );
-                result = -ENOMEM;
-            }
-        
-        } else {
-            JSMAPPER_LOG_ERROR( "failed to allocate work item!" );
-            result = -ENOMEM;
-        }
-    
-    } else {
-        /* do nothing on button release */
-    }
+	run = jsmapper_core_alloc( profile, sizeof( struct jsmapper_evgen_macro_run ) );
+	if( run == NULL ) {
+		JSMAPPER_LOG_ERROR( "failed to allocate macro run!" );
+		return -ENOMEM;
+	}
+	
+	hrtimer_init( &run->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS );
+	run->timer.function = _send_macro_key;
+	INIT_LIST_HEAD( &run->list );
+	run->profile = profile;
+	run->policy = macro->policy;
+	run->keys = macro->keys;
+	run->count = macro->count;
+	run->spacing = ms_to_ktime( macro->spacing );
+	
+	macro->run = run;
+	return 0;
+}
 
-    return result;    
+
+/**
+  * Makes the timer of an active run fire right away, so it picks up the run's new state. If its callback is running 
+  * on another CPU (waiting for the lock, or about to re-arm itself), it's left alone: it will see the new state by 
+  * itself. Called with event generator lock held.
+  */
+
+static void _kick_macro_run( struct jsmapper_evgen_macro_run * run )
+{
+	if( hrtimer_try_to_cancel( &run->timer ) >= 0 )
+		hrtimer_start( &run->timer, ktime_get(), HRTIMER_MODE_ABS );
 }
 
+
+int jsmapper_evgen_send_macro( struct jsmapper_evgen * evgen, struct jsmapdev_core_macro * macro, int press )
+{
+	struct jsmapper_evgen_macro_run * run = macro->run;
+	unsigned long flags = 0;
+	int result = 0;
+	
+    if( run == NULL ) {
+        JSMAPPER_LOG_ERROR_RATELIMITED( "macro action not installed in a profile!" );
+        return -EINVAL;
+    }
+    
+    if( run->count == 0 )
+		return 0;
+	
+	spin_lock_irqsave( &evgen->lock, flags );
+	
+	if( evgen->shutdown ) {
+		result = -ENODEV;
+		
+	} else if( press && !run->active ) {
+		JSMAPPER_LOG_DEBUG( "sending macro (keys: %u, spacing: %u ms)", macro->count, macro->spacing );
+		run->active = 1;
+		run->cancelled = 0;
+		run->pos = 0;
+		run->queued = 0;
+		run->evgen = evgen;
+		jsmapper_core_hold_profile( run->profile );
+		list_add_tail( &run->list, &evgen->macros );
+		trace_jsmapper_macro_queued( evgen->dev, run, run->pos, run->count, run->queued );
+		
+		/* a callback still running can only be returning from the previous run, which it no longer touches: */
+		hrtimer_start( &run->timer, ktime_get(), HRTIMER_MODE_ABS );
+		
+	} else if( press ) {
+		/* activated again while still running (a cancelled run just waits to be stopped, so restart it): */
+		switch( run->cancelled ? JSMAPPER_MACRO_RESTART : run->policy ) {
+		case JSMAPPER_MACRO_QUEUE:
+			if( run->queued < JSMAPPER_EVGEN_MACRO_MAX_QUEUED )
+				run->queued++;
+			trace_jsmapper_macro_queued( evgen->dev, run, run->pos, run->count, run->queued );
+			break;
+			
+		case JSMAPPER_MACRO_IGNORE:
+			break;
+			
+		default:
+			run->cancelled = 0;
+			run->pos = 0;
+			run->queued = 0;
+			trace_jsmapper_macro_queued( evgen->dev, run, run->pos, run->count, run->queued );
+			_kick_macro_run( run );
+			break;
+		}
+		
+	} else if( run->active && run->policy == JSMAPPER_MACRO_CANCEL ) {
+		/* drop the remaining keys, the timer stops right away: */
+		JSMAPPER_LOG_DEBUG( "cancelling macro (%u keys left)", run->count - run->pos );
+		run->cancelled = 1;
+		_kick_macro_run( run );
+	}
+	
+	spin_unlock_irqrestore( &evgen->lock, flags );
+	
+	return result;
+}
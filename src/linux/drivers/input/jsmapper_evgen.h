@@ -27,28 +27,111 @@
 #include "jsmapper_core.h"
 
 struct input_dev;
+struct jsmapper_evgen;
 
 /**
- * \brief Initializes the virtual event generator
+ * \brief Initializes the event generator module
  */
 
 int jsmapper_evgen_init( void );
 
+
+/**
+ * \brief Creates a virtual event generator
+ *
+ * Every jsmapper device gets its own event generator, with its own output device. As this is called from the input 
+ * handler callbacks, the output device gets registered later, out of the input core lock: events sent meanwhile 
+ * are dropped.
+ *
+ * \param name Name of the jsmapper device the generator belongs to, used to name the output device
+ * \return The new event generator, or NULL if failed
+ */
+
+struct jsmapper_evgen * jsmapper_evgen_create( const char * name );
+
+
+/**
+ * \brief Destroys a virtual event generator
+ *
+ * Stops every macro & relative axis emitter still running, and unregisters the output device (also later). No 
+ * action can be sent to the generator after this.
+ */
+
+void jsmapper_evgen_destroy( struct jsmapper_evgen * evgen );
+
+
+/**
+ * \brief Tells whether an input device is the output device of an event generator
+ */
+
+bool jsmapper_evgen_is_device( struct input_dev * dev );
+
+
+/** Number of action types counted in struct jsmapper_evgen_stats (JSMAPPER_ACTION_NONE to JSMAPPER_ACTION_MOTION) */
+#define JSMAPPER_EVGEN_ACTION_TYPES		( JSMAPPER_ACTION_MOTION + 1 )
+
+/**
+ * \brief Event generator output counters
+ */
+
+struct jsmapper_evgen_stats {
+	/** Number of input frames resolved */
+	unsigned long frames;
+	/** Number of syncs requested while resolving input frames, i.e. the ones that would be sent without batching */
+	unsigned long requested_syncs;
+	/** Number of syncs actually sent for input frames */
+	unsigned long syncs;
+	/** Number of actions activated, by type (JSMAPPER_ACTION_*) */
+	unsigned long actions[ JSMAPPER_EVGEN_ACTION_TYPES ];
+	/** Number of timer expirations sending deferred events (relative axis steps & macro keys) */
+	unsigned long timer_events;
+	/** Number of work items queued (output device registration & removal) */
+	unsigned long work_items;
+};
+
+
+/**
+ * \brief Starts an output batch
+ *
+ * Events generated from now on, until jsmapper_evgen_end_frame() is called, are sent as a single output frame,
+ * so consumers get woken up once per input frame instead of once per action. Whenever a key (or modifier)
+ * would change twice inside the batch, a sync is sent in between, so every output frame keeps the ordering
+ * guarantees of the actions sent one by one.
+ */
+
+void jsmapper_evgen_begin_frame( struct jsmapper_evgen * evgen );
+
+
+/**
+ * \brief Ends an output batch, sending the pending sync if needed
+ */
+
+void jsmapper_evgen_end_frame( struct jsmapper_evgen * evgen );
+
+
 /**
- * \brief Returns the pointer to the virtual event generator
+ * \brief Returns output counters
  */
 
-struct input_dev * jsmapper_evgen_device( void );
+void jsmapper_evgen_get_stats( struct jsmapper_evgen * evgen, struct jsmapper_evgen_stats * stats );
+
+
+/**
+ * \brief Resets output counters
+ */
+
+void jsmapper_evgen_reset_stats( struct jsmapper_evgen * evgen );
 
 
 /**
  * \brief Simulates action
  * 
+ * \param evgen Event generator of the device the action belongs to
  * \param action Action to generate
  * \param press 1 if action is being activated, 0 if deactivated
  */
 
-int jsmapper_evgen_send_action( struct jsmapdev_core_action * action, int press );
+int jsmapper_evgen_send_action( struct jsmapper_evgen * evgen, struct jsmapdev_core_action * action, int press );
 
 
 /**
@@ -67,21 +150,36 @@ int jsmapper_evgen_send_action( struct jsmapdev_core_action * action, int press
  * \param press 1 for source button press, 0 for release
  */
 
-int jsmapper_evgen_send_key( struct jsmapdev_core_key * key, int press);
+int jsmapper_evgen_send_key( struct jsmapper_evgen * evgen, struct jsmapdev_core_key * key, int press );
 
 
 /**
  * \brief Generates a relative axis movement
  * 
  * This function will simulate a relative axis movement. Depending on the action type (single, etc...), it will 
- * instantly send it, or else will start / stop a background thread that keeps sending as long as the source button
- * is pressed.
+ * instantly send it, or else will start / stop an emitter that keeps sending steps as long as the source button
+ * is pressed. All emitters are driven by a single high resolution timer, so steps of different axes due at the 
+ * same time are sent in the same frame, and nothing runs while no emitter is active. Every event generator has its 
+ * own emitters, so actions of different devices on the same axis don't interfere.
  *
  * \param rel Pointer to the relative axis struct to send.
  * \param press 1 for source button press, 0 for release
  */
 
-int jsmapper_evgen_send_rel( struct jsmapdev_core_rel * rel, int press );
+int jsmapper_evgen_send_rel( struct jsmapper_evgen * evgen, struct jsmapdev_core_rel * rel, int press );
+
+
+/**
+ * \brief Starts / stops a relative axis movement proportional to an absolute axis
+ * 
+ * While the action is active, the relative axis emitter computes every step from the value the input core 
+ * keeps cached for the source axis, so axis events themselves don't need to reach the event generator.
+ *
+ * \param motion Pointer to the motion struct, with the source axis already set
+ * \param press 1 when the source axis enters the band, 0 when it leaves it
+ */
+
+int jsmapper_evgen_send_motion( struct jsmapper_evgen * evgen, struct jsmapdev_core_motion * motion, int press );
 
 
 /**
@@ -90,18 +188,36 @@ int jsmapper_evgen_send_rel( struct jsmapdev_core_rel * rel, int press );
   * This function generates a "macro" action, by sending a key press / release pair of events 
   * for everyone of the given keys, spacing every key event by the gicven amount of time.
   *
-  * The keys to sent are queued into a "workqueue", so this function will return immediately while 
-  * the keys are being sent in background, by calling jsmapper_evgen_send_single_key() repeteadly.
+  * Every macro being played gets its own high resolution timer sending the keys, so this function returns 
+  * immediately. Activating a macro while it's still running queues, restarts or ignores it, depending on its 
+  * re-trigger policy; macros with the JSMAPPER_MACRO_CANCEL policy get stopped on release.
+  *
+  * Nothing is allocated: the macro must have been installed in a profile (see jsmapper_evgen_init_macro()), 
+  * which is kept alive by the run until it finishes.
   *
   * \param macro Pointer to an structure defining the macro to send
   * \param press 1 for source button press, 0 for release
   */
-int jsmapper_evgen_send_macro( struct jsmapdev_core_macro * macro, int press );
+int jsmapper_evgen_send_macro( struct jsmapper_evgen * evgen, struct jsmapdev_core_macro * macro, int press );
+
+
+/**
+  * \brief Prepares a macro action being installed in a profile to be played
+  * 
+  * Allocates the run state of the macro from profile's arena. Must be called once macro keys have been copied 
+  * into the profile, as they're used in place.
+  *
+  * \param profile Profile the action is being installed in
+  * \param macro Pointer to the macro, inside the profile
+  */
+int jsmapper_evgen_init_macro( struct jsmapdev_core_profile * profile, struct jsmapdev_core_macro * macro );
 
 
 
 /**
- * \brief Destroys the virtual event generator
+ * \brief Cleans up the event generator module
+ *
+ * Waits for the output devices of the event generators destroyed to be unregistered.
  */
 
 void jsmapper_evgen_done( void );
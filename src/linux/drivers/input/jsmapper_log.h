@@ -18,19 +18,66 @@
  * \file jsmapper_log.h
  * \brief JSMapper kernel module log macros
  * \author Eduard Huguet <eduardhc@gmail.com>
- * \todo Select debug level at runtime
  */
 
 #ifndef __JSMAPPER_LOG_H_
 #define __JSMAPPER_LOG_H_
 
-#define JSMAPPER_LOG_DEBUG( _MSG_...)           JSMAPPER_LOG( "(DBG)", _MSG_ )
-#define JSMAPPER_LOG_INFO( _MSG_...)            JSMAPPER_LOG( "(INF)", _MSG_ )
-#define JSMAPPER_LOG_WARNING( _MSG_...)         JSMAPPER_LOG( "(WRN)", _MSG_ )
-#define JSMAPPER_LOG_ERROR( _MSG_...)           JSMAPPER_LOG( "(ERR)", _MSG_ )
+#include <linux/printk.h>
+#include <linux/jump_label.h>
 
-#define JSMAPPER_LOG( _LEVEL_, _MSG_...)        \
-            { printk( "jsmapper " _LEVEL_ ": " _MSG_ ); printk( "\n" ); }
+/** Log levels, as set through the log_level module parameter */
+#define JSMAPPER_LOG_LEVEL_NONE			0
+#define JSMAPPER_LOG_LEVEL_ERROR		1
+#define JSMAPPER_LOG_LEVEL_WARNING		2
+#define JSMAPPER_LOG_LEVEL_INFO			3
+#define JSMAPPER_LOG_LEVEL_DEBUG		4
+
+/** Current log level (JSMAPPER_LOG_LEVEL_INFO by default) */
+extern int jsmapper_log_level;
+
+/** Enabled only while log level is JSMAPPER_LOG_LEVEL_DEBUG */
+DECLARE_STATIC_KEY_FALSE( jsmapper_log_debug );
+
+
+/*
+ * Debug messages are sent from hot paths (IRQ context included), so they're behind a static key: while the log 
+ * level is below JSMAPPER_LOG_LEVEL_DEBUG they cost a no-op. They're pr_debug() messages otherwise, so single ones 
+ * can still be enabled through dynamic debug, and get compiled out when it isn't available.
+ */
+#define JSMAPPER_LOG_DEBUG( _FMT_, _ARGS_...)	\
+	do { \
+		if( static_branch_unlikely( &jsmapper_log_debug ) ) \
+			printk( KERN_DEBUG "jsmapper (DBG): " _FMT_ "\n", ##_ARGS_ ); \
+		else \
+			pr_debug( "jsmapper (DBG): " _FMT_ "\n", ##_ARGS_ ); \
+	} while( 0 )
+
+#define JSMAPPER_LOG_INFO( _MSG_...)            JSMAPPER_LOG( JSMAPPER_LOG_LEVEL_INFO, KERN_INFO "jsmapper (INF): ", _MSG_ )
+#define JSMAPPER_LOG_WARNING( _MSG_...)         JSMAPPER_LOG( JSMAPPER_LOG_LEVEL_WARNING, KERN_WARNING "jsmapper (WRN): ", _MSG_ )
+#define JSMAPPER_LOG_ERROR( _MSG_...)           JSMAPPER_LOG( JSMAPPER_LOG_LEVEL_ERROR, KERN_ERR "jsmapper (ERR): ", _MSG_ )
+
+#define JSMAPPER_LOG( _LEVEL_, _PREFIX_, _FMT_, _ARGS_...)	\
+	do { \
+		if( jsmapper_log_level >= _LEVEL_ ) \
+			printk( _PREFIX_ _FMT_ "\n", ##_ARGS_ ); \
+	} while( 0 )
+
+
+/*
+ * Ratelimited variants, for the messages that may be triggered by every input event: a misbehaving device 
+ * must not flood the kernel log.
+ */
+#define JSMAPPER_LOG_WARNING_RATELIMITED( _MSG_...)	\
+			JSMAPPER_LOG_RATELIMITED( JSMAPPER_LOG_LEVEL_WARNING, KERN_WARNING "jsmapper (WRN): ", _MSG_ )
+#define JSMAPPER_LOG_ERROR_RATELIMITED( _MSG_...)	\
+			JSMAPPER_LOG_RATELIMITED( JSMAPPER_LOG_LEVEL_ERROR, KERN_ERR "jsmapper (ERR): ", _MSG_ )
+
+#define JSMAPPER_LOG_RATELIMITED( _LEVEL_, _PREFIX_, _FMT_, _ARGS_...)	\
+	do { \
+		if( jsmapper_log_level >= _LEVEL_ ) \
+			printk_ratelimited( _PREFIX_ _FMT_ "\n", ##_ARGS_ ); \
+	} while( 0 )
 
 
 #endif // __JSMAPPER_LOG_H_
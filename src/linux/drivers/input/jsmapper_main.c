@@ -25,11 +25,16 @@
 #include "jsmapper_api.h"
 #include "jsmapper_log.h"
 
+#define CREATE_TRACE_POINTS
+#include "jsmapper_trace.h"
+
 #include <linux/kernel.h>
 #include <linux/input.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 
 #include <linux/poll.h>
+#include <linux/mm.h>
 #include <linux/sched.h>
 #include <linux/module.h>
 #include <linux/init.h>
@@ -37,6 +42,11 @@
 #include <linux/device.h>
 #include <linux/version.h>
 
+#include <linux/percpu.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,11,0)
+	#include <linux/sched/clock.h>
+#endif
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)    
 	/* From Linux 3.7.0 and onwards a new set of APIs must be used to handle character device allocation */
 	#define USE_CDEV
@@ -49,6 +59,48 @@ MODULE_DESCRIPTION("Joystick mapper device interfaces");
 MODULE_LICENSE("GPL");
 
 
+/**********************************************************************************************************************
+
+	Logging
+
+**********************************************************************************************************************/
+
+int jsmapper_log_level = JSMAPPER_LOG_LEVEL_INFO;
+DEFINE_STATIC_KEY_FALSE( jsmapper_log_debug );
+
+
+/**
+ * \brief Sets log level, switching debug messages on / off
+ */
+
+static int _set_log_level( const char * val, const struct kernel_param * kp )
+{
+	int level = 0;
+	int result = kstrtoint( val, 0, &level );
+
+	if( result < 0 )
+		return result;
+	if( level < JSMAPPER_LOG_LEVEL_NONE || level > JSMAPPER_LOG_LEVEL_DEBUG )
+		return -EINVAL;
+
+	*(int *) kp->arg = level;
+	if( level >= JSMAPPER_LOG_LEVEL_DEBUG )
+		static_branch_enable( &jsmapper_log_debug );
+	else
+		static_branch_disable( &jsmapper_log_debug );
+
+	return 0;
+}
+
+static const struct kernel_param_ops jsmapper_log_level_ops = {
+	.set = _set_log_level,
+	.get = param_get_int,
+};
+
+module_param_cb( log_level, &jsmapper_log_level_ops, &jsmapper_log_level, 0644 );
+MODULE_PARM_DESC( log_level, "Log level: 0 = none, 1 = errors, 2 = warnings, 3 = info (default), 4 = debug" );
+
+
 /**********************************************************************************************************************
 
 	Declarations
@@ -57,7 +109,45 @@ MODULE_LICENSE("GPL");
 
 static int 	JSMAPDEV_MAJOR 		= INPUT_MAJOR;
 #define 	JSMAPDEV_MINOR_BASE	96
-#define 	JSMAPDEV_MINORS		16
+/* 
+ * Legacy minor range, i.e. the whole block of minors the input core routes to a handler. Once exhausted, devices 
+ * get dynamic minors from the input core (Linux 3.7 and onwards), which are only limited by INPUT_MAX_CHAR_DEVICES.
+ */
+#define 	JSMAPDEV_MINORS		32
+
+
+/** Input event types counted separately (see jsmapdev_stats) */
+enum {
+	JSMAPDEV_STATS_SYN,
+	JSMAPDEV_STATS_KEY,
+	JSMAPDEV_STATS_ABS,
+	JSMAPDEV_STATS_OTHER,
+	JSMAPDEV_STATS_EVENT_TYPES
+};
+
+/** Number of buckets in the filter latency histogram: bucket N counts times from 2^(N-1) to 2^N - 1 ns, bucket 0 
+ * counts 0 ns and the last one has no upper bound */
+#define 	JSMAPDEV_LATENCY_BUCKETS	32
+
+/** Latency histogram bucket of a time, in ns: its bit length, clamped to the last bucket */
+#define 	JSMAPDEV_LATENCY_BUCKET(ns)		min_t( int, fls64( ns ), JSMAPDEV_LATENCY_BUCKETS - 1 )
+
+/** Lowest time counted by a latency histogram bucket, in ns (inclusive) */
+#define 	JSMAPDEV_LATENCY_BUCKET_MIN(i)	( (i) ? 1ULL << ( (i) - 1 ) : 0ULL )
+
+/**
+ * @brief Event filter counters
+ *
+ * They're updated on every input event, so every CPU gets its own copy: the event filter never writes to a shared 
+ * cache line, nor needs atomic operations. They're summed up when read.
+ */
+
+struct jsmapdev_stats {
+	unsigned long			events[JSMAPDEV_STATS_EVENT_TYPES]; /* events received, by type */
+	unsigned long			filtered; /* events swallowed by the mapper, i.e. not passed to other handlers */
+	unsigned long			latency[JSMAPDEV_LATENCY_BUCKETS]; /* log2 histogram of time spent in the filter, in ns */
+	struct jsmapdev_core_stats	core; /* counters updated by the core (axis cache, allocations) */
+};
 
 
 /**
@@ -82,6 +172,10 @@ struct jsmapdev {
 #endif	
 	bool                    exist;
 	struct jsmapdev_core	* core;
+	struct jsmapper_evgen	* evgen; /* event generator the core sends its actions to */
+	struct jsmapdev_stats	__percpu * stats; /* event filter counters */
+	struct t_JSMAPPER_SHARED_STATE	* shared; /* shared state page, mmap()'ed by clients */
+	atomic_t				shared_maps; /* number of mappings of the shared state page */
 };
 
 
@@ -89,7 +183,7 @@ struct jsmapdev {
 	/**
 	 * Allocated devices by minor
 	 */
-	static struct jsmapdev 	* jsmapdev_table[JSMAPDEV_MINORS];
+	static struct jsmapdev 	* jsmapdev_table[JSMAPDEV_MINORS]; /* indexed by minor - JSMAPDEV_MINOR_BASE */
 	/**
 	 * Protects access to device table
 	 */
@@ -97,17 +191,35 @@ struct jsmapdev {
 #endif	
 
 
+/** Number of event records buffered per client (must be a power of 2) */
+#define 	JSMAPDEV_CLIENT_BUFFER		256
+
+/** Client flag: client is on the device's client list, receiving the event stream */
+#define 	JSMAPDEV_CLIENT_STREAMING	0
+
+
 /**
  * jsmapper device client struct
+ *
+ * Every client gets its own event stream, kept in a single-producer / single-consumer ring: records are only added 
+ * by the event filter (always under the device's event lock), and only removed by read() (serialized by read_mutex), 
+ * so neither side needs to lock the other out. Indexes are free-running, and wrap around the buffer size.
+ *
+ * Clients only join the device's client list, and so start receiving records, the first time they read, poll or 
+ * enable asynchronous notification: descriptors only used for ioctls cost nothing to the event filter.
  */
 
 struct jsmapdev_client {
-    int 			head;
-	int 			tail;
-	spinlock_t 		buffer_lock; /* protects access to buffer, head and tail */
+	unsigned long	flags; /* JSMAPDEV_CLIENT_xxx bits */
+	unsigned int 	head; /* next record to write, only written by the event filter */
+	unsigned int 	tail; /* next record to read, only written by read() */
+	unsigned int	dropped; /* records dropped since last overflow record, only touched by the event filter */
+	unsigned int	woken; /* head value when readers were last notified, only touched by the event filter */
+	struct mutex	read_mutex; /* serializes readers */
 	struct fasync_struct 	*fasync;
 	struct jsmapdev 	*jsdev;
 	struct list_head 	node;
+	struct t_JSMAPPER_EVENT	buffer[JSMAPDEV_CLIENT_BUFFER];
 };
 
 
@@ -138,6 +250,150 @@ static void jsmapdev_detach_client(struct jsmapdev *jsdev,
     synchronize_rcu();
 }
 
+/**
+ * Starts the event stream of a client, if not done yet, by attaching it to the device.
+ */
+static void jsmapdev_start_stream(struct jsmapdev_client *client)
+{
+	if (!test_and_set_bit(JSMAPDEV_CLIENT_STREAMING, &client->flags))
+		jsmapdev_attach_client(client->jsdev, client);
+}
+
+/**
+ * Adds a record to a client's event stream, or accounts for it as dropped if the stream is full. Once there's room 
+ * again, an overflow record telling how many records were lost goes first. Called from the event filter only.
+ */
+static void jsmapdev_client_push(struct jsmapdev_client *client, const struct t_JSMAPPER_EVENT *event)
+{
+	unsigned int head = client->head;
+	/* pairs with the release in read(), so the slots being reused have been copied already: */
+	unsigned int space = JSMAPDEV_CLIENT_BUFFER - (head - smp_load_acquire(&client->tail));
+	struct t_JSMAPPER_EVENT *overflow;
+
+	if (space < (client->dropped ? 2 : 1)) {
+		client->dropped++;
+		return;
+	}
+
+	if (client->dropped) {
+		overflow = &client->buffer[head++ & (JSMAPDEV_CLIENT_BUFFER - 1)];
+		memset(overflow, 0, sizeof(*overflow));
+		overflow->time = event->time;
+		overflow->type = JSMAPPER_EVENT_OVERFLOW;
+		overflow->value = client->dropped;
+		client->dropped = 0;
+	}
+
+	client->buffer[head++ & (JSMAPDEV_CLIENT_BUFFER - 1)] = *event;
+
+	/* pairs with the acquire in read() & poll(), so readers see the record before the new head: */
+	smp_store_release(&client->head, head);
+}
+
+/**
+ * Adds a record to the event stream of every client. Called from the event filter only.
+ */
+static void jsmapdev_push_event(struct jsmapdev *jsdev, struct t_JSMAPPER_EVENT *event)
+{
+	struct jsmapdev_client *client;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(client, &jsdev->client_list, node) {
+		if (event->time == 0)
+			event->time = jiffies_to_msecs(jiffies);
+		jsmapdev_client_push(client, event);
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * Adds a raw button / axis change to the event stream. Called from the event filter only.
+ */
+static void jsmapdev_stream_input(struct jsmapdev *jsdev, unsigned int type, unsigned int code, int value)
+{
+	struct t_JSMAPPER_EVENT event = { 0 };
+	int id;
+
+	if (type == EV_KEY) {
+		id = jsmapper_core_map_button(jsdev->core, code);
+		event.target = JSMAPPER_PROFILE_TARGET_BUTTON;
+	} else {
+		id = jsmapper_core_map_axis(jsdev->core, code);
+		event.target = JSMAPPER_PROFILE_TARGET_AXIS;
+	}
+	if (id < 0)
+		return;
+
+	event.type = JSMAPPER_EVENT_INPUT;
+	event.id = id;
+	event.value = value;
+	jsmapdev_push_event(jsdev, &event);
+}
+
+/**
+ * Refreshes the shared state page. Must be called under the device's event lock, which makes it the only writer.
+ */
+static void jsmapdev_update_shared(struct jsmapdev *jsdev)
+{
+	struct t_JSMAPPER_SHARED_STATE *shared = jsdev->shared;
+	u32 seq = shared->seq;
+
+	/* odd sequence tells readers an update is in progress, and they must retry: */
+	WRITE_ONCE(shared->seq, seq + 1);
+	smp_wmb();
+
+	shared->active_mode = jsmapper_core_fill_state(jsdev->core, &shared->state);
+	shared->profile_generation = jsdev->core->profile_generation;
+
+	smp_wmb();
+	WRITE_ONCE(shared->seq, seq + 2);
+}
+
+static void jsmapdev_wake_readers(struct jsmapdev *jsdev);
+
+/**
+ * Core listener: adds mode transitions & actions fired to the event stream.
+ *
+ * Profile switches can also come from ioctls (profile loading, bank selection), with no input frame following them 
+ * to wake readers up. They're always the last record of the switch, so readers are woken up right away.
+ */
+static void jsmapdev_core_event(void *data, struct t_JSMAPPER_EVENT *event)
+{
+	struct jsmapdev *jsdev = data;
+
+	if (event->type == JSMAPPER_EVENT_PROFILE && atomic_read(&jsdev->shared_maps))
+		jsmapdev_update_shared(jsdev);
+
+	jsmapdev_push_event(jsdev, event);
+
+	if (event->type == JSMAPPER_EVENT_PROFILE)
+		jsmapdev_wake_readers(jsdev);
+}
+
+/**
+ * Wakes up the readers of the clients that got new records since last time. Called under the device's event lock: 
+ * from the event filter once a whole input frame has been handled, so readers get woken up once per frame, and 
+ * after profile switches.
+ */
+static void jsmapdev_wake_readers(struct jsmapdev *jsdev)
+{
+	struct jsmapdev_client *client;
+	bool wake = false;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(client, &jsdev->client_list, node) {
+		if (client->woken != client->head) {
+			client->woken = client->head;
+			kill_fasync(&client->fasync, SIGIO, POLL_IN);
+			wake = true;
+		}
+	}
+	rcu_read_unlock();
+
+	if (wake)
+		wake_up_interruptible(&jsdev->wait);
+}
+
 static int jsmapdev_open_device(struct jsmapdev *jsdev)
 {
 	int retval;
@@ -192,7 +448,7 @@ static int jsmapdev_open(struct inode *inode, struct file *file)
 	jsdev = container_of(inode->i_cdev, struct jsmapdev, cdev);
 #else	
 	i = iminor(inode) - JSMAPDEV_MINOR_BASE;
-	if (i >= JSMAPDEV_MINORS)
+	if (i < 0 || i >= JSMAPDEV_MINORS)
 		return -ENODEV;
 
 	error = mutex_lock_interruptible(&jsmapdev_table_mutex);
@@ -213,9 +469,8 @@ static int jsmapdev_open(struct inode *inode, struct file *file)
 		goto err_put_jsdev;
 	}
 
-	spin_lock_init(&client->buffer_lock);
+	mutex_init(&client->read_mutex);
 	client->jsdev = jsdev;
-	jsmapdev_attach_client(jsdev, client);
 
 	error = jsmapdev_open_device(jsdev);
 	if (error)
@@ -227,7 +482,6 @@ static int jsmapdev_open(struct inode *inode, struct file *file)
 	return 0;
 
  err_free_client:
-	jsmapdev_detach_client(jsdev, client);
 	kfree(client);
  err_put_jsdev:
 	put_device(&jsdev->dev);
@@ -241,10 +495,10 @@ static int jsmapdev_release(struct inode *inode, struct file *file)
 
 	JSMAPPER_LOG_DEBUG("release()");
 	
-	jsmapdev_detach_client(jsdev, client);
-	kfree(client);
-
+	if (test_bit(JSMAPDEV_CLIENT_STREAMING, &client->flags))
+		jsmapdev_detach_client(jsdev, client);
 	jsmapdev_close_device(jsdev);
+	kfree(client);
 
 #ifndef USE_CDEV	
 	put_device(&jsdev->dev);
@@ -254,67 +508,149 @@ static int jsmapdev_release(struct inode *inode, struct file *file)
 }
 
 
-/*
-	IOCTL codes:
-*/
+static bool jsmapdev_client_empty(struct jsmapdev_client *client)
+{
+	return smp_load_acquire(&client->head) == client->tail;
+}
 
-static int _decode_api_action( struct t_JSMAPPER_ACTION * api_action, struct jsmapdev_core_action * core_action )
+static ssize_t jsmapdev_read(struct file *file, char __user *buffer, size_t count, loff_t *ppos)
 {
-    int ret = 0;
-    int i;
-    
-    core_action->type = api_action->type;
-    switch( core_action->type ) 
-    {
-    case JSMAPPER_ACTION_DEFAULT:
-    case JSMAPPER_ACTION_NONE:
-        break;
-
-    case JSMAPPER_ACTION_KEY:
-        core_action->key.id = api_action->data.key.id;
-        core_action->key.modifiers = api_action->data.key.modifiers;
-        core_action->key.single = api_action->data.key.single;
-        break;
-        
-    case JSMAPPER_ACTION_REL:
-        core_action->rel.id = api_action->data.rel.id;
-        core_action->rel.single = api_action->data.rel.single;
-        core_action->rel.step = api_action->data.rel.step;
-        core_action->rel.spacing = api_action->data.rel.spacing;
-        break;
-            
-    case JSMAPPER_ACTION_MACRO:
-        // TODO check parameter has the appropiate size for the key count passed!
-        core_action->macro.spacing = api_action->data.macro.spacing;
-        if( api_action->data.macro.count > 0 )  {
-            
-            size_t cb_keys = sizeof( core_action->macro.keys[0] ) * api_action->data.macro.count;
-            core_action->macro.keys = kmalloc( cb_keys, GFP_KERNEL );
-            if( core_action->macro.keys ) {
-                
-                for( i = 0; i < api_action->data.macro.count; i++ ) {
-                    core_action->macro.keys[i].id = api_action->data.macro.keys[i].id;
-                    core_action->macro.keys[i].modifiers = api_action->data.macro.keys[i].modifiers;
-                    core_action->macro.keys[i].single = api_action->data.macro.keys[i].single;
-                }
-                core_action->macro.count = api_action->data.macro.count;
-                
-            } else {
-                JSMAPPER_LOG_ERROR( "failed to allocate buffer for keys!" );
-                ret = -ENOMEM;
-            }
-        }
-        break;
-        
-    default:
-        JSMAPPER_LOG_ERROR( "invalid action type (%u)!", core_action->type );
-        ret = -EINVAL;
-        break;
-    }
-    
-    return ret;
+	struct jsmapdev_client *client = file->private_data;
+	struct jsmapdev *jsdev = client->jsdev;
+	size_t read = 0;
+	unsigned int head, tail;
+	int retval;
+
+	if (count < sizeof(struct t_JSMAPPER_EVENT))
+		return -EINVAL;
+
+	jsmapdev_start_stream(client);
+
+	retval = mutex_lock_interruptible(&client->read_mutex);
+	if (retval)
+		return retval;
+
+	while (jsmapdev_client_empty(client)) {
+		if (!jsdev->exist) {
+			retval = -ENODEV;
+			goto out;
+		}
+		if (file->f_flags & O_NONBLOCK) {
+			retval = -EAGAIN;
+			goto out;
+		}
+		retval = wait_event_interruptible(jsdev->wait, !jsmapdev_client_empty(client) || !jsdev->exist);
+		if (retval)
+			goto out;
+	}
+
+	head = smp_load_acquire(&client->head);
+	tail = client->tail;
+	while (tail != head && read + sizeof(struct t_JSMAPPER_EVENT) <= count) {
+		if (copy_to_user(buffer + read, &client->buffer[tail & (JSMAPDEV_CLIENT_BUFFER - 1)], 
+				sizeof(struct t_JSMAPPER_EVENT))) {
+			retval = -EFAULT;
+			break;
+		}
+		tail++;
+		read += sizeof(struct t_JSMAPPER_EVENT);
+	}
+
+	/* pairs with the acquire in the event filter: records are copied before their slots get reused */
+	smp_store_release(&client->tail, tail);
+
+ out:
+	mutex_unlock(&client->read_mutex);
+	return read ? read : retval;
+}
+
+static unsigned int jsmapdev_poll(struct file *file, poll_table *wait)
+{
+	struct jsmapdev_client *client = file->private_data;
+	struct jsmapdev *jsdev = client->jsdev;
+	unsigned int mask;
+
+	jsmapdev_start_stream(client);
+	poll_wait(file, &jsdev->wait, wait);
+
+	mask = jsdev->exist ? 0 : POLLHUP | POLLERR;
+	if (!jsmapdev_client_empty(client))
+		mask |= POLLIN | POLLRDNORM;
+
+	return mask;
+}
+
+static void jsmapdev_vm_open(struct vm_area_struct *vma)
+{
+	struct jsmapdev *jsdev = vma->vm_private_data;
+
+	atomic_inc(&jsdev->shared_maps);
+}
+
+static void jsmapdev_vm_close(struct vm_area_struct *vma)
+{
+	struct jsmapdev *jsdev = vma->vm_private_data;
+
+	atomic_dec(&jsdev->shared_maps);
 }
 
+static const struct vm_operations_struct jsmapdev_vm_ops = {
+	.open		= jsmapdev_vm_open,
+	.close		= jsmapdev_vm_close,
+};
+
+/**
+ * Maps the shared state page, read-only. The mapping keeps the file open, and so the device structure alive.
+ */
+static int jsmapdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct jsmapdev_client *client = file->private_data;
+	struct jsmapdev *jsdev = client->jsdev;
+	unsigned long flags;
+	int retval;
+
+	if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+	vm_flags_mod(vma, VM_DONTEXPAND, VM_MAYWRITE);
+#else
+	vma->vm_flags |= VM_DONTEXPAND;
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	retval = vm_insert_page(vma, vma->vm_start, virt_to_page(jsdev->shared));
+	if (retval)
+		return retval;
+
+	vma->vm_private_data = jsdev;
+	vma->vm_ops = &jsmapdev_vm_ops;
+	jsmapdev_vm_open(vma);
+
+	/* page is only kept up to date while mapped, so refresh it now: */
+	spin_lock_irqsave(&jsdev->handle.dev->event_lock, flags);
+	jsmapdev_update_shared(jsdev);
+	spin_unlock_irqrestore(&jsdev->handle.dev->event_lock, flags);
+
+	return 0;
+}
+
+static int jsmapdev_fasync(int fd, struct file *file, int on)
+{
+	struct jsmapdev_client *client = file->private_data;
+
+	if (on)
+		jsmapdev_start_stream(client);
+	return fasync_helper(fd, file, on, &client->fasync);
+}
+
+
+/*
+	IOCTL codes:
+*/
+
 static int _decode_api_button_action( void __user *argp, size_t argp_size, uint * button_id, uint * mode_id, struct jsmapdev_core_button_action * assign )
 {
 	int ret = 0;
@@ -332,7 +668,7 @@ static int _decode_api_button_action( void __user *argp, size_t argp_size, uint
             
             assign->filter = api_action->filter;
         
-            _decode_api_action( api_action, &assign->action );
+            ret = jsmapper_core_decode_action( api_action, argp_size, 1, &assign->action );
         
         } else {
             JSMAPPER_LOG_ERROR( "bad input buffer (error: %i)!", ret );
@@ -368,7 +704,7 @@ static int _decode_api_axis_action( void __user *argp, size_t argp_size, uint *
             assign->band_high = api_action->axis.high;
             assign->filter = api_action->filter;
             
-            _decode_api_action( api_action, &assign->action );
+            ret = jsmapper_core_decode_action( api_action, argp_size, 1, &assign->action );
         }
         else
             JSMAPPER_LOG_ERROR( "bad input buffer (error: %i)!", ret );
@@ -386,6 +722,45 @@ static int _decode_api_axis_action( void __user *argp, size_t argp_size, uint *
 }
 
 
+static int _load_api_profile( struct jsmapdev *jsdev, void __user *argp )
+{
+	struct t_JSMAPPER_PROFILE_LOAD	load_p;
+	void							* blob = NULL;
+	int								ret = 0;
+	
+	if( copy_from_user( &load_p, argp, sizeof( load_p ) ) )
+		return -EFAULT;
+	
+	/* reject blobs that can't even hold a header before allocating anything for them: */
+	if( load_p.size < sizeof( struct t_JSMAPPER_PROFILE_HEADER ) || load_p.size > JSMAPPER_PROFILE_MAX_SIZE ) {
+		JSMAPPER_LOG_ERROR( "Invalid profile blob size (%u)!", (uint) load_p.size );
+		return -EINVAL;
+	}
+	if( load_p.bank > JSMAPPER_BANK_COUNT ) {
+		JSMAPPER_LOG_ERROR( "Invalid bank number (%u)!", (uint) load_p.bank );
+		return -EINVAL;
+	}
+	
+	/* copy whole blob to kernel space in a single step: */
+	blob = vmalloc( load_p.size );
+	if( blob == NULL ) {
+		JSMAPPER_LOG_ERROR( "failed to allocate memory (%u bytes)!", (uint) load_p.size );
+		return -ENOMEM;
+	}
+	
+	if( copy_from_user( blob, (void __user *)(uintptr_t) load_p.data, load_p.size ) == 0 ) {
+		/* API banks are numbered from 1, JSMAPPER_BANK_ACTIVE (0) maps to core's active bank index (-1): */
+		ret = jsmapper_core_load_profile( jsdev->core, blob, load_p.size, (int) load_p.bank - 1 );
+	} else {
+		JSMAPPER_LOG_ERROR( "bad input buffer!" );
+		ret = -EFAULT;
+	}
+	
+	vfree( blob );
+	return ret;
+}
+
+
 static int jsmapdev_ioctl_common( struct jsmapdev *jsdev, unsigned int cmd, void __user *argp )
 {
 	struct input_dev 							*dev = jsdev->handle.dev;
@@ -396,6 +771,9 @@ static int jsmapdev_ioctl_common( struct jsmapdev *jsdev, unsigned int cmd, void
 	struct jsmapdev_core_button_action          btn_assign;
 	struct jsmapdev_core_axis_action            axis_assign;
 	struct t_JSMAPPER_MODE                      mode_p = {0};
+	struct jsmapdev_core_profile				* profile = NULL;
+	struct t_JSMAPPER_STATE						state;
+	struct t_JSMAPPER_BANKS						banks;
 	int											ret = 0;
 
 	
@@ -444,22 +822,54 @@ static int jsmapdev_ioctl_common( struct jsmapdev *jsdev, unsigned int cmd, void
             }
         }
 		return ret;
+		
+	case JMIOCGSTATE:
+		jsmapper_core_get_state( jsdev->core, &state );
+		return copy_to_user( argp, &state, sizeof( state ) ) ? -EFAULT : 0;
+		
+	case JMIOCGBANKS:
+		jsmapper_core_get_banks( jsdev->core, &banks );
+		return copy_to_user( argp, &banks, sizeof( banks ) ) ? -EFAULT : 0;
 
         
 	case JMIOCCLEAR:
-		jsmapper_core_clear( jsdev->core, 1 );
-		return 0;
+		return jsmapper_core_clear( jsdev->core );
 		
     case JMIOCADDMODE:
         ret = copy_from_user( &mode_p, argp, sizeof( mode_p ) );
         if( ret == 0 ) {
-            ret = jsmapper_core_add_mode( jsdev->core, &mode_p );
+            profile = jsmapper_core_get_staging( jsdev->core );
+            if( profile == NULL )
+                return -ENOMEM;
+            
+            ret = jsmapper_core_add_mode( profile, &mode_p );
             if( ret == 0 ) {
                 /* copy result back to user, so it can receive new mode ID: */
                 ret = copy_to_user( argp, &mode_p, sizeof( mode_p ));
             }
         }
         return ret;
+        
+    case JMIOCLOADPROFILE:
+        return _load_api_profile( jsdev, argp );
+        
+    case JMIOCCOMMIT:
+        return jsmapper_core_commit( jsdev->core );
+        
+	case JMIOCSBANK:
+		ret = get_user( value, (__s32 __user *) argp );
+		if( ret == 0 ) {
+			if( value < 1 || value > JSMAPPER_BANK_COUNT )
+				return -EINVAL;
+			ret = jsmapper_core_select_bank( jsdev->core, value - 1 );
+		}
+		return ret;
+		
+	case JMIOCSBANKBUTTON:
+		ret = get_user( value, (__s32 __user *) argp );
+		if( ret == 0 )
+			ret = jsmapper_core_set_bank_button( jsdev->core, value );
+		return ret;
 	}
 
 
@@ -475,7 +885,7 @@ static int jsmapdev_ioctl_common( struct jsmapdev *jsdev, unsigned int cmd, void
 		return copy_to_user(argp, name, len) ? -EFAULT : len;
 
 	case JMIOCGPROFILENAME( 0 ):
-		name = jsmapper_core_get_profile_name( jsdev->core );
+		name = jsmapper_core_get_profile_name( jsmapper_core_get_profile( jsdev->core ) );
 		if (!name)
 			return 0;
 
@@ -484,16 +894,25 @@ static int jsmapdev_ioctl_common( struct jsmapdev *jsdev, unsigned int cmd, void
 
 	case JMIOCSPROFILENAME( 0 ):
 		len = _IOC_SIZE( cmd );	// TODO check for negatives or too big values...
+		profile = jsmapper_core_get_staging( jsdev->core );
+		if( profile == NULL )
+			return -ENOMEM;
+		
 		name = kmalloc( len + 1, GFP_KERNEL );
 		if( name ) {
 			ret = copy_from_user( name, argp, len );
 			if( ret == 0 ) {
 				name[ len ] = '\0';
 				JSMAPPER_LOG_INFO( "set profile name: %s", name? name : "(null)" );
-				jsmapper_core_set_profile_name( jsdev->core, name );
+				ret = jsmapper_core_set_profile_name( profile, name );
+				if( ret == 0 ) {
+					/* setting the name is the last step of legacy profile programming: */
+					ret = jsmapper_core_commit( jsdev->core );
+				}
 			} else {
 				JSMAPPER_LOG_ERROR( "failed to copy dat from userspace (%u bytes)!", (uint) len );
 			}
+			kfree( name );
 		} else {
 			JSMAPPER_LOG_ERROR( "failed to allocate memory (%u bytes)!", (uint) len );
 			ret = -ENOMEM;
@@ -506,12 +925,14 @@ static int jsmapdev_ioctl_common( struct jsmapdev *jsdev, unsigned int cmd, void
             jsmapper_core_init_action( &btn_assign.action );
             ret = _decode_api_button_action( argp, len, &button_id, &mode_id, &btn_assign );
             if( ret == 0 ) {
-                ret = jsmapper_core_set_button_action( jsdev->core, button_id, mode_id, &btn_assign );
+                profile = jsmapper_core_get_staging( jsdev->core );
+                ret = profile ? jsmapper_core_set_button_action( profile, button_id, mode_id, &btn_assign ) : -ENOMEM;
             }
             jsmapper_core_clear_action( &btn_assign.action );
         
         } else {
             JSMAPPER_LOG_ERROR( "Invalid parameter size (%u)!", (uint) len );
+            ret = -EINVAL;
         }
         return ret;
         
@@ -521,12 +942,14 @@ static int jsmapdev_ioctl_common( struct jsmapdev *jsdev, unsigned int cmd, void
             jsmapper_core_init_action( &axis_assign.action );
             ret = _decode_api_axis_action( argp, _IOC_SIZE( cmd ), &axis_id, &mode_id, &axis_assign );
             if( ret == 0 ) {
-                ret = jsmapper_core_set_axis_action( jsdev->core, axis_id, mode_id, &axis_assign );
+                profile = jsmapper_core_get_staging( jsdev->core );
+                ret = profile ? jsmapper_core_set_axis_action( profile, axis_id, mode_id, &axis_assign ) : -ENOMEM;
             }
             jsmapper_core_clear_action( &axis_assign.action );
             
         } else {
             JSMAPPER_LOG_ERROR( "Invalid parameter size (%u)!", (uint) len );
+            ret = -EINVAL;
         }
         return ret;
 	}
@@ -593,6 +1016,10 @@ static const struct file_operations jsmapdev_fops = {
 	.owner		= THIS_MODULE,
 	.open		= jsmapdev_open,
 	.release	= jsmapdev_release,
+	.read		= jsmapdev_read,
+	.poll		= jsmapdev_poll,
+	.fasync		= jsmapdev_fasync,
+	.mmap		= jsmapdev_mmap,
 	.unlocked_ioctl	= jsmapdev_ioctl,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl	= jsmapdev_ioctl_compat,
@@ -621,7 +1048,7 @@ static int jsmapdev_install_chrdev(struct jsmapdev *jsdev)
 	 * No need to do any locking here as calls to connect and
 	 * disconnect are serialized by the input core
 	 */
-	jsmapdev_table[jsdev->minor] = jsdev;
+	jsmapdev_table[jsdev->minor - JSMAPDEV_MINOR_BASE] = jsdev;
 #endif	
 	
     return error;
@@ -636,7 +1063,7 @@ static void jsmapdev_remove_chrdev(struct jsmapdev *jsdev)
 	 * Lock evdev table to prevent race with jsmapdev_open()
 	 */
 	mutex_lock(&jsmapdev_table_mutex);
-	jsmapdev_table[jsdev->minor] = NULL;
+	jsmapdev_table[jsdev->minor - JSMAPDEV_MINOR_BASE] = NULL;
 	mutex_unlock(&jsmapdev_table_mutex);
 #endif	
 }
@@ -687,15 +1114,180 @@ static void jsmapdev_cleanup(struct jsmapdev *jsdev)
 }
 
 
+/*************************************************************************************************************
+ * 
+ * Statistics sysfs attributes (/sys/class/input/jsmapN/stats/)
+ * 
+ *************************************************************************************************************/
+
+/* event generator output: input frames resolved, syncs sent, and syncs that would be sent without batching */
+static ssize_t jsmapdev_show_output_stats(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapper_evgen_stats stats;
+	
+	jsmapper_evgen_get_stats( jsdev->evgen, &stats );
+	return sprintf( buf, "%lu %lu %lu\n", stats.frames, stats.syncs, stats.requested_syncs );
+}
+
+/* actions activated, by type: key, macro, rel & motion ones */
+static ssize_t jsmapdev_show_action_stats(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapper_evgen_stats stats;
+	
+	jsmapper_evgen_get_stats( jsdev->evgen, &stats );
+	return sprintf( buf, "%lu %lu %lu %lu\n", stats.actions[JSMAPPER_ACTION_KEY], stats.actions[JSMAPPER_ACTION_MACRO], 
+					stats.actions[JSMAPPER_ACTION_REL], stats.actions[JSMAPPER_ACTION_MOTION] );
+}
+
+/* deferred work: timer expirations sending relative axis steps & macro keys, and workqueue items */
+static ssize_t jsmapdev_show_deferred_stats(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapper_evgen_stats stats;
+	
+	jsmapper_evgen_get_stats( jsdev->evgen, &stats );
+	return sprintf( buf, "%lu %lu\n", stats.timer_events, stats.work_items );
+}
+
+/**
+ * Sums event filter counters of every CPU
+ */
+static void jsmapdev_get_stats(struct jsmapdev *jsdev, struct jsmapdev_stats *stats)
+{
+	struct jsmapdev_stats *cpu_stats;
+	int cpu, i;
+	
+	memset( stats, 0, sizeof(struct jsmapdev_stats) );
+	for_each_possible_cpu(cpu) {
+		cpu_stats = per_cpu_ptr( jsdev->stats, cpu );
+		for (i = 0; i < JSMAPDEV_STATS_EVENT_TYPES; i++)
+			stats->events[i] += cpu_stats->events[i];
+		stats->filtered += cpu_stats->filtered;
+		for (i = 0; i < JSMAPDEV_LATENCY_BUCKETS; i++)
+			stats->latency[i] += cpu_stats->latency[i];
+		stats->core.axis_cache_hits += cpu_stats->core.axis_cache_hits;
+		stats->core.axis_cache_misses += cpu_stats->core.axis_cache_misses;
+		stats->core.alloc_failures += cpu_stats->core.alloc_failures;
+	}
+}
+
+static ssize_t jsmapdev_show_axis_cache_hits(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapdev_stats stats;
+	
+	jsmapdev_get_stats( jsdev, &stats );
+	return sprintf( buf, "%lu\n", stats.core.axis_cache_hits );
+}
+
+static ssize_t jsmapdev_show_axis_cache_misses(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapdev_stats stats;
+	
+	jsmapdev_get_stats( jsdev, &stats );
+	return sprintf( buf, "%lu\n", stats.core.axis_cache_misses );
+}
+
+static ssize_t jsmapdev_show_alloc_failures(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapdev_stats stats;
+	
+	jsmapdev_get_stats( jsdev, &stats );
+	return sprintf( buf, "%lu\n", stats.core.alloc_failures );
+}
+
+/* events received by type (syn, key, abs & others), and how many of them got filtered */
+static ssize_t jsmapdev_show_event_stats(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapdev_stats stats;
+	
+	jsmapdev_get_stats( jsdev, &stats );
+	return sprintf( buf, "%lu %lu %lu %lu %lu\n", stats.events[JSMAPDEV_STATS_SYN], stats.events[JSMAPDEV_STATS_KEY], 
+					stats.events[JSMAPDEV_STATS_ABS], stats.events[JSMAPDEV_STATS_OTHER], stats.filtered );
+}
+
+/* filter latency histogram: one line per bucket, with its lower bound in ns (inclusive, each bucket extends up to 
+ * the next line's bound, the last one unbounded) and the number of events */
+static ssize_t jsmapdev_show_latency_stats(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	struct jsmapdev_stats stats;
+	ssize_t len = 0;
+	int i;
+	
+	jsmapdev_get_stats( jsdev, &stats );
+	for (i = 0; i < JSMAPDEV_LATENCY_BUCKETS; i++)
+		len += sprintf( buf + len, "%llu %lu\n", JSMAPDEV_LATENCY_BUCKET_MIN( i ), stats.latency[i] );
+	
+	return len;
+}
+
+/* writing anything resets every counter */
+static ssize_t jsmapdev_store_reset(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
+	int cpu;
+	
+	/* events being filtered right now may still update them, so the reset isn't atomic: */
+	for_each_possible_cpu(cpu)
+		memset( per_cpu_ptr( jsdev->stats, cpu ), 0, sizeof(struct jsmapdev_stats) );
+	jsmapper_evgen_reset_stats( jsdev->evgen );
+	
+	return count;
+}
+
+static DEVICE_ATTR(axis_cache_hits, S_IRUGO, jsmapdev_show_axis_cache_hits, NULL);
+static DEVICE_ATTR(axis_cache_misses, S_IRUGO, jsmapdev_show_axis_cache_misses, NULL);
+static DEVICE_ATTR(output, S_IRUGO, jsmapdev_show_output_stats, NULL);
+static DEVICE_ATTR(actions, S_IRUGO, jsmapdev_show_action_stats, NULL);
+static DEVICE_ATTR(deferred, S_IRUGO, jsmapdev_show_deferred_stats, NULL);
+static DEVICE_ATTR(alloc_failures, S_IRUGO, jsmapdev_show_alloc_failures, NULL);
+static DEVICE_ATTR(events, S_IRUGO, jsmapdev_show_event_stats, NULL);
+static DEVICE_ATTR(latency, S_IRUGO, jsmapdev_show_latency_stats, NULL);
+static DEVICE_ATTR(reset, S_IWUSR, NULL, jsmapdev_store_reset);
+
+static struct attribute * jsmapdev_stats_attrs[] = {
+	&dev_attr_axis_cache_hits.attr,
+	&dev_attr_axis_cache_misses.attr,
+	&dev_attr_output.attr,
+	&dev_attr_actions.attr,
+	&dev_attr_deferred.attr,
+	&dev_attr_alloc_failures.attr,
+	&dev_attr_events.attr,
+	&dev_attr_latency.attr,
+	&dev_attr_reset.attr,
+	NULL
+};
+
+static struct attribute_group jsmapdev_stats_group = {
+	.name = "stats",
+	.attrs = jsmapdev_stats_attrs,
+};
+
+static const struct attribute_group * jsmapdev_groups[] = {
+	&jsmapdev_stats_group,
+	NULL
+};
+
+
 static void jsmapdev_free(struct device *dev)
 {
 	struct jsmapdev *jsdev = container_of(dev, struct jsmapdev, dev);
 
 	JSMAPPER_LOG_DEBUG( "free");
 	
-	input_put_device(jsdev->handle.dev);
 	jsmapper_core_done( jsdev->core );
+	jsmapper_evgen_destroy( jsdev->evgen );
+	free_percpu( jsdev->stats );
+	free_page( (unsigned long) jsdev->shared );
 	
+	/* core & event generator may still use the input device until destroyed: drop it last */
+	input_put_device(jsdev->handle.dev);
 	kfree(jsdev);
 }
 
@@ -733,6 +1325,7 @@ static int jsmapdev_connect( struct input_handler *handler,
 		JSMAPPER_LOG_ERROR( "no more free jsmapdev devices");
 		return -ENFILE;
 	}
+	minor += JSMAPDEV_MINOR_BASE;
 #endif	
 
 	jsdev = kzalloc(sizeof(struct jsmapdev), GFP_KERNEL);
@@ -746,8 +1339,8 @@ static int jsmapdev_connect( struct input_handler *handler,
 	mutex_init(&jsdev->mutex);
 	init_waitqueue_head(&jsdev->wait);
 
+	/* Normalize device number if it falls into legacy range (dynamic minors are used as is) */
 	dev_no = minor;
-	/* Normalize device number if it falls into legacy range */
 	if (dev_no < JSMAPDEV_MINOR_BASE + JSMAPDEV_MINORS)
 		dev_no -= JSMAPDEV_MINOR_BASE;
 	dev_set_name(&jsdev->dev, "jsmap%d", dev_no);
@@ -765,14 +1358,36 @@ static int jsmapdev_connect( struct input_handler *handler,
 	jsdev->dev.class = &input_class;
 	jsdev->dev.parent = &dev->dev;
 	jsdev->dev.release = jsmapdev_free;
+	jsdev->dev.groups = jsmapdev_groups;
 	device_initialize(&jsdev->dev);
 	
-	/* initialize core struct: */
-	jsdev->core = jsmapper_core_init( dev );
+	jsdev->stats = alloc_percpu( struct jsmapdev_stats );
+	if( !jsdev->stats ) {
+		error = -ENOMEM;
+		goto err_free_jsmapdev;
+	}
+	
+	jsdev->shared = (struct t_JSMAPPER_SHARED_STATE *) get_zeroed_page( GFP_KERNEL );
+	if( !jsdev->shared ) {
+		error = -ENOMEM;
+		goto err_free_jsmapdev;
+	}
+	jsdev->shared->size = sizeof( struct t_JSMAPPER_SHARED_STATE );
+	
+	/* create the event generator, and initialize core struct: */
+	jsdev->evgen = jsmapper_evgen_create( dev_name( &jsdev->dev ) );
+	if( !jsdev->evgen ) {
+		error = -ENOMEM;
+		goto err_free_jsmapdev;
+	}
+	
+	jsdev->core = jsmapper_core_init( dev, jsdev->evgen );
 	if( !jsdev->core ) {
 		error = -ENOMEM;
 		goto err_free_jsmapdev;
 	}
+	jsmapper_core_set_listener( jsdev->core, jsmapdev_core_event, jsdev );
+	jsmapper_core_set_stats( jsdev->core, &jsdev->stats->core );
 
 	error = input_register_handle( &jsdev->handle );
 	if (error) {
@@ -851,7 +1466,7 @@ static bool jsmapdev_match(struct input_handler *handler, struct input_dev *dev)
 {
 	JSMAPPER_LOG_DEBUG( "match( name='%s', vendorID=%i, productID=%i)", dev->name, (int) dev->id.vendor, (int) dev->id.product );
 
-	if( dev == jsmapper_evgen_device() ) {
+	if( jsmapper_evgen_is_device( dev ) ) {
 		JSMAPPER_LOG_DEBUG( "No match (0)" );
 		return false;
 	}
@@ -875,63 +1490,38 @@ static bool jsmapdev_match(struct input_handler *handler, struct input_dev *dev)
 
 static bool jsmapdev_filter( struct input_handle *handle, unsigned int type, unsigned int code, int value )
 {
-	bool                                    filter = false;
-	struct jsmapdev                         * jsdev = handle->private;
-    int										button_id = -1;
-    struct jsmapdev_core_button_action      * button_assign = NULL;
-    int										axis_id = -1;
-    struct jsmapdev_core_axis_action		* axis_assign = NULL;
-    struct jsmapdev_core_axis_action		* cur_axis_assign = NULL;
-    
-    switch( type )	{
-    case EV_KEY:
-        button_id = jsmapper_core_map_button( jsdev->core, code );
-        if( button_id >= 0 ) {
-            // JSMAPPER_LOG_DEBUG("filter( button ID=%u, value=%i )", button_id, value );
-            
-            button_assign = jsmapper_core_find_button_action( jsdev->core, jsdev->core->root_mode, button_id );
-            if( button_assign ) {
-                jsmapper_evgen_send_action( &button_assign->action, value );
-                filter = button_assign->filter;
-            }
-        }
-        else
-            JSMAPPER_LOG_WARNING( "unknown key code: 0x%x!", (uint) code );
-        break;
-        
-    case EV_ABS:
-        axis_id = jsmapper_core_map_axis( jsdev->core, code );
-        if( axis_id >= 0 ) {
-            // JSMAPPER_LOG_DEBUG( "filter( axis ID=%u, value=%i )", axis_id, value );
-
-            cur_axis_assign = jsdev->core->current_axis_action[ axis_id ];
-            axis_assign = jsmapper_core_find_axis_action( jsdev->core, jsdev->core->root_mode, axis_id, value );
-            if( axis_assign != cur_axis_assign ) {
-                
-                if( cur_axis_assign ) {
-                    JSMAPPER_LOG_DEBUG( "Deactivating old action for axis ID=%u", axis_id );
-                    jsmapper_evgen_send_action( &cur_axis_assign->action, 0 );
-                    if( cur_axis_assign->filter )
-                        filter = true;
-                }
-            
-                jsdev->core->current_axis_action[ axis_id ] = axis_assign;
-                        
-                if( axis_assign ) {
-                    JSMAPPER_LOG_DEBUG( "Activating new action for axis ID=%u", axis_id );
-                    jsmapper_evgen_send_action( &axis_assign->action, 1 );
-                    if( axis_assign->filter )
-                        filter = true;
-                }
-            }
-        }
-        else
-            JSMAPPER_LOG_WARNING( "unknown axis code: 0x%x!", (uint) code );
-        break;
-        
-    default:
-        break;
-    }
+	struct jsmapdev * jsdev = handle->private;
+	u64 start = local_clock();
+	bool filter = false;
+	u64 elapsed = 0;
+	
+	trace_jsmapper_event( handle->dev, type, code, value );
+	
+	/* raw changes go to the event stream first, so they precede the mode transitions & actions they cause: */
+	if( !list_empty( &jsdev->client_list ) && ( type == EV_KEY || type == EV_ABS ) )
+		jsmapdev_stream_input( jsdev, type, code, value );
+	
+	filter = jsmapper_core_filter( jsdev->core, type, code, value );
+	
+	if( type == EV_SYN && code == SYN_REPORT ) {
+		if( atomic_read( &jsdev->shared_maps ) )
+			jsmapdev_update_shared( jsdev );
+		jsmapdev_wake_readers( jsdev );
+	}
+	
+	/* whole time spent in the filter, event stream & shared state included (only the counters are left out): */
+	elapsed = local_clock() - start;
+	
+	/* called with interrupts disabled (under device's event lock), so no need for the irq-safe per-CPU ops: */
+	switch( type ) {
+	case EV_SYN:	__this_cpu_inc( jsdev->stats->events[JSMAPDEV_STATS_SYN] ); break;
+	case EV_KEY:	__this_cpu_inc( jsdev->stats->events[JSMAPDEV_STATS_KEY] ); break;
+	case EV_ABS:	__this_cpu_inc( jsdev->stats->events[JSMAPDEV_STATS_ABS] ); break;
+	default:		__this_cpu_inc( jsdev->stats->events[JSMAPDEV_STATS_OTHER] ); break;
+	}
+	if( filter )
+		__this_cpu_inc( jsdev->stats->filtered );
+	__this_cpu_inc( jsdev->stats->latency[ JSMAPDEV_LATENCY_BUCKET( elapsed ) ] );
 	
 	return filter;
 }
@@ -1019,19 +1609,20 @@ static int __init jsmapdev_init(void)
 	
 	JSMAPPER_LOG_INFO("init()");
 
-	/* register our input handler: */
-	ret = input_register_handler( &jsmapdev_handler );
+	/* initialize event generator, used as soon as devices get connected: */
+	ret = jsmapper_evgen_init();
 	if( ret )
 	{
-		JSMAPPER_LOG_ERROR( "failed to register input handler!" );
+		JSMAPPER_LOG_ERROR( "failed to initialize event generator!" );
 		return ret;
 	}
 	
-	/* initialize event generator: */
-	ret = jsmapper_evgen_init();
+	/* register our input handler: */
+	ret = input_register_handler( &jsmapdev_handler );
 	if( ret )
 	{
-		JSMAPPER_LOG_ERROR( "failed to create virtual event generator!" );
+		JSMAPPER_LOG_ERROR( "failed to register input handler!" );
+		jsmapper_evgen_done();
 		return ret;
 	}
 	
@@ -1042,8 +1633,9 @@ static void __exit jsmapdev_exit(void)
 {
 	JSMAPPER_LOG_INFO("exit()");
 
-	jsmapper_evgen_done();
+	/* disconnects every device, then waits for their event generators to be gone: */
 	input_unregister_handler( &jsmapdev_handler );
+	jsmapper_evgen_done();
 }
 
 module_init(jsmapdev_init);
@@ -0,0 +1,268 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This file is part of JSMapper kernel module.
+ *
+ * JSMapper is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with JSMapper.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file jsmapper_trace.h
+ * \brief JSMapper kernel module tracepoints
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ *
+ * Events are grouped under the 'jsmapper' system (/sys/kernel/tracing/events/jsmapper/), covering the whole path
+ * from the joystick event to the events generated for it: input event received, mode changes, actions resolved,
+ * actions dispatched to the event generator, and macro / relative axis emitters. Disabled tracepoints are just a
+ * static branch, so they can be left in production builds.
+ *
+ * Every event carries the name of the input device it refers to: the joystick one ("inputN") for input side events,
+ * the event generator output device for the generated ones.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM jsmapper
+
+#if !defined(__JSMAPPER_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define __JSMAPPER_TRACE_H_
+
+#include <linux/tracepoint.h>
+#include <linux/input.h>
+#include <linux/string.h>
+
+#include "jsmapper_api.h"
+
+/** Size of the device name field of every event */
+#define JSMAPPER_TRACE_DEV_SIZE		16
+
+
+/**
+ * \brief Input event received by the event filter, before anything else is done with it
+ */
+
+TRACE_EVENT( jsmapper_event,
+	TP_PROTO( struct input_dev * dev, unsigned int type, unsigned int code, int value ),
+	TP_ARGS( dev, type, code, value ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( unsigned int, type )
+		__field( unsigned int, code )
+		__field( int, value )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->type = type;
+		__entry->code = code;
+		__entry->value = value;
+	),
+	TP_printk( "dev=%s type=%u code=%u value=%d", __entry->dev, __entry->type, __entry->code, __entry->value )
+);
+
+
+/**
+ * \brief Mode activated or deactivated
+ */
+
+TRACE_EVENT( jsmapper_mode,
+	TP_PROTO( struct input_dev * dev, unsigned int mode_id, int active ),
+	TP_ARGS( dev, mode_id, active ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( unsigned int, mode_id )
+		__field( int, active )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->mode_id = mode_id;
+		__entry->active = active;
+	),
+	TP_printk( "dev=%s mode=%u active=%d", __entry->dev, __entry->mode_id, __entry->active )
+);
+
+
+/**
+ * \brief Action resolved for a button or an axis, once the input frame is complete
+ */
+
+TRACE_EVENT( jsmapper_action,
+	TP_PROTO( struct input_dev * dev, unsigned int target, unsigned int id, int value, int action, int press ),
+	TP_ARGS( dev, target, id, value, action, press ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( unsigned int, target )
+		__field( unsigned int, id )
+		__field( int, value )
+		__field( int, action )
+		__field( int, press )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->target = target;
+		__entry->id = id;
+		__entry->value = value;
+		__entry->action = action;
+		__entry->press = press;
+	),
+	TP_printk( "dev=%s %s=%u value=%d action=%d press=%d", __entry->dev,
+			   __entry->target == JSMAPPER_PROFILE_TARGET_AXIS ? "axis" : "button", __entry->id, __entry->value,
+			   __entry->action, __entry->press )
+);
+
+
+/**
+ * \brief Action received by the event generator
+ */
+
+TRACE_EVENT( jsmapper_send_action,
+	TP_PROTO( struct input_dev * dev, int action, int press ),
+	TP_ARGS( dev, action, press ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( int, action )
+		__field( int, press )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->action = action;
+		__entry->press = press;
+	),
+	TP_printk( "dev=%s action=%d press=%d", __entry->dev, __entry->action, __entry->press )
+);
+
+
+/**
+ * \brief Macro run state: queued (activated), started (first timer expiration), finished
+ */
+
+DECLARE_EVENT_CLASS( jsmapper_macro,
+	TP_PROTO( struct input_dev * dev, const void * run, unsigned int pos, unsigned int count, unsigned int queued ),
+	TP_ARGS( dev, run, pos, count, queued ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( const void *, run )
+		__field( unsigned int, pos )
+		__field( unsigned int, count )
+		__field( unsigned int, queued )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->run = run;
+		__entry->pos = pos;
+		__entry->count = count;
+		__entry->queued = queued;
+	),
+	TP_printk( "dev=%s run=%p pos=%u count=%u queued=%u", __entry->dev, __entry->run, __entry->pos,
+			   __entry->count, __entry->queued )
+);
+
+DEFINE_EVENT( jsmapper_macro, jsmapper_macro_queued,
+	TP_PROTO( struct input_dev * dev, const void * run, unsigned int pos, unsigned int count, unsigned int queued ),
+	TP_ARGS( dev, run, pos, count, queued )
+);
+
+DEFINE_EVENT( jsmapper_macro, jsmapper_macro_started,
+	TP_PROTO( struct input_dev * dev, const void * run, unsigned int pos, unsigned int count, unsigned int queued ),
+	TP_ARGS( dev, run, pos, count, queued )
+);
+
+DEFINE_EVENT( jsmapper_macro, jsmapper_macro_finished,
+	TP_PROTO( struct input_dev * dev, const void * run, unsigned int pos, unsigned int count, unsigned int queued ),
+	TP_ARGS( dev, run, pos, count, queued )
+);
+
+
+/**
+ * \brief Macro key sent
+ */
+
+TRACE_EVENT( jsmapper_macro_key,
+	TP_PROTO( struct input_dev * dev, const void * run, unsigned int key, unsigned int modifiers ),
+	TP_ARGS( dev, run, key, modifiers ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( const void *, run )
+		__field( unsigned int, key )
+		__field( unsigned int, modifiers )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->run = run;
+		__entry->key = key;
+		__entry->modifiers = modifiers;
+	),
+	TP_printk( "dev=%s run=%p key=%u modifiers=0x%x", __entry->dev, __entry->run, __entry->key, __entry->modifiers )
+);
+
+
+/**
+ * \brief Relative axis emitter started / stopped
+ */
+
+DECLARE_EVENT_CLASS( jsmapper_rel,
+	TP_PROTO( struct input_dev * dev, unsigned int id, int step, s64 spacing_ns ),
+	TP_ARGS( dev, id, step, spacing_ns ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( unsigned int, id )
+		__field( int, step )
+		__field( s64, spacing_ns )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->id = id;
+		__entry->step = step;
+		__entry->spacing_ns = spacing_ns;
+	),
+	TP_printk( "dev=%s rel=%u step=%d spacing=%lldns", __entry->dev, __entry->id, __entry->step, __entry->spacing_ns )
+);
+
+DEFINE_EVENT( jsmapper_rel, jsmapper_rel_started,
+	TP_PROTO( struct input_dev * dev, unsigned int id, int step, s64 spacing_ns ),
+	TP_ARGS( dev, id, step, spacing_ns )
+);
+
+DEFINE_EVENT( jsmapper_rel, jsmapper_rel_stopped,
+	TP_PROTO( struct input_dev * dev, unsigned int id, int step, s64 spacing_ns ),
+	TP_ARGS( dev, id, step, spacing_ns )
+);
+
+
+/**
+ * \brief Relative axis step sent
+ */
+
+TRACE_EVENT( jsmapper_rel_emitted,
+	TP_PROTO( struct input_dev * dev, unsigned int id, int value ),
+	TP_ARGS( dev, id, value ),
+	TP_STRUCT__entry(
+		__array( char, dev, JSMAPPER_TRACE_DEV_SIZE )
+		__field( unsigned int, id )
+		__field( int, value )
+	),
+	TP_fast_assign(
+		strscpy( __entry->dev, dev_name( &dev->dev ), JSMAPPER_TRACE_DEV_SIZE );
+		__entry->id = id;
+		__entry->value = value;
+	),
+	TP_printk( "dev=%s rel=%u value=%d", __entry->dev, __entry->id, __entry->value )
+);
+
+
+#endif // __JSMAPPER_TRACE_H_
+
+
+/* this part must be outside the header guard: */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE jsmapper_trace
+
+#include <trace/define_trace.h>
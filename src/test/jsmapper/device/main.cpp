@@ -0,0 +1,102 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file main.cpp
+ * \brief Unit test for jsmapper library's Device class
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <gtest/gtest.h>
+
+#include <jsmapper/device.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace jsmapper;
+
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+
+TEST( Device, Paths )
+{
+	EXPECT_EQ( Device::getPath( 0 ), "/dev/input/jsmap0" );
+	EXPECT_EQ( Device::getPath( 300 ), "/dev/input/jsmap300" );
+
+	EXPECT_EQ( Device::getId( "/dev/input/jsmap0" ), 0 );
+	EXPECT_EQ( Device::getId( "/dev/input/jsmap31" ), 31 );
+	EXPECT_EQ( Device::getId( "jsmap300" ), 300 );
+	EXPECT_EQ( Device::getId( "/dev/input/jsmap" ), -1 );
+	EXPECT_EQ( Device::getId( "/dev/input/jsmapx" ), -1 );
+	EXPECT_EQ( Device::getId( "/dev/input/jsmap1.bak" ), -1 );
+	EXPECT_EQ( Device::getId( "/dev/input/event3" ), -1 );
+}
+
+
+TEST( Device, Enumerate )
+{
+	char dir[] = "/tmp/jsmapper-test-device-XXXXXX";
+	ASSERT_TRUE( mkdtemp( dir ) != NULL );
+	std::string base = dir;
+
+	// character devices only (symlinks to /dev/null stand for them), IDs are not contiguous:
+	EXPECT_EQ( symlink( "/dev/null", ( base + "/jsmap300" ).c_str() ), 0 );
+	EXPECT_EQ( symlink( "/dev/null", ( base + "/jsmap17" ).c_str() ), 0 );
+	EXPECT_EQ( symlink( "/dev/null", ( base + "/jsmap0" ).c_str() ), 0 );
+	EXPECT_EQ( symlink( "/dev/null", ( base + "/event1" ).c_str() ), 0 );
+	int fd = open( ( base + "/jsmap5" ).c_str(), O_CREAT | O_WRONLY, 0600 );
+	EXPECT_GE( fd, 0 );
+	close( fd );
+
+	std::vector<int> ids = Device::enumerate( base );
+	ASSERT_EQ( ids.size(), 3 );
+	EXPECT_EQ( ids[0], 0 );
+	EXPECT_EQ( ids[1], 17 );
+	EXPECT_EQ( ids[2], 300 );
+
+	const char * names[] = { "jsmap300", "jsmap17", "jsmap0", "event1", "jsmap5" };
+	for( size_t i = 0; i < sizeof( names ) / sizeof( names[0] ); i++ )
+		unlink( ( base + "/" + names[i] ).c_str() );
+	rmdir( dir );
+
+	EXPECT_TRUE( Device::enumerate( base ).empty() );
+}
+
+
+TEST( Device, EventsNotOpen )
+{
+	Device dev( 300 );
+	EXPECT_EQ( dev.getFd(), -1 );
+
+	std::vector<Event> events;
+	EXPECT_LT( dev.readEvents( events, 0 ), 0 );
+	EXPECT_TRUE( events.empty() );
+}
+
+TEST( Device, BanksNotOpen )
+{
+	Device dev( 300 );
+	EXPECT_FALSE( dev.selectBank( 2 ) );
+	EXPECT_EQ( dev.getActiveBank(), 0u );
+	EXPECT_TRUE( dev.getLoadedBanks().empty() );
+	EXPECT_FALSE( dev.setBankButton( 3 ) );
+	EXPECT_EQ( dev.getBankButton(), -1 );
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file main.cpp
+ * \brief Unit test for jsmapper library's DeviceState class
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <jsmapper/devicestate.h>
+
+using namespace jsmapper;
+
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+
+TEST( DeviceState, Empty )
+{
+	DeviceState state;
+	EXPECT_EQ( state.getSequence(), 0 );
+	EXPECT_EQ( state.getNumButtons(), 0 );
+	EXPECT_EQ( state.getNumAxes(), 0 );
+	EXPECT_EQ( state.getButtonValue( 0 ), 0 );
+	EXPECT_EQ( state.getAxisValue( 0 ), 0 );
+	EXPECT_FALSE( state.isModeActive( 0 ) );
+	EXPECT_TRUE( state.getActiveModes().empty() );
+}
+
+
+TEST( DeviceState, Values )
+{
+	DeviceState state;
+	struct t_JSMAPPER_STATE * data = state.getData();
+	data->sequence = 42;
+	data->button_count = 40;
+	data->axis_count = 3;
+	data->mode_count = 40;
+	data->buttons[0] = 0x00000005;
+	data->buttons[1] = 0x00000080;
+	data->axes[1] = -100;
+	data->axes[2] = 255;
+	data->axes[3] = 7;					// beyond axis count
+	data->modes[0] = 0x80000001;
+	data->modes[1] = 0x00000104;		// 40 is beyond mode count
+
+	EXPECT_EQ( state.getSequence(), 42 );
+	EXPECT_EQ( state.getNumButtons(), 40 );
+	EXPECT_EQ( state.getButtonValue( 0 ), 1 );
+	EXPECT_EQ( state.getButtonValue( 1 ), 0 );
+	EXPECT_EQ( state.getButtonValue( 2 ), 1 );
+	EXPECT_EQ( state.getButtonValue( 39 ), 1 );
+	EXPECT_EQ( state.getButtonValue( 40 ), 0 );
+
+	EXPECT_EQ( state.getNumAxes(), 3 );
+	EXPECT_EQ( state.getAxisValue( 0 ), 0 );
+	EXPECT_EQ( state.getAxisValue( 1 ), -100 );
+	EXPECT_EQ( state.getAxisValue( 2 ), 255 );
+	EXPECT_EQ( state.getAxisValue( 3 ), 0 );
+
+	EXPECT_EQ( state.getNumModes(), 40 );
+	EXPECT_TRUE( state.isModeActive( 0 ) );
+	EXPECT_FALSE( state.isModeActive( 1 ) );
+	EXPECT_TRUE( state.isModeActive( 31 ) );
+	EXPECT_TRUE( state.isModeActive( 34 ) );
+	EXPECT_FALSE( state.isModeActive( 40 ) );
+
+	std::vector<unsigned int> modes = state.getActiveModes();
+	ASSERT_EQ( modes.size(), 3 );
+	EXPECT_EQ( modes[0], 0 );
+	EXPECT_EQ( modes[1], 31 );
+	EXPECT_EQ( modes[2], 34 );
+}
@@ -50,6 +50,11 @@ TEST( MacroAction, Basic )
         action->setSpacing( MACRO_SPACING );
         EXPECT_EQ( action->getSpacing(), MACRO_SPACING );
         
+        // change re-trigger policy:
+        EXPECT_EQ( action->getPolicy(), MacroAction::DefaultPolicy );
+        action->setPolicy( MacroAction::Cancel );
+        EXPECT_EQ( action->getPolicy(), MacroAction::Cancel );
+        
         // add keys:
         EXPECT_EQ( action->getKeys().size(), 0 );
         action->addKey( KEY_1 );
@@ -81,6 +86,7 @@ TEST( MacroAction, Serialization )
     action->addKey( KEY_1 );
     action->addKey( KEY_2, JSMAPPER_MODIFIER_CTRL | JSMAPPER_MODIFIER_SHIFT );
     action->addKey( KEY_3 );
+    action->setPolicy( MacroAction::Restart );
     
 
         xmlNodePtr node = action->toXml();    
@@ -106,9 +112,40 @@ TEST( MacroAction, Serialization )
             }
             
             EXPECT_EQ( action->getSpacing(), actionNew->getSpacing() );
+            EXPECT_EQ( action->getPolicy(), actionNew->getPolicy() );
         
         delete actionNew;
         xmlFreeNode( node );
         
     delete action;
 }
+
+TEST( MacroAction, Device )
+{
+    MacroAction * action = new MacroAction( ACTION_NAME );
+    action->addKey( KEY_1 );
+    action->addKey( KEY_2, JSMAPPER_MODIFIER_CTRL );
+    action->setSpacing( MACRO_SPACING );
+    action->setPolicy( MacroAction::Ignore );
+    
+        size_t cbBuf = 0;
+        struct t_JSMAPPER_ACTION * pBuf = action->toDeviceAction( cbBuf );
+        
+            ASSERT_TRUE( pBuf != NULL );
+            EXPECT_GE( cbBuf, offsetof( struct t_JSMAPPER_ACTION, data.macro.keys ) + 2 * sizeof( struct t_JSMAPPER_KEY ) );
+            EXPECT_EQ( pBuf->type, JSMAPPER_ACTION_MACRO );
+            EXPECT_EQ( pBuf->data.macro.spacing, MACRO_SPACING );
+            EXPECT_EQ( pBuf->data.macro.count, 2 );
+            EXPECT_EQ( pBuf->data.macro.keys[1].id, KEY_2 );
+            EXPECT_EQ( pBuf->data.macro.keys[1].modifiers, JSMAPPER_MODIFIER_CTRL );
+            
+            // options follow the key array, inside the buffer:
+            EXPECT_GE( cbBuf, offsetof( struct t_JSMAPPER_ACTION, data.macro.keys ) + 2 * sizeof( struct t_JSMAPPER_KEY ) 
+                              + sizeof( struct t_JSMAPPER_MACRO_OPTIONS ) );
+            struct t_JSMAPPER_MACRO_OPTIONS * options = (struct t_JSMAPPER_MACRO_OPTIONS *) &pBuf->data.macro.keys[2];
+            EXPECT_EQ( options->policy, JSMAPPER_MACRO_IGNORE );
+        
+        free( pBuf );
+    
+    delete action;
+}
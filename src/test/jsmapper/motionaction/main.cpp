@@ -0,0 +1,186 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file main.cpp
+ * \brief Unit test for jsmapper library's MotionAction class
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <gtest/gtest.h>
+
+#include <jsmapper/motionaction.h>
+
+using namespace jsmapper;
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+static const char * ACTION_NAME     = "Test";
+static const char * ACTION_DESC     = "A motion test action";
+static bool         ACTION_FILTER   = false;
+
+static uint             MOTION_AXIS         = REL_Y;
+static int              MOTION_CENTER       = 512;
+static int              MOTION_DEADZONE     = 32;
+static int              MOTION_RANGE        = 511;
+static int              MOTION_MAXSTEP      = -8;
+static uint             MOTION_CURVE        = 50;
+static uint             MOTION_SPACING      = 5;
+
+
+TEST( MotionAction, Basic )
+{
+    // check ctor parameters get passed correctly
+    MotionAction * action = new MotionAction( ACTION_NAME, 
+                                                MOTION_AXIS, MOTION_MAXSTEP, 
+                                                MOTION_SPACING, 
+                                                ACTION_FILTER, 
+                                                ACTION_DESC );
+    
+        EXPECT_STREQ( action->getName().c_str(), ACTION_NAME );
+        EXPECT_EQ( action->filter(), ACTION_FILTER );
+        EXPECT_STREQ( action->getDescription().c_str(), ACTION_DESC );
+        EXPECT_EQ( action->getType(), MotionActionType );
+        
+        EXPECT_EQ( action->getAxis(), MOTION_AXIS );
+        EXPECT_EQ( action->getMaxStep(), MOTION_MAXSTEP );
+        EXPECT_EQ( action->getSpacing(), MOTION_SPACING );
+    
+    delete action;
+}
+
+
+TEST( MotionAction, SetParams )
+{
+    MotionAction * action = new MotionAction( ACTION_NAME );
+    
+        // check default values:
+        EXPECT_EQ( action->getAxis(), MotionAction::DefaultAxis );
+        EXPECT_EQ( action->getCenter(), MotionAction::DefaultCenter );
+        EXPECT_EQ( action->getDeadzone(), MotionAction::DefaultDeadzone );
+        EXPECT_EQ( action->getRange(), MotionAction::DefaultRange );
+        EXPECT_EQ( action->getMaxStep(), MotionAction::DefaultMaxStep );
+        EXPECT_EQ( action->getCurve(), MotionAction::DefaultCurve );
+        EXPECT_EQ( action->getSpacing(), MotionAction::DefaultSpacing );
+        
+        action->setAxis( MOTION_AXIS );
+        EXPECT_EQ( action->getAxis(), MOTION_AXIS );
+        
+        action->setCenter( MOTION_CENTER );
+        EXPECT_EQ( action->getCenter(), MOTION_CENTER );
+        
+        action->setDeadzone( MOTION_DEADZONE );
+        EXPECT_EQ( action->getDeadzone(), MOTION_DEADZONE );
+        
+        action->setRange( MOTION_RANGE );
+        EXPECT_EQ( action->getRange(), MOTION_RANGE );
+        
+        action->setMaxStep( MOTION_MAXSTEP );
+        EXPECT_EQ( action->getMaxStep(), MOTION_MAXSTEP );
+        
+        action->setCurve( MOTION_CURVE );
+        EXPECT_EQ( action->getCurve(), MOTION_CURVE );
+        
+        // curve is capped to 100%
+        action->setCurve( 250 );
+        EXPECT_EQ( action->getCurve(), 100 );
+        
+        action->setSpacing( MOTION_SPACING );
+        EXPECT_EQ( action->getSpacing(), MOTION_SPACING );
+    
+    delete action;
+}
+
+
+TEST( MotionAction, Device )
+{
+    MotionAction * action = new MotionAction( ACTION_NAME );
+        
+        action->setFilter( false );
+        action->setAxis( MOTION_AXIS );
+        action->setCenter( MOTION_CENTER );
+        action->setDeadzone( MOTION_DEADZONE );
+        action->setRange( MOTION_RANGE );
+        action->setMaxStep( MOTION_MAXSTEP );
+        action->setCurve( MOTION_CURVE );
+        action->setSpacing( MOTION_SPACING );
+        
+        size_t cbBuf = 0;
+        struct t_JSMAPPER_ACTION * pBuf = action->toDeviceAction( cbBuf );
+        
+            ASSERT_TRUE( pBuf != NULL );
+            EXPECT_EQ( sizeof( struct t_JSMAPPER_ACTION ), 28u );      // legacy ioctls ABI, must never change
+            EXPECT_EQ( cbBuf, sizeof( struct t_JSMAPPER_ACTION ) + sizeof( struct t_JSMAPPER_MOTION ) );
+            EXPECT_EQ( pBuf->type, JSMAPPER_ACTION_MOTION );
+            EXPECT_EQ( pBuf->filter, ACTION_FILTER );
+            
+            // parameters follow the action struct:
+            struct t_JSMAPPER_MOTION * motion = (struct t_JSMAPPER_MOTION *) ( pBuf + 1 );
+            EXPECT_EQ( motion->id, MOTION_AXIS );
+            EXPECT_EQ( motion->center, MOTION_CENTER );
+            EXPECT_EQ( motion->deadzone, MOTION_DEADZONE );
+            EXPECT_EQ( motion->range, MOTION_RANGE );
+            EXPECT_EQ( motion->max_step, MOTION_MAXSTEP );
+            EXPECT_EQ( motion->curve, 16384 );      // 50% in Q15
+            EXPECT_EQ( motion->spacing, MOTION_SPACING );
+        
+        free( pBuf );
+    
+    delete action;
+}
+
+
+TEST( MotionAction, Serialization )
+{
+    // Create action with parameters, then serialize & deserialize it. 
+    // Then, check de-serialized action equals original one:
+    MotionAction * action = new MotionAction( ACTION_NAME, 
+                                                MOTION_AXIS, MOTION_MAXSTEP, 
+                                                MOTION_SPACING, 
+                                                ACTION_FILTER, 
+                                                ACTION_DESC );
+    action->setCenter( MOTION_CENTER );
+    action->setDeadzone( MOTION_DEADZONE );
+    action->setRange( MOTION_RANGE );
+    action->setCurve( MOTION_CURVE );
+    
+
+        xmlNodePtr node = action->toXml();    
+        EXPECT_TRUE( node != NULL );
+    
+        MotionAction * newAction = static_cast<MotionAction *>( Action::buildFromXml( node ) );
+        ASSERT_TRUE( newAction != NULL );
+        EXPECT_EQ( newAction->getType(), MotionActionType );
+    
+            EXPECT_STREQ( action->getName().c_str(), newAction->getName().c_str() );
+            EXPECT_EQ( action->filter(), newAction->filter() );
+            EXPECT_STREQ( action->getDescription().c_str(), newAction->getDescription().c_str() );
+            
+            EXPECT_EQ( action->getAxis(), newAction->getAxis() );
+            EXPECT_EQ( action->getCenter(), newAction->getCenter() );
+            EXPECT_EQ( action->getDeadzone(), newAction->getDeadzone() );
+            EXPECT_EQ( action->getRange(), newAction->getRange() );
+            EXPECT_EQ( action->getMaxStep(), newAction->getMaxStep() );
+            EXPECT_EQ( action->getCurve(), newAction->getCurve() );
+            EXPECT_EQ( action->getSpacing(), newAction->getSpacing() );
+        
+        delete newAction;
+        xmlFreeNode( node );
+        
+    delete action;
+}
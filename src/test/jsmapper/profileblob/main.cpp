@@ -0,0 +1,148 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file main.cpp
+ * \brief Unit test for jsmapper library's ProfileBlob class
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <gtest/gtest.h>
+
+#include <jsmapper/profileblob.h>
+#include <jsmapper/keyaction.h>
+#include <jsmapper/macroaction.h>
+#include <jsmapper/band.h>
+
+#include <string.h>
+
+using namespace jsmapper;
+
+
+static const char * PROFILE_NAME	= "Blob";
+
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+
+TEST( ProfileBlob, Empty )
+{
+	ProfileBlob blob;
+	blob.setName( PROFILE_NAME );
+
+	EXPECT_EQ( blob.getModeCount(), 0 );
+	EXPECT_EQ( blob.getActionCount(), 0 );
+
+	const struct t_JSMAPPER_PROFILE_HEADER * header = (const struct t_JSMAPPER_PROFILE_HEADER *) blob.getData();
+	ASSERT_TRUE( header != NULL );
+	EXPECT_EQ( header->magic, JSMAPPER_PROFILE_MAGIC );
+	EXPECT_EQ( header->version, JSMAPPER_PROFILE_VERSION );
+	EXPECT_EQ( header->size, blob.getSize() );
+	EXPECT_EQ( header->name_length, strlen( PROFILE_NAME ) );
+	EXPECT_EQ( header->mode_count, 0 );
+	EXPECT_EQ( header->action_count, 0 );
+	EXPECT_EQ( blob.getSize(), sizeof( struct t_JSMAPPER_PROFILE_HEADER ) + 4 );
+	EXPECT_EQ( memcmp( header + 1, PROFILE_NAME, strlen( PROFILE_NAME ) ), 0 );
+}
+
+
+TEST( ProfileBlob, Version )
+{
+	ProfileBlob blob;
+	EXPECT_EQ( blob.getVersion(), JSMAPPER_PROFILE_VERSION );
+
+	// version 1 blobs, for older drivers, share the same layout:
+	blob.setVersion( 1 );
+	blob.clear();
+	EXPECT_EQ( blob.getVersion(), 1 );
+	const struct t_JSMAPPER_PROFILE_HEADER * header = (const struct t_JSMAPPER_PROFILE_HEADER *) blob.getData();
+	EXPECT_EQ( header->version, 1 );
+	EXPECT_EQ( header->size, blob.getSize() );
+}
+
+
+TEST( ProfileBlob, Modes )
+{
+	ProfileBlob blob;
+	struct t_JSMAPPER_MODE mode = { 0 };
+	mode.condition_type = JSMAPPER_MODE_CONDITION_BUTTON;
+	mode.condition.button.id = 3;
+
+	EXPECT_EQ( blob.addMode( mode, 0 ), 1 );
+	EXPECT_EQ( blob.addMode( mode, 1 ), 2 );
+	EXPECT_EQ( blob.addMode( mode, 0 ), 3 );
+	EXPECT_EQ( blob.addMode( mode, 5 ), 0 );	// parent must exist
+	EXPECT_EQ( blob.getModeCount(), 3 );
+
+	const char * data = (const char *) blob.getData();
+	const struct t_JSMAPPER_MODE * modes = (const struct t_JSMAPPER_MODE *) ( data + sizeof( struct t_JSMAPPER_PROFILE_HEADER ) );
+	EXPECT_EQ( modes[0].mode_id, 1 );
+	EXPECT_EQ( modes[0].parent_mode_id, 0 );
+	EXPECT_EQ( modes[1].mode_id, 2 );
+	EXPECT_EQ( modes[1].parent_mode_id, 1 );
+	EXPECT_EQ( modes[2].mode_id, 3 );
+	EXPECT_EQ( modes[2].parent_mode_id, 0 );
+	EXPECT_EQ( modes[2].condition.button.id, 3 );
+}
+
+
+TEST( ProfileBlob, Actions )
+{
+	ProfileBlob blob;
+	KeyAction key( "Key", KEY_A );
+	MacroAction macro( "Macro" );
+	macro.addKey( KEY_B );
+	macro.addKey( KEY_C );
+	macro.addKey( KEY_D );
+
+	struct t_JSMAPPER_MODE mode = { 0 };
+	mode.condition_type = JSMAPPER_MODE_CONDITION_BUTTON;
+	ASSERT_EQ( blob.addMode( mode, 0 ), 1 );
+
+	EXPECT_TRUE( blob.addButtonAction( 0, 2, &key ) );
+	EXPECT_TRUE( blob.addAxisAction( 1, 1, Band( -100, 100 ), &macro ) );
+	EXPECT_EQ( blob.getActionCount(), 2 );
+
+	const char * data = (const char *) blob.getData();
+	size_t offset = sizeof( struct t_JSMAPPER_PROFILE_HEADER ) + sizeof( struct t_JSMAPPER_MODE );
+
+	// records must be aligned & sized to 4 bytes, and cover the whole blob:
+	const struct t_JSMAPPER_PROFILE_ACTION * record = (const struct t_JSMAPPER_PROFILE_ACTION *) ( data + offset );
+	EXPECT_EQ( record->size % 4, 0 );
+	EXPECT_EQ( record->target, JSMAPPER_PROFILE_TARGET_BUTTON );
+	EXPECT_EQ( record->action.mode_id, 0 );
+	EXPECT_EQ( record->action.button.id, 2 );
+	EXPECT_EQ( record->action.type, JSMAPPER_ACTION_KEY );
+	EXPECT_EQ( record->action.data.key.id, KEY_A );
+	offset += record->size;
+
+	record = (const struct t_JSMAPPER_PROFILE_ACTION *) ( data + offset );
+	EXPECT_EQ( record->size % 4, 0 );
+	EXPECT_EQ( record->target, JSMAPPER_PROFILE_TARGET_AXIS );
+	EXPECT_EQ( record->action.mode_id, 1 );
+	EXPECT_EQ( record->action.axis.id, 1 );
+	EXPECT_EQ( record->action.axis.low, -100 );
+	EXPECT_EQ( record->action.axis.high, 100 );
+	EXPECT_EQ( record->action.type, JSMAPPER_ACTION_MACRO );
+	ASSERT_EQ( record->action.data.macro.count, 3 );
+	EXPECT_EQ( record->action.data.macro.keys[2].id, KEY_D );
+	EXPECT_GE( record->size, offsetof( struct t_JSMAPPER_PROFILE_ACTION, action.data.macro.keys ) + 3 * sizeof( struct t_JSMAPPER_KEY ) );
+	offset += record->size;
+
+	EXPECT_EQ( offset, blob.getSize() );
+}
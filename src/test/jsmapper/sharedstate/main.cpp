@@ -0,0 +1,205 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file main.cpp
+ * \brief Unit test for jsmapper library's SharedState class
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <jsmapper/sharedstate.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace jsmapper;
+
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+
+/// Fake shared state page, backed by a temporary file, written the way the driver does
+class SharedStateTest : public ::testing::Test
+{
+protected:
+	int m_fd;
+	struct t_JSMAPPER_SHARED_STATE * m_page;
+	size_t m_size;
+
+	virtual void SetUp()
+	{
+		char path[] = "/tmp/jsmapper-test-sharedstate-XXXXXX";
+		m_fd = mkstemp( path );
+		ASSERT_GE( m_fd, 0 );
+		unlink( path );
+
+		m_size = sysconf( _SC_PAGESIZE );
+		ASSERT_EQ( ftruncate( m_fd, m_size ), 0 );
+		void * page = mmap( NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0 );
+		ASSERT_NE( page, MAP_FAILED );
+		m_page = (struct t_JSMAPPER_SHARED_STATE *) page;
+		m_page->size = sizeof( struct t_JSMAPPER_SHARED_STATE );
+	}
+
+	virtual void TearDown()
+	{
+		munmap( m_page, m_size );
+		close( m_fd );
+	}
+
+	/// Updates the page, setting all axes to the same value
+	void update( int value )
+	{
+		__u32 seq = m_page->seq;
+		__atomic_store_n( &m_page->seq, seq + 1, __ATOMIC_RELAXED );
+		__atomic_thread_fence( __ATOMIC_RELEASE );
+
+		m_page->state.sequence++;
+		m_page->state.button_count = 8;
+		m_page->state.axis_count = JSMAPPER_STATE_AXES;
+		m_page->state.mode_count = 4;
+		m_page->state.buttons[0] = value & 0xff;
+		for( int i = 0; i < JSMAPPER_STATE_AXES; i++ )
+			m_page->state.axes[i] = value;
+		m_page->state.modes[0] = 1 | ( 1 << ( value & 3 ) );
+		m_page->active_mode = value & 3;
+		m_page->profile_generation = value / 4;
+
+		__atomic_store_n( &m_page->seq, seq + 2, __ATOMIC_RELEASE );
+	}
+};
+
+
+TEST_F( SharedStateTest, NotOpen )
+{
+	SharedState shared;
+	DeviceState state;
+	EXPECT_FALSE( shared.isOpen() );
+	EXPECT_FALSE( shared.read( state ) );
+	EXPECT_EQ( shared.getSequence(), 0 );
+}
+
+
+TEST_F( SharedStateTest, BadLayout )
+{
+	m_page->size = 16;
+
+	SharedState shared;
+	EXPECT_FALSE( shared.open( m_fd ) );
+	EXPECT_FALSE( shared.isOpen() );
+}
+
+
+TEST_F( SharedStateTest, Read )
+{
+	SharedState shared;
+	ASSERT_TRUE( shared.open( m_fd ) );
+	EXPECT_TRUE( shared.isOpen() );
+
+	update( 6 );
+	EXPECT_EQ( shared.getSequence(), 1 );
+
+	DeviceState state;
+	ASSERT_TRUE( shared.read( state ) );
+	EXPECT_EQ( state.getSequence(), 1 );
+	EXPECT_EQ( state.getNumButtons(), 8 );
+	EXPECT_EQ( state.getButtonValue( 0 ), 0 );
+	EXPECT_EQ( state.getButtonValue( 1 ), 1 );
+	EXPECT_EQ( state.getButtonValue( 2 ), 1 );
+	EXPECT_EQ( state.getAxisValue( JSMAPPER_STATE_AXES - 1 ), 6 );
+	EXPECT_TRUE( state.isModeActive( 2 ) );
+	EXPECT_FALSE( state.isModeActive( 3 ) );
+	EXPECT_EQ( shared.getActiveMode(), 2 );
+	EXPECT_EQ( shared.getProfileGeneration(), 1 );
+
+	// updates show up right away, through the same mapping:
+	update( 7 );
+	EXPECT_EQ( shared.getSequence(), 2 );
+	ASSERT_TRUE( shared.read( state ) );
+	EXPECT_EQ( state.getAxisValue( 0 ), 7 );
+	EXPECT_EQ( shared.getActiveMode(), 3 );
+
+	// an update that never completes can't be read:
+	m_page->seq++;
+	EXPECT_FALSE( shared.read( state ) );
+	EXPECT_EQ( state.getAxisValue( 0 ), 7 );
+
+	shared.close();
+	EXPECT_FALSE( shared.isOpen() );
+}
+
+
+TEST_F( SharedStateTest, Consistency )
+{
+	SharedState shared;
+	ASSERT_TRUE( shared.open( m_fd ) );
+	update( 0 );
+
+	// snapshots taken while the page is being rewritten must never mix two updates:
+	std::atomic<bool> stop( false );
+	std::atomic<int> written( 0 );
+	std::thread writer( [this, &stop, &written]() {
+		for( int value = 1; !stop; value++ )
+		{
+			update( value );
+			written = value;
+
+			// like the driver, which only updates once per input frame, leave the reader some room:
+			std::this_thread::sleep_for( std::chrono::microseconds( 10 ) );
+		}
+	} );
+
+	// reads start once the writer is running, so they really race with it:
+	while( written == 0 )
+		std::this_thread::yield();
+
+	DeviceState state;
+	int snapshots = 0;
+	for( int i = 0; i < 20000; i++ )
+	{
+		if( !shared.read( state ) )
+			continue;
+
+		snapshots++;
+		int value = state.getAxisValue( 0 );
+		for( int axis = 1; axis < JSMAPPER_STATE_AXES; axis++ )
+			ASSERT_EQ( state.getAxisValue( axis ), value );
+		ASSERT_EQ( shared.getActiveMode(), (unsigned int) ( value & 3 ) );
+	}
+
+	stop = true;
+	writer.join();
+
+	// a test that never got a concurrent snapshot has checked nothing:
+	EXPECT_GT( snapshots, 0 );
+
+	// once the writer is gone the last update must be readable:
+	ASSERT_TRUE( shared.read( state ) );
+	int value = state.getAxisValue( 0 );
+	for( int axis = 1; axis < JSMAPPER_STATE_AXES; axis++ )
+		EXPECT_EQ( state.getAxisValue( axis ), value );
+}
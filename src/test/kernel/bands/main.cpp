@@ -0,0 +1,423 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file main.cpp
+ * \brief Unit test for axis band resolution in the kernel module's mapping core, built in userspace
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "fixture.h"
+extern "C" {
+#include "jsmapper_core.h"
+}
+
+
+int main(int argc, char **argv) 
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+
+/**
+ * Axis programming kept & searched the way the core did before bands were compiled into sorted segments: every 
+ * mode keeps a list of bands per axis, new bands added at its head (list_add) and the list searched backwards 
+ * (list_for_each_entry_reverse), after searching the active submodes, also backwards. Every band is tagged with 
+ * the key ID of its action, so results can be compared with the core's.
+ */
+class OldBands
+{
+public:
+	struct Band
+	{
+		int low;
+		int high;
+		int type;
+		unsigned int tag;
+	};
+	
+	struct Mode
+	{
+		int parent;
+		unsigned int button;
+		std::vector<int> children;
+		std::vector<Band> list;
+	};
+	
+	OldBands() : m_modes( 1 )
+	{
+		m_modes[0].parent = -1;
+		m_modes[0].button = 0;
+	}
+	
+	/// Adds a submode triggered by a button, returning its index
+	int addMode( int parent, unsigned int button )
+	{
+		Mode mode;
+		mode.parent = parent;
+		mode.button = button;
+		m_modes.push_back( mode );
+		m_modes[ parent ].children.push_back( m_modes.size() - 1 );		// list_add_tail()
+		return m_modes.size() - 1;
+	}
+	
+	/// Assigns a band: the same band is modified in place, new ones go to list head
+	void set( int mode, int low, int high, int type, unsigned int tag )
+	{
+		std::vector<Band> & list = m_modes[ mode ].list;
+		for( size_t i = 0; i < list.size(); i++ ) {
+			if( list[i].low == low && list[i].high == high ) {
+				list[i].type = type;
+				list[i].tag = tag;
+				return;
+			}
+		}
+		
+		Band band = { low, high, type, tag };
+		list.insert( list.begin(), band );
+	}
+	
+	/// Tag of the band found for a value given the pressed buttons (bitmask), 0 if none
+	unsigned int find( int value, unsigned int pressed ) const
+	{
+		return find( 0, value, pressed );
+	}
+	
+private:
+	unsigned int find( int mode, int value, unsigned int pressed ) const
+	{
+		const Mode & m = m_modes[ mode ];
+		unsigned int tag = 0;
+		
+		for( size_t i = m.children.size(); i-- > 0 && tag == 0; ) {
+			if( pressed & ( 1u << m_modes[ m.children[i] ].button ) )
+				tag = find( m.children[i], value, pressed );
+		}
+		
+		for( size_t i = m.list.size(); i-- > 0 && tag == 0; ) {
+			if( value >= m.list[i].low && value <= m.list[i].high && m.list[i].type != JSMAPPER_ACTION_DEFAULT )
+				tag = m.list[i].tag;
+		}
+		
+		return tag;
+	}
+	
+	std::vector<Mode> m_modes;
+};
+
+
+/**
+ * Synthetic device with an empty profile, programmed on both the core's staging profile & the reference model. 
+ * Only axis 0 gets bands; submodes are triggered by the first buttons.
+ */
+class BandsTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		m_pressed = 0;
+		m_fixture = fixture_create( 0 );
+		ASSERT_TRUE( m_fixture != NULL );
+		m_core = fixture_core( m_fixture );
+		ASSERT_EQ( jsmapper_core_clear( m_core ), 0 );
+		m_staging = jsmapper_core_get_staging( m_core );
+		ASSERT_TRUE( m_staging != NULL );
+		m_modeIds.push_back( 0 );
+	}
+	
+	virtual void TearDown()
+	{
+		fixture_destroy( m_fixture );
+	}
+	
+	/// Adds a submode triggered by a button to both programmings, returning its index
+	int addMode( int parent, unsigned int button )
+	{
+		struct t_JSMAPPER_MODE mode;
+		memset( &mode, 0, sizeof( mode ) );
+		mode.parent_mode_id = m_modeIds[ parent ];
+		mode.condition_type = JSMAPPER_MODE_CONDITION_BUTTON;
+		mode.condition.button.id = button;
+		EXPECT_EQ( jsmapper_core_add_mode( m_staging, &mode ), 0 );
+		m_modeIds.push_back( mode.mode_id );
+		
+		EXPECT_EQ( m_old.addMode( parent, button ), (int) m_modeIds.size() - 1 );
+		return m_modeIds.size() - 1;
+	}
+	
+	/// Assigns a band of axis 0 to both programmings, with a key action tagged by the key ID
+	void set( int mode, int low, int high, unsigned int tag, int type = JSMAPPER_ACTION_KEY )
+	{
+		struct jsmapdev_core_axis_action assign;
+		jsmapper_core_init_action( &assign.action );
+		assign.band_low = low;
+		assign.band_high = high;
+		assign.filter = false;
+		assign.action.type = type;
+		assign.action.key.id = tag;
+		ASSERT_EQ( jsmapper_core_set_axis_action( m_staging, 0, m_modeIds[ mode ], &assign ), 0 );
+		
+		m_old.set( mode, low, high, type, tag );
+	}
+	
+	/// Publishes the programming, so it can be driven through the event filter
+	void commit()
+	{
+		ASSERT_EQ( jsmapper_core_commit( m_core ), 0 );
+		m_staging = NULL;
+	}
+	
+	/// Sets the pressed state of the first buttons from a bitmask, in a single input frame
+	void press( unsigned int pressed )
+	{
+		for( unsigned int b = 0; b < FIXTURE_SHIFT_COUNT; b++ ) {
+			if( ( pressed ^ m_pressed ) & ( 1u << b ) )
+				fixture_button( m_fixture, b, ( pressed >> b ) & 1 );
+		}
+		fixture_sync( m_fixture );
+		m_pressed = pressed;
+	}
+	
+	/// Tag of the action the published profile resolves a value of axis 0 to, 0 if none
+	unsigned int find( int value )
+	{
+		struct jsmapdev_core_profile * profile = jsmapper_core_get_profile( m_core );
+		struct jsmapdev_core_axis_action * action = jsmapper_core_find_axis_action( profile, 0, value );
+		return action ? action->action.key.id : 0;
+	}
+	
+	/**
+	 * Checks the published profile against the reference for a value: same band, and a cached range holding the 
+	 * value and resolving the same way at both ends
+	 */
+	void check( int value )
+	{
+		unsigned int expected = m_old.find( value, m_pressed );
+		ASSERT_EQ( find( value ), expected ) << "value " << value << ", buttons 0x" << std::hex << m_pressed;
+		
+		const struct jsmapdev_core_axis_cache & cache = jsmapper_core_get_profile( m_core )->axis_cache[0];
+		int low = cache.low, high = cache.high;
+		ASSERT_LE( low, value );
+		ASSERT_GE( high, value );
+		ASSERT_EQ( m_old.find( low, m_pressed ), expected ) << "value " << value << ", range low " << low;
+		ASSERT_EQ( m_old.find( high, m_pressed ), expected ) << "value " << value << ", range high " << high;
+	}
+	
+	/// Checks a value & its neighbours, skipping the ones out of int range
+	void checkAround( long long value )
+	{
+		for( long long v = value - 1; v <= value + 1; v++ ) {
+			if( v >= INT_MIN && v <= INT_MAX )
+				check( (int) v );
+		}
+	}
+	
+	/// Checks every band boundary, the ends of the int range & a sample of values in between
+	void checkAll( const std::vector<std::pair<int, int>> & bands )
+	{
+		checkAround( INT_MIN );
+		checkAround( INT_MAX );
+		checkAround( 0 );
+		for( size_t i = 0; i < bands.size(); i++ ) {
+			checkAround( bands[i].first );
+			checkAround( bands[i].second );
+			checkAround( bands[i].first / 2 + bands[i].second / 2 );
+		}
+	}
+	
+	struct fixture * m_fixture;
+	struct jsmapdev_core * m_core;
+	struct jsmapdev_core_profile * m_staging;
+	std::vector<unsigned int> m_modeIds;
+	unsigned int m_pressed;
+	OldBands m_old;
+};
+
+
+TEST_F( BandsTest, Overlapping )
+{
+	set( 0, 0, 100, 1 );
+	set( 0, 50, 150, 2 );
+	set( 0, 25, 75, 3 );
+	commit();
+	
+	// oldest band wins where they overlap:
+	EXPECT_EQ( find( 0 ), 1u );
+	EXPECT_EQ( find( 75 ), 1u );
+	EXPECT_EQ( find( 100 ), 1u );
+	EXPECT_EQ( find( 101 ), 2u );
+	EXPECT_EQ( find( 150 ), 2u );
+	EXPECT_EQ( find( 151 ), 0u );
+	EXPECT_EQ( find( -1 ), 0u );
+	
+	checkAll( { { 0, 100 }, { 50, 150 }, { 25, 75 } } );
+}
+
+
+TEST_F( BandsTest, Reassign )
+{
+	set( 0, 0, 100, 1 );
+	set( 0, 50, 150, 2 );
+	set( 0, 25, 75, 3 );
+	
+	// same band keeps its place, so it keeps winning:
+	set( 0, 0, 100, 4 );
+	
+	// unmapping a band uncovers the ones below it:
+	set( 0, 50, 150, 5, JSMAPPER_ACTION_DEFAULT );
+	commit();
+	
+	EXPECT_EQ( find( 60 ), 4u );
+	EXPECT_EQ( find( 101 ), 0u );
+	checkAll( { { 0, 100 }, { 50, 150 }, { 25, 75 } } );
+	
+	// and mapping it again puts it back, still behind the oldest one:
+	m_staging = jsmapper_core_get_staging( m_core );
+	ASSERT_TRUE( m_staging != NULL );
+	set( 0, 50, 150, 6 );
+	set( 0, 0, 100, 0, JSMAPPER_ACTION_DEFAULT );
+	commit();
+	
+	EXPECT_EQ( find( 10 ), 0u );
+	EXPECT_EQ( find( 30 ), 3u );
+	EXPECT_EQ( find( 60 ), 6u );
+	checkAll( { { 0, 100 }, { 50, 150 }, { 25, 75 } } );
+}
+
+
+TEST_F( BandsTest, Gaps )
+{
+	set( 0, 0, 10, 1 );
+	set( 0, 20, 30, 2 );
+	set( 0, 31, 40, 3 );
+	set( 0, 60, 50, 4 );		// empty band, never matches
+	commit();
+	
+	EXPECT_EQ( find( 15 ), 0u );
+	const struct jsmapdev_core_axis_cache & cache = jsmapper_core_get_profile( m_core )->axis_cache[0];
+	EXPECT_EQ( cache.low, 11 );
+	EXPECT_EQ( cache.high, 19 );
+	
+	// adjacent bands don't merge into one range:
+	EXPECT_EQ( find( 30 ), 2u );
+	EXPECT_EQ( cache.high, 30 );
+	EXPECT_EQ( find( 55 ), 0u );
+	EXPECT_EQ( cache.low, 41 );
+	EXPECT_EQ( cache.high, INT_MAX );
+	
+	checkAll( { { 0, 10 }, { 20, 30 }, { 31, 40 }, { 60, 50 } } );
+}
+
+
+TEST_F( BandsTest, Limits )
+{
+	set( 0, INT_MIN, -1, 1 );
+	set( 0, INT_MAX, INT_MAX, 2 );
+	set( 0, 0, INT_MAX, 3 );
+	set( 0, INT_MIN, INT_MIN, 4 );
+	commit();
+	
+	EXPECT_EQ( find( INT_MIN ), 1u );
+	EXPECT_EQ( find( -1 ), 1u );
+	EXPECT_EQ( find( 0 ), 3u );
+	EXPECT_EQ( find( INT_MAX ), 2u );
+	EXPECT_EQ( find( INT_MAX - 1 ), 3u );
+	
+	checkAll( { { INT_MIN, -1 }, { INT_MAX, INT_MAX }, { 0, INT_MAX }, { INT_MIN, INT_MIN } } );
+}
+
+
+TEST_F( BandsTest, Submodes )
+{
+	const std::vector<std::pair<int, int>> bands = { { 0, 100 }, { 50, 150 }, { 200, 300 }, { 90, 210 } };
+	
+	int a = addMode( 0, 0 );
+	int b = addMode( 0, 1 );
+	int c = addMode( a, 2 );
+	
+	set( 0, 0, 300, 1 );
+	set( a, 50, 150, 2 );
+	set( a, 200, 300, 3 );
+	set( b, 90, 210, 4 );
+	set( b, 0, 100, 5 );
+	set( c, 0, 100, 6 );
+	set( c, 90, 210, 7 );
+	commit();
+	
+	// later submodes first, a submode before its parent, nested ones only below an active parent:
+	for( unsigned int pressed = 0; pressed < 8; pressed++ ) {
+		press( pressed );
+		checkAll( bands );
+	}
+	
+	press( 1 | 2 );
+	EXPECT_EQ( find( 60 ), 5u );
+	EXPECT_EQ( find( 120 ), 4u );
+	EXPECT_EQ( find( 250 ), 3u );
+	
+	press( 1 | 4 );
+	EXPECT_EQ( find( 60 ), 6u );
+	EXPECT_EQ( find( 120 ), 7u );
+	
+	press( 4 );
+	EXPECT_EQ( find( 60 ), 1u );
+}
+
+
+TEST_F( BandsTest, Random )
+{
+	std::mt19937 random( 20130101 );
+	std::uniform_int_distribution<int> value( -1000, 1000 );
+	std::vector<std::pair<int, int>> bands;
+	
+	int a = addMode( 0, 0 );
+	int b = addMode( 0, 1 );
+	addMode( a, 2 );
+	addMode( b, 3 );
+	
+	for( unsigned int tag = 1; tag <= 400; tag++ ) {
+		int low = 0, high = 0;
+		
+		if( !bands.empty() && random() % 4 == 0 ) {
+			// re-assign an existing band, sometimes unmapping it:
+			low = bands[ random() % bands.size() ].first;
+			high = low;
+			for( size_t i = 0; i < bands.size(); i++ ) {
+				if( bands[i].first == low )
+					high = bands[i].second;
+			}
+		} else {
+			low = random() % 16 ? value( random ) : INT_MIN;
+			high = random() % 16 ? low + (int) ( random() % 300 ) : INT_MAX;
+			bands.push_back( std::make_pair( low, high ) );
+		}
+		
+		set( random() % 5, low, high, tag, random() % 8 ? JSMAPPER_ACTION_KEY : JSMAPPER_ACTION_DEFAULT );
+	}
+	commit();
+	
+	for( unsigned int pressed = 0; pressed < 16; pressed++ ) {
+		press( pressed );
+		checkAll( bands );
+		for( int i = 0; i < 200; i++ )
+			check( value( random ) );
+	}
+}
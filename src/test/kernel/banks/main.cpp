@@ -0,0 +1,156 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file main.cpp
+ * \brief Unit test for profile banks in the kernel module's mapping core, built in userspace
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "fixture.h"
+extern "C" {
+#include "jsmapper_core.h"
+}
+
+
+/// Bank button: last button of the synthetic device
+static const int BANK_BUTTON = FIXTURE_BUTTON_COUNT - 1;
+
+
+int main(int argc, char **argv) 
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+
+/**
+ * Fixture device with a second profile preloaded in bank 2, recording the records sent to the core listener the 
+ * way the device's event stream gets them.
+ */
+class BanksTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		m_fixture = fixture_create( 4 );
+		ASSERT_TRUE( m_fixture != NULL );
+		m_core = fixture_core( m_fixture );
+		
+		// an empty profile, just a blob header & its name:
+		std::vector<char> blob( sizeof( struct t_JSMAPPER_PROFILE_HEADER ) + 4, 0 );
+		struct t_JSMAPPER_PROFILE_HEADER * header = (struct t_JSMAPPER_PROFILE_HEADER *) &blob[0];
+		header->magic = JSMAPPER_PROFILE_MAGIC;
+		header->version = JSMAPPER_PROFILE_VERSION;
+		header->name_length = 4;
+		header->size = blob.size();
+		memcpy( header + 1, "bank", 4 );
+		ASSERT_EQ( jsmapper_core_load_profile( m_core, &blob[0], blob.size(), 1 ), 0 );
+		
+		jsmapper_core_set_listener( m_core, listener, this );
+	}
+	
+	virtual void TearDown()
+	{
+		fixture_destroy( m_fixture );
+	}
+	
+	static void listener( void * data, struct t_JSMAPPER_EVENT * event )
+	{
+		( (BanksTest *) data )->m_events.push_back( *event );
+	}
+	
+	/// Number of PROFILE records received
+	int profileCount() const
+	{
+		int count = 0;
+		for( size_t i = 0; i < m_events.size(); i++ )
+			count += m_events[i].type == JSMAPPER_EVENT_PROFILE;
+		return count;
+	}
+	
+	/// Active bank number
+	uint activeBank()
+	{
+		struct t_JSMAPPER_BANKS banks;
+		jsmapper_core_get_banks( m_core, &banks );
+		return banks.active;
+	}
+	
+	struct fixture * m_fixture;
+	struct jsmapdev_core * m_core;
+	std::vector<struct t_JSMAPPER_EVENT> m_events;
+};
+
+
+TEST_F( BanksTest, Banks )
+{
+	struct t_JSMAPPER_BANKS banks;
+	jsmapper_core_get_banks( m_core, &banks );
+	EXPECT_EQ( banks.active, 1u );
+	EXPECT_EQ( banks.loaded, 3u );
+	EXPECT_EQ( banks.button, -1 );
+	
+	// preloading didn't touch the profile in use:
+	EXPECT_STRNE( jsmapper_core_get_profile_name( jsmapper_core_get_profile( m_core ) ), "bank" );
+	EXPECT_EQ( jsmapper_core_select_bank( m_core, 2 ), -ENOENT );
+	EXPECT_EQ( jsmapper_core_select_bank( m_core, JSMAPPER_BANK_COUNT ), -EINVAL );
+	EXPECT_EQ( profileCount(), 0 );
+}
+
+
+TEST_F( BanksTest, Select )
+{
+	// switching from an ioctl: the PROFILE record closes the switch, as nothing else will follow it
+	ASSERT_EQ( jsmapper_core_select_bank( m_core, 1 ), 0 );
+	EXPECT_EQ( activeBank(), 2u );
+	EXPECT_STREQ( jsmapper_core_get_profile_name( jsmapper_core_get_profile( m_core ) ), "bank" );
+	ASSERT_FALSE( m_events.empty() );
+	EXPECT_EQ( m_events.back().type, JSMAPPER_EVENT_PROFILE );
+	EXPECT_EQ( profileCount(), 1 );
+}
+
+
+TEST_F( BanksTest, Cycle )
+{
+	ASSERT_EQ( jsmapper_core_set_bank_button( m_core, BANK_BUTTON ), 0 );
+	
+	// bank button is filtered out, and banks are switched once the frame is complete:
+	EXPECT_TRUE( fixture_button( m_fixture, BANK_BUTTON, 1 ) );
+	EXPECT_EQ( activeBank(), 1u );
+	EXPECT_EQ( profileCount(), 0 );
+	
+	// the frame that pressed the button carries the PROFILE record, as its last one, without waiting for another:
+	fixture_sync( m_fixture );
+	EXPECT_EQ( activeBank(), 2u );
+	ASSERT_FALSE( m_events.empty() );
+	EXPECT_EQ( m_events.back().type, JSMAPPER_EVENT_PROFILE );
+	EXPECT_EQ( profileCount(), 1 );
+	
+	// releasing it doesn't switch again, the next press goes back to the first bank (the only other loaded one):
+	m_events.clear();
+	EXPECT_TRUE( fixture_button( m_fixture, BANK_BUTTON, 0 ) );
+	fixture_sync( m_fixture );
+	EXPECT_EQ( profileCount(), 0 );
+	
+	fixture_button( m_fixture, BANK_BUTTON, 1 );
+	fixture_sync( m_fixture );
+	EXPECT_EQ( activeBank(), 1u );
+	EXPECT_EQ( profileCount(), 1 );
+	EXPECT_EQ( m_events.back().type, JSMAPPER_EVENT_PROFILE );
+}
@@ -0,0 +1,175 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file fixture.c
+ * \brief Synthetic device & profiles used to drive the mapping core from userspace
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include "fixture.h"
+#include "jsmapper_core.h"
+
+
+struct fixture {
+	/** Synthetic input device */
+	struct input_dev dev;
+	/** Core attached to the device */
+	struct jsmapdev_core * core;
+};
+
+
+static int _set_button( struct jsmapdev_core_profile * profile, uint mode_id, uint button, uint key )
+{
+	struct jsmapdev_core_button_action assign;
+	
+	jsmapper_core_init_action( &assign.action );
+	assign.filter = true;
+	assign.action.type = JSMAPPER_ACTION_KEY;
+	assign.action.key.id = key;
+	
+	return jsmapper_core_set_button_action( profile, button, mode_id, &assign );
+}
+
+
+static int _set_band( struct jsmapdev_core_profile * profile, uint mode_id, uint axis, int low, int high, uint key )
+{
+	struct jsmapdev_core_axis_action assign;
+	
+	jsmapper_core_init_action( &assign.action );
+	assign.band_low = low;
+	assign.band_high = high;
+	assign.filter = false;
+	assign.action.type = JSMAPPER_ACTION_KEY;
+	assign.action.key.id = key;
+	
+	return jsmapper_core_set_axis_action( profile, axis, mode_id, &assign );
+}
+
+
+static int _build_profile( struct jsmapdev_core_profile * profile, uint mode_count )
+{
+	struct t_JSMAPPER_MODE mode;
+	const int third = ( FIXTURE_AXIS_MAX + 1 ) / 3;
+	const int slice = ( FIXTURE_AXIS_MAX + 1 ) / 8;
+	uint i = 0, b = 0, a = 0;
+	int ret = 0;
+	
+	for( b = FIXTURE_SHIFT_COUNT; b < FIXTURE_BUTTON_COUNT && ret == 0; b++ )
+		ret = _set_button( profile, 0, b, KEY_A + b );
+	
+	for( a = 0; a < FIXTURE_AXIS_COUNT && ret == 0; a++ ) {
+		ret = _set_band( profile, 0, a, 0, third - 1, KEY_F1 + a )
+		   || _set_band( profile, 0, a, 2 * third, FIXTURE_AXIS_MAX, KEY_F7 + a );
+	}
+	
+	for( i = 1; i <= mode_count && ret == 0; i++ ) {
+		memset( &mode, 0, sizeof( mode ) );
+		if( i <= FIXTURE_SHIFT_COUNT ) {
+			mode.parent_mode_id = 0;
+			mode.condition_type = JSMAPPER_MODE_CONDITION_BUTTON;
+			mode.condition.button.id = i - 1;
+		} else {
+			mode.parent_mode_id = ( i - 1 ) % FIXTURE_SHIFT_COUNT + 1;
+			mode.condition_type = JSMAPPER_MODE_CONDITION_AXIS;
+			mode.condition.axis.id = FIXTURE_AXIS_COUNT - 1;
+			mode.condition.axis.low = ( i % 8 ) * slice;
+			mode.condition.axis.high = ( i % 8 + 1 ) * slice - 1;
+		}
+		
+		ret = jsmapper_core_add_mode( profile, &mode );
+		for( b = 0; b < 3 && ret == 0; b++ )
+			ret = _set_button( profile, mode.mode_id, FIXTURE_SHIFT_COUNT + ( i * 5 + b * 7 ) % ( FIXTURE_BUTTON_COUNT - FIXTURE_SHIFT_COUNT ), KEY_1 + b );
+		
+		if( ret == 0 ) {
+			ret = _set_band( profile, mode.mode_id, 0, ( i % 8 ) * slice, ( i % 8 ) * slice + slice / 2, KEY_Q )
+			   || _set_band( profile, mode.mode_id, 0, third, 2 * third - 1, KEY_W );
+		}
+	}
+	
+	return ret;
+}
+
+
+struct fixture * fixture_create( unsigned int mode_count )
+{
+	struct fixture * f = kzalloc( sizeof(struct fixture), GFP_KERNEL );
+	struct jsmapdev_core_profile * staging = NULL;
+	uint i = 0;
+	
+	if( f == NULL )
+		return NULL;
+	
+	for( i = 0; i < FIXTURE_BUTTON_COUNT; i++ )
+		set_bit( BTN_JOYSTICK + i, f->dev.keybit );
+	for( i = 0; i < FIXTURE_AXIS_COUNT; i++ ) {
+		set_bit( ABS_X + i, f->dev.absbit );
+		f->dev.absinfo[ ABS_X + i ].maximum = FIXTURE_AXIS_MAX;
+		f->dev.absinfo[ ABS_X + i ].value = FIXTURE_AXIS_MAX / 2;
+	}
+	
+	f->core = jsmapper_core_init( &f->dev, NULL );
+	if( f->core ) {
+		staging = jsmapper_core_get_staging( f->core );
+		if( staging && _build_profile( staging, mode_count ) == 0 && jsmapper_core_commit( f->core ) == 0 )
+			return f;
+	}
+	
+	fixture_destroy( f );
+	return NULL;
+}
+
+
+void fixture_destroy( struct fixture * f )
+{
+	if( f ) {
+		jsmapper_core_done( f->core );
+		kfree( f );
+	}
+}
+
+
+struct jsmapdev_core * fixture_core( struct fixture * f )
+{
+	return f->core;
+}
+
+
+int fixture_button( struct fixture * f, unsigned int button, int value )
+{
+	int code = jsmapper_core_rmap_button( f->core, button );
+	
+	/* input core updates device state before passing the event to handlers: */
+	if( value )
+		set_bit( code, f->dev.key );
+	else
+		clear_bit( code, f->dev.key );
+	
+	return jsmapper_core_filter( f->core, EV_KEY, code, value );
+}
+
+
+int fixture_axis( struct fixture * f, unsigned int axis, int value )
+{
+	int code = jsmapper_core_rmap_axis( f->core, axis );
+	
+	f->dev.absinfo[ code ].value = value;
+	return jsmapper_core_filter( f->core, EV_ABS, code, value );
+}
+
+
+void fixture_sync( struct fixture * f )
+{
+	jsmapper_core_filter( f->core, EV_SYN, SYN_REPORT, 0 );
+}
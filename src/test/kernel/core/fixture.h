@@ -0,0 +1,83 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file fixture.h
+ * \brief Synthetic device & profiles used to drive the mapping core from userspace
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#ifndef __JSMAPPER_CORE_FIXTURE_H_
+#define __JSMAPPER_CORE_FIXTURE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of buttons of the synthetic device */
+#define FIXTURE_BUTTON_COUNT		32
+/** Number of axes of the synthetic device */
+#define FIXTURE_AXIS_COUNT			6
+/** Axis values range from 0 up to this value */
+#define FIXTURE_AXIS_MAX			1023
+/** Buttons 0..FIXTURE_SHIFT_COUNT-1 trigger submodes, the rest get mapped */
+#define FIXTURE_SHIFT_COUNT			4
+
+struct fixture;
+struct jsmapdev_core;
+
+/**
+ * \brief Creates a synthetic device & loads a profile into its core
+ * 
+ * Root mode maps every non-shift button to a key, and splits every axis in three bands. The first submodes are 
+ * triggered by shift buttons, the following ones are nested below them and triggered by bands of the last axis. 
+ * Every submode overrides a few buttons and two bands of the first axis.
+ * 
+ * \param mode_count Number of submodes in the profile
+ * \return The fixture, or NULL if failed
+ */
+struct fixture * fixture_create( unsigned int mode_count );
+
+/**
+ * \brief Destroys a fixture
+ */
+void fixture_destroy( struct fixture * f );
+
+/**
+ * \brief Returns the core attached to the synthetic device
+ */
+struct jsmapdev_core * fixture_core( struct fixture * f );
+
+/**
+ * \brief Feeds a button event to the core, as the input layer would
+ * \return Non-zero if the event would be filtered out
+ */
+int fixture_button( struct fixture * f, unsigned int button, int value );
+
+/**
+ * \brief Feeds an axis event to the core, as the input layer would
+ * \return Non-zero if the event would be filtered out
+ */
+int fixture_axis( struct fixture * f, unsigned int axis, int value );
+
+/**
+ * \brief Ends the input frame, so the core resolves the actions triggered by the events fed since the last one
+ */
+void fixture_sync( struct fixture * f );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __JSMAPPER_CORE_FIXTURE_H_
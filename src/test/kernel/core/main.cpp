@@ -0,0 +1,148 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file main.cpp
+ * \brief Benchmark for the kernel module's mapping core, built in userspace
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "fixture.h"
+#include "evgen_recorder.h"
+
+
+/*
+ * Unless stated otherwise, every iteration feeds a single event to the core in its own frame, so the reported 
+ * time per iteration is the cost of the input handler's filter for one event. Benchmarks are run against profiles 
+ * with different number of modes.
+ */
+
+#define MODE_COUNTS		->Arg( 0 )->Arg( 4 )->Arg( 16 )->Arg( 64 )
+
+
+/// Runs a benchmark against a fixture, reporting the number of actions sent per event, and output syncs per frame
+template <typename F>
+static void run( benchmark::State &state, F feed )
+{
+	struct fixture * f = fixture_create( state.range( 0 ) );
+	if( f == NULL )
+	{
+		state.SkipWithError( "Failed to create fixture!" );
+		return;
+	}
+
+	jsmapper_evgen_recorder_reset();
+
+	unsigned int n = 0;
+	for( auto _ : state )
+	{
+		benchmark::DoNotOptimize( feed( f, n++ ) );
+		fixture_sync( f );
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+	state.counters[ "actions/event" ] = benchmark::Counter( (double) jsmapper_evgen_recorder_count() / n );
+	
+	/* output syncs per (non empty) input frame, batched vs. sent one per action */
+	unsigned long frames = jsmapper_evgen_recorder_frames();
+	if( frames )
+	{
+		state.counters[ "syncs/frame" ] = benchmark::Counter( (double) jsmapper_evgen_recorder_syncs( 1 ) / frames );
+		state.counters[ "unbatched/frame" ] = benchmark::Counter( (double) jsmapper_evgen_recorder_syncs( 0 ) / frames );
+	}
+	fixture_destroy( f );
+}
+
+
+/// Mapped buttons pressed & released in turn, with no mode changes
+static void BM_ButtonStream( benchmark::State &state )
+{
+	run( state, []( struct fixture * f, unsigned int n ) {
+		unsigned int button = FIXTURE_SHIFT_COUNT + ( n / 2 ) % ( FIXTURE_BUTTON_COUNT - FIXTURE_SHIFT_COUNT );
+		return fixture_button( f, button, !( n & 1 ) );
+	} );
+}
+BENCHMARK( BM_ButtonStream ) MODE_COUNTS;
+
+
+/// Shift buttons pressed & released in turn, so active modes change on every event
+static void BM_ModeSwitch( benchmark::State &state )
+{
+	run( state, []( struct fixture * f, unsigned int n ) {
+		return fixture_button( f, ( n / 2 ) % FIXTURE_SHIFT_COUNT, !( n & 1 ) );
+	} );
+}
+BENCHMARK( BM_ModeSwitch ) MODE_COUNTS;
+
+
+/// Axis noise around a resting position, without leaving the band
+static void BM_AxisJitter( benchmark::State &state )
+{
+	run( state, []( struct fixture * f, unsigned int n ) {
+		return fixture_axis( f, 0, FIXTURE_AXIS_MAX / 2 + (int) ( n % 5 ) - 2 );
+	} );
+}
+BENCHMARK( BM_AxisJitter ) MODE_COUNTS;
+
+
+/// Axis sweeping its whole range back & forth, crossing every band
+static void BM_AxisSweep( benchmark::State &state )
+{
+	run( state, []( struct fixture * f, unsigned int n ) {
+		int pos = ( n * 7 ) % ( 2 * FIXTURE_AXIS_MAX );
+		return fixture_axis( f, 0, pos <= FIXTURE_AXIS_MAX ? pos : 2 * FIXTURE_AXIS_MAX - pos );
+	} );
+}
+BENCHMARK( BM_AxisSweep ) MODE_COUNTS;
+
+
+/// Mixed stream, roughly as a flight session: mostly axis noise, some buttons, a few mode switches
+static void BM_Mixed( benchmark::State &state )
+{
+	run( state, []( struct fixture * f, unsigned int n ) {
+		unsigned int r = ( n * 2654435761u ) >> 16;
+		switch( r % 16 )
+		{
+		case 0:
+			return fixture_button( f, r % FIXTURE_SHIFT_COUNT, ( r >> 4 ) & 1 );
+		case 1: case 2:
+			return fixture_button( f, FIXTURE_SHIFT_COUNT + r % ( FIXTURE_BUTTON_COUNT - FIXTURE_SHIFT_COUNT ), ( r >> 4 ) & 1 );
+		default:
+			return fixture_axis( f, r % FIXTURE_AXIS_COUNT, (int) ( r >> 4 ) % ( FIXTURE_AXIS_MAX + 1 ) );
+		}
+	} );
+}
+BENCHMARK( BM_Mixed ) MODE_COUNTS;
+
+
+/// Whole stick frames: X, Y & throttle moving together, plus a button (sometimes a shift one) every few frames
+static void BM_StickFrame( benchmark::State &state )
+{
+	run( state, []( struct fixture * f, unsigned int n ) {
+		unsigned int r = ( n * 2654435761u ) >> 16;
+		int filter = 0;
+		filter |= fixture_axis( f, 0, (int) ( r % ( FIXTURE_AXIS_MAX + 1 ) ) );
+		filter |= fixture_axis( f, 1, (int) ( ( r >> 3 ) % ( FIXTURE_AXIS_MAX + 1 ) ) );
+		filter |= fixture_axis( f, FIXTURE_AXIS_COUNT - 1, (int) ( ( r >> 6 ) % ( FIXTURE_AXIS_MAX + 1 ) ) );
+		if( r % 4 == 0 )
+			filter |= fixture_button( f, ( r >> 4 ) % FIXTURE_BUTTON_COUNT, ( r >> 9 ) & 1 );
+		return filter;
+	} );
+}
+BENCHMARK( BM_StickFrame ) MODE_COUNTS;
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,393 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ *
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \file main.cpp
+ * \brief Unit test for mode activation & the caches depending on it in the kernel module's mapping core, built in 
+ * userspace
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "fixture.h"
+#include "evgen_recorder.h"
+extern "C" {
+#include "jsmapper_core.h"
+}
+
+
+int main(int argc, char **argv) 
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+
+/// Buttons triggering modes
+enum { SHIFT_A = 0, SHIFT_B = 1, SHIFT_C = 2, SHIFT_E = 3 };
+
+/// Mapped buttons
+enum { BUTTON_1 = 10, BUTTON_2 = 11, BUTTON_3 = 12 };
+
+/// Axis with bands, and axis triggering a mode
+enum { AXIS_BANDS = 0, AXIS_TRIGGER = 1 };
+
+/// Band of AXIS_TRIGGER activating mode D
+static const int D_LOW = 600, D_HIGH = 800;
+
+
+/**
+ * Synthetic device with a profile of nested modes:
+ * 
+ *  - root: maps BUTTON_1..3 & the lower half of AXIS_BANDS
+ *    - A (SHIFT_A): maps BUTTON_1 & part of AXIS_BANDS lower half
+ *      - C (SHIFT_C): maps BUTTON_1 & BUTTON_2
+ *    - B (SHIFT_B): maps BUTTON_1 & BUTTON_3
+ *    - D (AXIS_TRIGGER within D_LOW..D_HIGH): maps BUTTON_2 & part of AXIS_BANDS lower half
+ * 
+ * Every action is a key action, the key ID telling the mode & button it was assigned for.
+ */
+class ModesTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		m_fixture = fixture_create( 0 );
+		ASSERT_TRUE( m_fixture != NULL );
+		m_core = fixture_core( m_fixture );
+		ASSERT_EQ( jsmapper_core_clear( m_core ), 0 );
+		m_staging = jsmapper_core_get_staging( m_core );
+		ASSERT_TRUE( m_staging != NULL );
+		
+		m_a = addButtonMode( 0, SHIFT_A );
+		m_b = addButtonMode( 0, SHIFT_B );
+		m_c = addButtonMode( m_a, SHIFT_C );
+		m_d = addAxisMode( 0, AXIS_TRIGGER, D_LOW, D_HIGH );
+		
+		setButton( 0, BUTTON_1, 1 );
+		setButton( 0, BUTTON_2, 2 );
+		setButton( 0, BUTTON_3, 3 );
+		setButton( m_a, BUTTON_1, 11 );
+		setButton( m_c, BUTTON_1, 31 );
+		setButton( m_c, BUTTON_2, 32 );
+		setButton( m_b, BUTTON_1, 21 );
+		setButton( m_b, BUTTON_3, 23 );
+		setButton( m_d, BUTTON_2, 42 );
+		
+		setBand( 0, 0, 500, 100 );
+		setBand( m_a, 100, 200, 110 );
+		setBand( m_d, 100, 200, 140 );
+		commit();
+		
+		jsmapper_evgen_recorder_reset();
+	}
+	
+	virtual void TearDown()
+	{
+		fixture_destroy( m_fixture );
+	}
+	
+	unsigned int addMode( struct t_JSMAPPER_MODE & mode )
+	{
+		EXPECT_EQ( jsmapper_core_add_mode( m_staging, &mode ), 0 );
+		return mode.mode_id;
+	}
+	
+	unsigned int addButtonMode( unsigned int parent, unsigned int button )
+	{
+		struct t_JSMAPPER_MODE mode;
+		memset( &mode, 0, sizeof( mode ) );
+		mode.parent_mode_id = parent;
+		mode.condition_type = JSMAPPER_MODE_CONDITION_BUTTON;
+		mode.condition.button.id = button;
+		return addMode( mode );
+	}
+	
+	unsigned int addAxisMode( unsigned int parent, unsigned int axis, int low, int high )
+	{
+		struct t_JSMAPPER_MODE mode;
+		memset( &mode, 0, sizeof( mode ) );
+		mode.parent_mode_id = parent;
+		mode.condition_type = JSMAPPER_MODE_CONDITION_AXIS;
+		mode.condition.axis.id = axis;
+		mode.condition.axis.low = low;
+		mode.condition.axis.high = high;
+		return addMode( mode );
+	}
+	
+	void setButton( unsigned int mode, unsigned int button, unsigned int key )
+	{
+		struct jsmapdev_core_button_action assign;
+		jsmapper_core_init_action( &assign.action );
+		assign.filter = true;
+		assign.action.type = JSMAPPER_ACTION_KEY;
+		assign.action.key.id = key;
+		ASSERT_EQ( jsmapper_core_set_button_action( m_staging, button, mode, &assign ), 0 );
+	}
+	
+	void setBand( unsigned int mode, int low, int high, unsigned int key )
+	{
+		struct jsmapdev_core_axis_action assign;
+		jsmapper_core_init_action( &assign.action );
+		assign.band_low = low;
+		assign.band_high = high;
+		assign.filter = false;
+		assign.action.type = JSMAPPER_ACTION_KEY;
+		assign.action.key.id = key;
+		ASSERT_EQ( jsmapper_core_set_axis_action( m_staging, AXIS_BANDS, mode, &assign ), 0 );
+	}
+	
+	void commit()
+	{
+		ASSERT_EQ( jsmapper_core_commit( m_core ), 0 );
+		m_staging = NULL;
+	}
+	
+	/// Sends a button change in its own input frame
+	void button( unsigned int id, int value )
+	{
+		fixture_button( m_fixture, id, value );
+		fixture_sync( m_fixture );
+	}
+	
+	/// Sends an axis change in its own input frame
+	void axis( unsigned int id, int value )
+	{
+		fixture_axis( m_fixture, id, value );
+		fixture_sync( m_fixture );
+	}
+	
+	bool active( unsigned int mode_id )
+	{
+		struct jsmapdev_core_profile * profile = jsmapper_core_get_profile( m_core );
+		return jsmapper_core_is_mode_active( profile, jsmapper_core_find_mode( profile, mode_id ) );
+	}
+	
+	/// Key of the action currently resolved for a button by the effective button table, 0 if none
+	unsigned int key( unsigned int button )
+	{
+		struct jsmapdev_core_button_action * action = 
+			jsmapper_core_find_button_action( jsmapper_core_get_profile( m_core ), button );
+		return action ? action->action.key.id : 0;
+	}
+	
+	/// Key of the last action sent, negative if released, 0 if none
+	int sent()
+	{
+		const struct jsmapper_evgen_record * record = jsmapper_evgen_recorder_get( 0 );
+		return record ? ( record->press ? (int) record->key_id : -(int) record->key_id ) : 0;
+	}
+	
+	/// Keys resolved for every mapped button
+	std::vector<unsigned int> keys()
+	{
+		return { key( BUTTON_1 ), key( BUTTON_2 ), key( BUTTON_3 ) };
+	}
+	
+	struct fixture * m_fixture;
+	struct jsmapdev_core * m_core;
+	struct jsmapdev_core_profile * m_staging;
+	unsigned int m_a, m_b, m_c, m_d;
+};
+
+
+TEST_F( ModesTest, Buttons )
+{
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 1, 2, 3 } ) );
+	
+	button( SHIFT_A, 1 );
+	EXPECT_TRUE( active( m_a ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 11, 2, 3 } ) );
+	
+	// later sibling wins over earlier one, each falling back to its parent for what it doesn't map:
+	button( SHIFT_B, 1 );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 21, 2, 23 } ) );
+	button( SHIFT_B, 0 );
+	EXPECT_FALSE( active( m_b ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 11, 2, 3 } ) );
+	
+	button( SHIFT_A, 0 );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 1, 2, 3 } ) );
+	
+	// a button not triggering anything leaves modes alone:
+	button( BUTTON_1, 1 );
+	EXPECT_EQ( sent(), 1 );
+	button( BUTTON_1, 0 );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 1, 2, 3 } ) );
+}
+
+
+TEST_F( ModesTest, InactiveParent )
+{
+	// submode trigger alone does nothing while its parent is inactive:
+	button( SHIFT_C, 1 );
+	EXPECT_FALSE( active( m_a ) );
+	EXPECT_FALSE( active( m_c ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 1, 2, 3 } ) );
+	
+	// activating the parent activates the submode too, even if its own trigger didn't change:
+	button( SHIFT_A, 1 );
+	EXPECT_TRUE( active( m_a ) );
+	EXPECT_TRUE( active( m_c ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 31, 32, 3 } ) );
+	
+	button( BUTTON_2, 1 );
+	EXPECT_EQ( sent(), 32 );
+	button( BUTTON_2, 0 );
+	
+	// and deactivating it takes the submode down, with its trigger still held:
+	button( SHIFT_A, 0 );
+	EXPECT_FALSE( active( m_a ) );
+	EXPECT_FALSE( active( m_c ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 1, 2, 3 } ) );
+	
+	button( SHIFT_C, 0 );
+	button( SHIFT_A, 1 );
+	EXPECT_TRUE( active( m_a ) );
+	EXPECT_FALSE( active( m_c ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 11, 2, 3 } ) );
+}
+
+
+TEST_F( ModesTest, AxisCondition )
+{
+	EXPECT_FALSE( active( m_d ) );
+	
+	// band limits are inclusive:
+	axis( AXIS_TRIGGER, D_LOW - 1 );
+	EXPECT_FALSE( active( m_d ) );
+	axis( AXIS_TRIGGER, D_LOW );
+	EXPECT_TRUE( active( m_d ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 1, 42, 3 } ) );
+	axis( AXIS_TRIGGER, D_HIGH );
+	EXPECT_TRUE( active( m_d ) );
+	axis( AXIS_TRIGGER, D_HIGH + 1 );
+	EXPECT_FALSE( active( m_d ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 1, 2, 3 } ) );
+	
+	// both kinds of modes at once, the later one winning:
+	button( SHIFT_A, 1 );
+	button( SHIFT_C, 1 );
+	axis( AXIS_TRIGGER, ( D_LOW + D_HIGH ) / 2 );
+	EXPECT_TRUE( active( m_c ) );
+	EXPECT_TRUE( active( m_d ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 31, 42, 3 } ) );
+	
+	// a trigger change within the frame of a mapped button applies to the button:
+	fixture_axis( m_fixture, AXIS_TRIGGER, 0 );
+	fixture_button( m_fixture, BUTTON_2, 1 );
+	fixture_sync( m_fixture );
+	EXPECT_EQ( sent(), 32 );
+}
+
+
+TEST_F( ModesTest, AxisCacheButtonMode )
+{
+	axis( AXIS_BANDS, 150 );
+	EXPECT_EQ( sent(), 100 );
+	
+	// band resolved for the axis is cached, but mode changes must invalidate it:
+	button( SHIFT_A, 1 );
+	axis( AXIS_BANDS, 151 );
+	EXPECT_EQ( sent(), 110 );
+	EXPECT_EQ( jsmapper_core_find_axis_action( jsmapper_core_get_profile( m_core ), AXIS_BANDS, 151 )->action.key.id, 
+			   110u );
+	
+	button( SHIFT_A, 0 );
+	axis( AXIS_BANDS, 152 );
+	EXPECT_EQ( sent(), 100 );
+	
+	// a change of an unrelated mode keeps the resolution:
+	unsigned long count = jsmapper_evgen_recorder_count();
+	button( SHIFT_C, 1 );
+	axis( AXIS_BANDS, 153 );
+	EXPECT_EQ( jsmapper_evgen_recorder_count(), count );
+}
+
+
+TEST_F( ModesTest, AxisCacheAxisMode )
+{
+	axis( AXIS_BANDS, 150 );
+	EXPECT_EQ( sent(), 100 );
+	
+	axis( AXIS_TRIGGER, D_LOW );
+	axis( AXIS_BANDS, 151 );
+	EXPECT_EQ( sent(), 140 );
+	
+	// moving the trigger within its band changes nothing:
+	unsigned long count = jsmapper_evgen_recorder_count();
+	axis( AXIS_TRIGGER, D_LOW + 1 );
+	axis( AXIS_BANDS, 152 );
+	EXPECT_EQ( jsmapper_evgen_recorder_count(), count );
+	
+	axis( AXIS_TRIGGER, D_HIGH + 1 );
+	axis( AXIS_BANDS, 153 );
+	EXPECT_EQ( sent(), 100 );
+	
+	// both changes in the same frame, the trigger coming after the value:
+	fixture_axis( m_fixture, AXIS_BANDS, 154 );
+	fixture_axis( m_fixture, AXIS_TRIGGER, D_HIGH );
+	fixture_sync( m_fixture );
+	EXPECT_EQ( sent(), 140 );
+}
+
+
+TEST_F( ModesTest, CloneCommit )
+{
+	std::vector<std::vector<unsigned int>> before;
+	for( unsigned int pressed = 0; pressed < 8; pressed++ ) {
+		button( SHIFT_A, pressed & 1 );
+		button( SHIFT_B, ( pressed >> 1 ) & 1 );
+		button( SHIFT_C, ( pressed >> 2 ) & 1 );
+		before.push_back( keys() );
+	}
+	
+	// re-publishing an unmodified clone keeps the same precedence, and the modes active right now:
+	m_staging = jsmapper_core_get_staging( m_core );
+	ASSERT_TRUE( m_staging != NULL );
+	commit();
+	EXPECT_TRUE( active( m_a ) );
+	EXPECT_TRUE( active( m_b ) );
+	EXPECT_TRUE( active( m_c ) );
+	
+	for( unsigned int pressed = 0; pressed < 8; pressed++ ) {
+		button( SHIFT_A, pressed & 1 );
+		button( SHIFT_B, ( pressed >> 1 ) & 1 );
+		button( SHIFT_C, ( pressed >> 2 ) & 1 );
+		EXPECT_EQ( keys(), before[ pressed ] ) << "buttons 0x" << pressed;
+	}
+	
+	// a mode added to the clone goes after the existing ones, without changing their order:
+	m_staging = jsmapper_core_get_staging( m_core );
+	ASSERT_TRUE( m_staging != NULL );
+	unsigned int e = addButtonMode( 0, SHIFT_E );
+	setButton( e, BUTTON_1, 51 );
+	setButton( m_a, BUTTON_3, 13 );
+	commit();
+	
+	button( SHIFT_A, 1 );
+	button( SHIFT_B, 1 );
+	button( SHIFT_C, 0 );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 21, 2, 23 } ) );
+	button( SHIFT_B, 0 );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 11, 2, 13 } ) );
+	button( SHIFT_E, 1 );
+	EXPECT_TRUE( active( e ) );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 51, 2, 13 } ) );
+	button( SHIFT_C, 1 );
+	EXPECT_EQ( keys(), std::vector<unsigned int>( { 51, 32, 13 } ) );
+}
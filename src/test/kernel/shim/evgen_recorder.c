@@ -0,0 +1,131 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file evgen_recorder.c
+ * \brief Event generator replacement recording the actions sent by the core
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include "evgen_recorder.h"
+#include "jsmapper_evgen.h"
+#include "jsmapper_log.h"
+
+#include <string.h>
+
+
+/* module log level, normally a parameter of the module */
+int jsmapper_log_level = JSMAPPER_LOG_LEVEL_INFO;
+
+static struct jsmapper_evgen_record records[ JSMAPPER_EVGEN_RECORDER_SIZE ];
+static unsigned long record_count = 0;
+
+static struct jsmapper_evgen_stats stats;
+static int frame_active = 0;
+static int frame_pending = 0;
+
+
+int jsmapper_evgen_send_action( struct jsmapper_evgen * evgen, struct jsmapdev_core_action * action, int press )
+{
+	struct jsmapper_evgen_record * record = &records[ record_count % JSMAPPER_EVGEN_RECORDER_SIZE ];
+	
+	/* a single recorder stands for every event generator */
+	(void) evgen;
+	
+	record->type = action->type;
+	record->key_id = action->type == JSMAPPER_ACTION_KEY ? action->key.id : 0;
+	record->press = press;
+	record_count++;
+	
+	/* same syncs the event generator would request: key changes, and single relative axis steps */
+	if( frame_active ) {
+		if( ( action->type == JSMAPPER_ACTION_KEY && ( press || !action->key.single ) ) 
+			|| ( action->type == JSMAPPER_ACTION_REL && press && action->rel.single ) ) {
+			stats.requested_syncs++;
+			frame_pending = 1;
+		}
+	}
+	
+	return 0;
+}
+
+
+int jsmapper_evgen_init_macro( struct jsmapdev_core_profile * profile, struct jsmapdev_core_macro * macro )
+{
+	/* macros are recorded, not played: no run state needed */
+	(void) profile;
+	(void) macro;
+	return 0;
+}
+
+
+void jsmapper_evgen_begin_frame( struct jsmapper_evgen * evgen )
+{
+	(void) evgen;
+	frame_active = 1;
+	stats.frames++;
+}
+
+
+void jsmapper_evgen_end_frame( struct jsmapper_evgen * evgen )
+{
+	(void) evgen;
+	
+	/* key conflicts inside the batch are not tracked: that's one sync per frame at most */
+	if( frame_pending )
+		stats.syncs++;
+	frame_pending = 0;
+	frame_active = 0;
+}
+
+
+void jsmapper_evgen_get_stats( struct jsmapper_evgen * evgen, struct jsmapper_evgen_stats * result )
+{
+	(void) evgen;
+	*result = stats;
+}
+
+
+void jsmapper_evgen_recorder_reset( void )
+{
+	record_count = 0;
+	memset( &stats, 0, sizeof( stats ) );
+}
+
+
+unsigned long jsmapper_evgen_recorder_count( void )
+{
+	return record_count;
+}
+
+
+unsigned long jsmapper_evgen_recorder_frames( void )
+{
+	return stats.frames;
+}
+
+
+unsigned long jsmapper_evgen_recorder_syncs( int batched )
+{
+	return batched ? stats.syncs : stats.requested_syncs;
+}
+
+
+const struct jsmapper_evgen_record * jsmapper_evgen_recorder_get( unsigned int index )
+{
+	if( index >= record_count || index >= JSMAPPER_EVGEN_RECORDER_SIZE )
+		return NULL;
+	
+	return &records[ ( record_count - 1 - index ) % JSMAPPER_EVGEN_RECORDER_SIZE ];
+}
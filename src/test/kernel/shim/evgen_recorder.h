@@ -0,0 +1,72 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file evgen_recorder.h
+ * \brief Event generator replacement recording the actions sent by the core
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#ifndef __JSMAPPER_EVGEN_RECORDER_H_
+#define __JSMAPPER_EVGEN_RECORDER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of actions kept by the recorder, older ones get overwritten */
+#define JSMAPPER_EVGEN_RECORDER_SIZE		256
+
+/**
+ * \brief Action sent to the event generator
+ */
+struct jsmapper_evgen_record {
+	/** Action type */
+	unsigned int type;
+	/** Key ID, for key actions */
+	unsigned int key_id;
+	/** Non-zero if action was pressed, zero if released */
+	int press;
+};
+
+/**
+ * \brief Forgets all recorded actions & output counters
+ */
+void jsmapper_evgen_recorder_reset( void );
+
+/**
+ * \brief Returns the total number of actions sent since last reset
+ */
+unsigned long jsmapper_evgen_recorder_count( void );
+
+/**
+ * \brief Returns the number of input frames resolved since last reset
+ */
+unsigned long jsmapper_evgen_recorder_frames( void );
+
+/**
+ * \brief Returns the number of syncs that would be sent for those frames, with & without output batching
+ */
+unsigned long jsmapper_evgen_recorder_syncs( int batched );
+
+/**
+ * \brief Returns a recorded action, 0 being the last one sent, or NULL if not recorded
+ */
+const struct jsmapper_evgen_record * jsmapper_evgen_recorder_get( unsigned int index );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __JSMAPPER_EVGEN_RECORDER_H_
@@ -0,0 +1,153 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file kshim.h
+ * \brief Minimal kernel API shim used to build the module's mapping core in userspace
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#ifndef __JSMAPPER_KSHIM_H_
+#define __JSMAPPER_KSHIM_H_
+
+/*
+ * Only what jsmapper_core.c needs is provided here. Everything runs in a single thread, so locking & RCU 
+ * primitives are no-ops, and bit operations needn't be atomic.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/types.h>
+
+#include <linux/types.h>
+
+
+/* types */
+typedef __u8	u8;
+typedef __s16	s16;
+typedef __u16	u16;
+typedef __s32	s32;
+typedef __u32	u32;
+typedef __s64	s64;
+typedef __u64	u64;
+
+
+/* memory allocation */
+#define GFP_KERNEL		0
+#define GFP_ATOMIC		1
+
+static inline void * kmalloc( size_t size, int flags )
+{
+	(void) flags;
+	return malloc( size ? size : 1 );
+}
+
+static inline void * kzalloc( size_t size, int flags )
+{
+	(void) flags;
+	return calloc( 1, size ? size : 1 );
+}
+
+static inline void kfree( const void * p )
+{
+	free( (void *) p );
+}
+
+static inline char * kstrdup( const char * s, int flags )
+{
+	(void) flags;
+	return s ? strdup( s ) : NULL;
+}
+
+
+/* helpers */
+#define container_of( ptr, type, member )	( (type *) ( (char *) (ptr) - offsetof( type, member ) ) )
+#define ALIGN( x, a )						( ( (x) + (a) - 1 ) & ~( (__typeof__(x)) (a) - 1 ) )
+#define min_t( t, a, b )					( (t) (a) < (t) (b) ? (t) (a) : (t) (b) )
+#define max_t( t, a, b )					( (t) (a) > (t) (b) ? (t) (a) : (t) (b) )
+#define clamp_t( t, v, lo, hi )				min_t( t, max_t( t, v, lo ), hi )
+
+
+/* bit operations */
+#define BITS_PER_LONG			( 8 * sizeof(long) )
+#define BITS_TO_LONGS( n )		( ( (n) + BITS_PER_LONG - 1 ) / BITS_PER_LONG )
+
+static inline int test_bit( unsigned int n, const unsigned long * addr )
+{
+	return ( addr[ n / BITS_PER_LONG ] >> ( n % BITS_PER_LONG ) ) & 1;
+}
+
+static inline void set_bit( unsigned int n, unsigned long * addr )
+{
+	addr[ n / BITS_PER_LONG ] |= 1UL << ( n % BITS_PER_LONG );
+}
+
+static inline void clear_bit( unsigned int n, unsigned long * addr )
+{
+	addr[ n / BITS_PER_LONG ] &= ~( 1UL << ( n % BITS_PER_LONG ) );
+}
+
+static inline void bitmap_zero( unsigned long * addr, unsigned int bits )
+{
+	memset( addr, 0, BITS_TO_LONGS( bits ) * sizeof(long) );
+}
+
+static inline int bitmap_empty( const unsigned long * addr, unsigned int bits )
+{
+	unsigned int i = 0;
+	
+	for( i = 0; i < bits; i++ ) {
+		if( test_bit( i, addr ) )
+			return 0;
+	}
+	return 1;
+}
+
+static inline unsigned int find_next_bit( const unsigned long * addr, unsigned int size, unsigned int offset )
+{
+	while( offset < size && !test_bit( offset, addr ) )
+		offset++;
+	return offset < size ? offset : size;
+}
+
+#define for_each_set_bit( bit, addr, size ) \
+	for( (bit) = find_next_bit( (addr), (size), 0 ); (bit) < (size); (bit) = find_next_bit( (addr), (size), (bit) + 1 ) )
+
+
+/* logging: core messages are dropped, they'd only distort benchmark results */
+static inline __attribute__(( format( printf, 1, 2 ) )) int printk( const char * fmt, ... )
+{
+	(void) fmt;
+	return 0;
+}
+
+#define KERN_DEBUG		""
+#define KERN_INFO		""
+#define KERN_WARNING	""
+#define KERN_ERR		""
+
+#define pr_debug( fmt, ... )				printk( fmt, ##__VA_ARGS__ )
+#define printk_ratelimited( fmt, ... )		printk( fmt, ##__VA_ARGS__ )
+
+/* static keys: debug messages are always off */
+#define DECLARE_STATIC_KEY_FALSE( name )	extern int name
+#define static_branch_unlikely( key )		0
+
+
+#endif // __JSMAPPER_KSHIM_H_
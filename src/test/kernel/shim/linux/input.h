@@ -0,0 +1,39 @@
+#ifndef __JSMAPPER_KSHIM_INPUT_H_
+#define __JSMAPPER_KSHIM_INPUT_H_
+
+#include "../kshim.h"
+#include "spinlock.h"
+
+/* event & code definitions come from the userspace header: */
+#include_next <linux/input.h>
+
+/**
+ * \brief Input device, reduced to the state the core reads
+ */
+struct input_dev {
+	spinlock_t event_lock;
+	const char * name;
+	unsigned long evbit[ BITS_TO_LONGS( EV_CNT ) ];
+	unsigned long keybit[ BITS_TO_LONGS( KEY_CNT ) ];
+	unsigned long absbit[ BITS_TO_LONGS( ABS_CNT ) ];
+	unsigned long relbit[ BITS_TO_LONGS( REL_CNT ) ];
+	unsigned long key[ BITS_TO_LONGS( KEY_CNT ) ];
+	struct input_absinfo absinfo[ ABS_CNT ];
+};
+
+static inline int input_abs_get_val( struct input_dev * dev, unsigned int axis )
+{
+	return dev->absinfo[ axis ].value;
+}
+
+static inline int input_abs_get_min( struct input_dev * dev, unsigned int axis )
+{
+	return dev->absinfo[ axis ].minimum;
+}
+
+static inline int input_abs_get_max( struct input_dev * dev, unsigned int axis )
+{
+	return dev->absinfo[ axis ].maximum;
+}
+
+#endif
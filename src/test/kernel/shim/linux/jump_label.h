@@ -0,0 +1,6 @@
+#ifndef __JSMAPPER_KSHIM_JUMP_LABEL_H_
+#define __JSMAPPER_KSHIM_JUMP_LABEL_H_
+
+#include "../kshim.h"
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __JSMAPPER_KSHIM_KREF_H_
+#define __JSMAPPER_KSHIM_KREF_H_
+
+#include "../kshim.h"
+
+struct kref {
+	unsigned int refcount;
+};
+
+static inline void kref_init( struct kref * kref )
+{
+	kref->refcount = 1;
+}
+
+static inline void kref_get( struct kref * kref )
+{
+	kref->refcount++;
+}
+
+static inline int kref_put( struct kref * kref, void (*release)( struct kref * kref ) )
+{
+	if( --kref->refcount == 0 ) {
+		release( kref );
+		return 1;
+	}
+	
+	return 0;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef __JSMAPPER_KSHIM_LIST_H_
+#define __JSMAPPER_KSHIM_LIST_H_
+
+#include "../kshim.h"
+
+struct list_head {
+	struct list_head * next;
+	struct list_head * prev;
+};
+
+#define INIT_LIST_HEAD( list )		do { (list)->next = (list); (list)->prev = (list); } while( 0 )
+
+static inline void __list_add( struct list_head * item, struct list_head * prev, struct list_head * next )
+{
+	next->prev = item;
+	item->next = next;
+	item->prev = prev;
+	prev->next = item;
+}
+
+static inline void list_add( struct list_head * item, struct list_head * head )
+{
+	__list_add( item, head, head->next );
+}
+
+static inline void list_add_tail( struct list_head * item, struct list_head * head )
+{
+	__list_add( item, head->prev, head );
+}
+
+static inline void list_del( struct list_head * item )
+{
+	item->next->prev = item->prev;
+	item->prev->next = item->next;
+}
+
+static inline int list_empty( const struct list_head * head )
+{
+	return head->next == head;
+}
+
+#define list_entry( ptr, type, member )		container_of( ptr, type, member )
+
+#define list_for_each_entry( pos, head, member ) \
+	for( pos = list_entry( (head)->next, __typeof__(*pos), member ); \
+	     &pos->member != (head); \
+	     pos = list_entry( pos->member.next, __typeof__(*pos), member ) )
+
+#define list_for_each_entry_reverse( pos, head, member ) \
+	for( pos = list_entry( (head)->prev, __typeof__(*pos), member ); \
+	     &pos->member != (head); \
+	     pos = list_entry( pos->member.prev, __typeof__(*pos), member ) )
+
+#define list_for_each_entry_safe( pos, n, head, member ) \
+	for( pos = list_entry( (head)->next, __typeof__(*pos), member ), \
+	     n = list_entry( pos->member.next, __typeof__(*pos), member ); \
+	     &pos->member != (head); \
+	     pos = n, n = list_entry( n->member.next, __typeof__(*n), member ) )
+
+#endif
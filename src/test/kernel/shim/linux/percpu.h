@@ -0,0 +1,10 @@
+#ifndef __JSMAPPER_KSHIM_PERCPU_H_
+#define __JSMAPPER_KSHIM_PERCPU_H_
+
+#include "../kshim.h"
+
+/* a single CPU in userspace: per-CPU data is plain data */
+#define __percpu
+#define this_cpu_inc( var )		( (var)++ )
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef __JSMAPPER_KSHIM_RCUPDATE_H_
+#define __JSMAPPER_KSHIM_RCUPDATE_H_
+
+#include "../kshim.h"
+
+#define __rcu
+
+#define rcu_read_lock()							do { } while( 0 )
+#define rcu_read_unlock()						do { } while( 0 )
+#define rcu_dereference( p )					(p)
+#define rcu_dereference_protected( p, c )		(p)
+#define rcu_access_pointer( p )					(p)
+#define rcu_assign_pointer( p, v )				( (p) = (v) )
+#define RCU_INIT_POINTER( p, v )				( (p) = (v) )
+
+static inline void synchronize_rcu( void )
+{
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef __JSMAPPER_KSHIM_SLAB_H_
+#define __JSMAPPER_KSHIM_SLAB_H_
+
+#include "../kshim.h"
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef __JSMAPPER_KSHIM_SORT_H_
+#define __JSMAPPER_KSHIM_SORT_H_
+
+#include "../kshim.h"
+
+static inline void sort( void * base, size_t num, size_t size, 
+                         int (*cmp)( const void *, const void * ), void (*swap)( void *, void *, int ) )
+{
+	(void) swap;
+	qsort( base, num, size, cmp );
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __JSMAPPER_KSHIM_SPINLOCK_H_
+#define __JSMAPPER_KSHIM_SPINLOCK_H_
+
+#include "../kshim.h"
+
+typedef int spinlock_t;
+
+#define spin_lock_irqsave( lock, flags )		do { (void) (lock); (flags) = 0; } while( 0 )
+#define spin_unlock_irqrestore( lock, flags )	do { (void) (lock); (void) (flags); } while( 0 )
+
+#endif
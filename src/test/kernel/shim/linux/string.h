@@ -0,0 +1,6 @@
+#ifndef __JSMAPPER_KSHIM_STRING_H_
+#define __JSMAPPER_KSHIM_STRING_H_
+
+#include "../kshim.h"
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __JSMAPPER_KSHIM_TRACEPOINT_H_
+#define __JSMAPPER_KSHIM_TRACEPOINT_H_
+
+#include "../kshim.h"
+
+/* tracepoints: every event becomes an empty inline function, its definition is discarded */
+#define TP_PROTO( args... )		args
+#define TP_ARGS( args... )		args
+
+#define TRACE_EVENT( name, proto, args, tstruct, assign, print ) \
+	static inline void trace_##name( proto ) { }
+#define DECLARE_EVENT_CLASS( name, proto, args, tstruct, assign, print )
+#define DEFINE_EVENT( template, name, proto, args ) \
+	static inline void trace_##name( proto ) { }
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __JSMAPPER_KSHIM_TYPES_H_
+#define __JSMAPPER_KSHIM_TYPES_H_
+
+#include_next <linux/types.h>
+#include "../kshim.h"
+
+#endif
@@ -0,0 +1 @@
+/* tracepoints are never created in the shim build */
@@ -0,0 +1,129 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file main.cpp
+ * \brief Benchmark comparing the ways of sampling device state: value ioctls, state ioctl & shared state page
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <jsmapper/device.h>
+#include <jsmapper/devicestate.h>
+#include <jsmapper/sharedstate.h>
+#include <jsmapper/log.h>
+
+#include <stdlib.h>
+
+
+/*
+ * Every iteration samples the whole state of a jsmap device: all button & axis values. The device is taken from 
+ * JSMAPPER_DEVICE environment variable (default is 0, for jsmap0), and kept open for the whole run, so no time 
+ * goes to opening it.
+ */
+
+/// Returns the ID of the device to benchmark
+static int deviceId()
+{
+	const char * id = getenv( "JSMAPPER_DEVICE" );
+	return id ? atoi( id ) : 0;
+}
+
+
+/// One JMIOCGBUTTONVALUE / JMIOCGAXISVALUE call per value
+static void BM_ValueIoctls( benchmark::State &state )
+{
+	jsmapper::Device dev( deviceId() );
+	if( !dev.open() )
+	{
+		state.SkipWithError( "Failed to open device!" );
+		return;
+	}
+
+	int buttons = dev.getNumButtons();
+	int axes = dev.getNumAxes();
+	for( auto _ : state )
+	{
+		for( jsmapper::ButtonID id = 0; id < (jsmapper::ButtonID) buttons; id++ )
+			benchmark::DoNotOptimize( dev.getButtonValue( id ) );
+		for( jsmapper::AxisID id = 0; id < (jsmapper::AxisID) axes; id++ )
+			benchmark::DoNotOptimize( dev.getAxisValue( id ) );
+	}
+
+	state.counters[ "values" ] = buttons + axes;
+	dev.close();
+}
+BENCHMARK( BM_ValueIoctls );
+
+
+/// A single JMIOCGSTATE call
+static void BM_StateIoctl( benchmark::State &state )
+{
+	jsmapper::Device dev( deviceId() );
+	if( !dev.open() )
+	{
+		state.SkipWithError( "Failed to open device!" );
+		return;
+	}
+
+	jsmapper::DeviceState snapshot;
+	for( auto _ : state )
+	{
+		if( !dev.getState( snapshot ) )
+		{
+			state.SkipWithError( "Failed to get device state!" );
+			break;
+		}
+		benchmark::DoNotOptimize( snapshot.getAxisValue( 0 ) );
+	}
+
+	dev.close();
+}
+BENCHMARK( BM_StateIoctl );
+
+
+/// Lock-free read of the shared state page
+static void BM_SharedState( benchmark::State &state )
+{
+	jsmapper::Device dev( deviceId() );
+	jsmapper::SharedState shared;
+	if( !shared.open( dev ) )
+	{
+		state.SkipWithError( "Failed to map device state!" );
+		return;
+	}
+
+	jsmapper::DeviceState snapshot;
+	int64_t retries = 0;
+	for( auto _ : state )
+	{
+		if( !shared.read( snapshot ) )
+			retries++;
+		benchmark::DoNotOptimize( snapshot.getAxisValue( 0 ) );
+	}
+
+	state.counters[ "failed" ] = retries;
+}
+BENCHMARK( BM_SharedState );
+
+
+int main( int argc, char **argv )
+{
+	jsmapper::Log::getLog()->setLogLevel( jsmapper::Log::NONE );
+
+	benchmark::Initialize( &argc, argv );
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
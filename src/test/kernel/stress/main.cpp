@@ -0,0 +1,188 @@
+/**
+ * Copyright 2013 Eduard Huguet Cuadrench
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License.
+ * 
+ * Foobar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * \file main.cpp
+ * \brief Connection stress test: attaches lots of virtual joysticks, timing jsmap device creation & removal
+ * \author Eduard Huguet <eduardhc@gmail.com>
+ */
+
+#include <jsmapper/device.h>
+#include <jsmapper/log.h>
+
+#include <linux/uinput.h>
+
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+
+/// Default number of virtual joysticks
+static const int DEFAULT_COUNT		= 64;
+/// Maximum time to wait for a jsmap device to appear / disappear, in ms
+static const int TIMEOUT_MS			= 5000;
+
+
+/// Returns monotonic time, in ms
+static double now()
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+
+/// Creates a virtual joystick (2 axes, 8 buttons), returning its uinput file descriptor or -1
+static int createJoystick( int index )
+{
+	int fd = open( "/dev/uinput", O_WRONLY | O_NONBLOCK );
+	if( fd < 0 )
+		return -1;
+
+	struct uinput_user_dev setup;
+	memset( &setup, 0, sizeof( setup ) );
+	snprintf( setup.name, UINPUT_MAX_NAME_SIZE, "jsmapper stress joystick %i", index );
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x1234;
+	setup.id.product = index;
+
+	ioctl( fd, UI_SET_EVBIT, EV_KEY );
+	for( int i = 0; i < 8; i++ )
+		ioctl( fd, UI_SET_KEYBIT, BTN_JOYSTICK + i );
+
+	ioctl( fd, UI_SET_EVBIT, EV_ABS );
+	for( int axis = ABS_X; axis <= ABS_Y; axis++ )
+	{
+		ioctl( fd, UI_SET_ABSBIT, axis );
+		setup.absmin[ axis ] = 0;
+		setup.absmax[ axis ] = 1023;
+	}
+
+	if( write( fd, &setup, sizeof( setup ) ) != sizeof( setup ) || ioctl( fd, UI_DEV_CREATE ) < 0 )
+	{
+		close( fd );
+		return -1;
+	}
+
+	return fd;
+}
+
+
+/// Waits for the number of jsmap devices to reach a given count, returning false on timeout
+static bool waitForDevices( size_t count )
+{
+	double start = now();
+	while( jsmapper::Device::enumerate().size() != count )
+	{
+		if( now() - start > TIMEOUT_MS )
+			return false;
+		usleep( 200 );
+	}
+	return true;
+}
+
+
+/// Returns the average of a range of samples
+static double average( const std::vector<double> &samples, size_t first, size_t last )
+{
+	double sum = 0;
+	for( size_t i = first; i < last; i++ )
+		sum += samples[i];
+	return last > first ? sum / ( last - first ) : 0;
+}
+
+
+int main( int argc, char ** argv )
+{
+	int count = argc > 1 ? atoi( argv[1] ) : DEFAULT_COUNT;
+	if( count <= 0 )
+	{
+		fprintf( stderr, "Usage: jsmapper-stress-connect [count]\n" );
+		return 1;
+	}
+
+	jsmapper::Log::getLog()->setLogLevel( jsmapper::Log::NONE );
+
+	size_t base = jsmapper::Device::enumerate().size();
+	std::vector<int> fds;
+	std::vector<double> connectMs, disconnectMs;
+
+	// attach joysticks one by one, timing until their jsmap device shows up:
+	for( int i = 0; i < count; i++ )
+	{
+		double start = now();
+		int fd = createJoystick( i );
+		if( fd < 0 )
+		{
+			fprintf( stderr, "Failed to create virtual joystick #%i (error %i: %s)\n", i, errno, strerror( errno ) );
+			break;
+		}
+		fds.push_back( fd );
+
+		if( !waitForDevices( base + fds.size() ) )
+		{
+			fprintf( stderr, "Timeout waiting for jsmap device of joystick #%i!\n", i );
+			break;
+		}
+		connectMs.push_back( now() - start );
+	}
+
+	std::vector<int> ids = jsmapper::Device::enumerate();
+	printf( "%u jsmap devices present (first: %i, last: %i)\n", (unsigned) ids.size(), 
+			ids.empty() ? -1 : ids.front(), ids.empty() ? -1 : ids.back() );
+
+	// and detach them, newest first:
+	while( !fds.empty() )
+	{
+		double start = now();
+		ioctl( fds.back(), UI_DEV_DESTROY );
+		close( fds.back() );
+		fds.pop_back();
+
+		if( !waitForDevices( base + fds.size() ) )
+		{
+			fprintf( stderr, "Timeout waiting for jsmap device removal!\n" );
+			return 1;
+		}
+		disconnectMs.push_back( now() - start );
+	}
+
+	// cost must not grow with the number of devices already present:
+	printf( "\n%8s %12s %12s\n", "devices", "connect ms", "disconnect ms" );
+	for( size_t i = 0; i < connectMs.size(); i++ )
+	{
+		double dis = i < disconnectMs.size() ? disconnectMs[ disconnectMs.size() - 1 - i ] : 0;
+		printf( "%8u %12.3f %12.3f\n", (unsigned) ( base + i + 1 ), connectMs[i], dis );
+	}
+
+	size_t quarter = connectMs.size() / 4;
+	if( quarter > 0 )
+	{
+		size_t n = connectMs.size();
+		std::vector<double> disconnectByCount( disconnectMs.rbegin(), disconnectMs.rend() );
+		printf( "\nconnect:    first quarter %.3f ms, last quarter %.3f ms\n", 
+				average( connectMs, 0, quarter ), average( connectMs, n - quarter, n ) );
+		printf( "disconnect: first quarter %.3f ms, last quarter %.3f ms\n", 
+				average( disconnectByCount, 0, quarter ), average( disconnectByCount, n - quarter, n ) );
+	}
+
+	return (int) connectMs.size() == count ? 0 : 1;
+}